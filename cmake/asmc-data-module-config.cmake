@@ -4,5 +4,6 @@ find_dependency(Eigen3)
 find_dependency(fmt)
 find_dependency(range-v3)
 find_dependency(ZLIB)
+find_dependency(Threads)
 
 include(${CMAKE_CURRENT_LIST_DIR}/asmc-data-module-runtime.cmake)
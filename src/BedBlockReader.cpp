@@ -0,0 +1,186 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedBlockReader.hpp"
+
+extern "C" {
+#include "third_party/pandas_plink/bed_reader.h"
+}
+
+#include "utils/BedUtils.hpp"
+#include "utils/RandomAccessFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <exception>
+#include <numeric>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+BedBlockReader::BedBlockReader(std::string_view bedFile, std::string_view bimFile, std::string_view famFile,
+                               unsigned long blockSize, bool prefetch)
+    : mBim{bimFile}, mFam{famFile}, mBlockSize{blockSize}, mBytesPerSite{(mFam.getNumIndividuals() + 3ul) / 4ul},
+      mPrefetch{prefetch} {
+
+  if (blockSize == 0ul) {
+    throw std::runtime_error("The block size of a BedBlockReader must be at least 1");
+  }
+  if (!fs::is_regular_file(bedFile)) {
+    throw std::runtime_error(fmt::format("Expected .bed file, but got {}", bedFile));
+  }
+
+  mBedFile = std::make_unique<RandomAccessFile>(bedFile);
+
+  std::array<uint8_t, 3> header = {};
+  if (mBedFile->size() >= header.size()) {
+    mBedFile->readAt(0ul, header.data(), header.size());
+  }
+  if (validateBedFile(bedFile, header.data(), mBedFile->size(), getNumSites(), getNumIndividuals()) ==
+      BedLayout::IndividualMajor) {
+    throw std::runtime_error(fmt::format("BedBlockReader requires a SNP-major .bed file, but {} is individual-major",
+                                         bedFile));
+  }
+
+  // Allocate the buffers once, sized for the largest block that will be read
+  const unsigned long maxBlockSize = std::min(mBlockSize, getNumSites());
+  mPackedBlock.resize(maxBlockSize * mBytesPerSite);
+  mBlock.resize(static_cast<index_t>(getNumIndividuals()), static_cast<index_t>(maxBlockSize));
+  if (mPrefetch) {
+    mPrefetchBlock.resize(maxBlockSize * mBytesPerSite);
+    mBedFile->adviseSequential();
+  }
+}
+
+BedBlockReader::BedBlockReader(BedBlockReader&& other) noexcept = default;
+
+BedBlockReader& BedBlockReader::operator=(BedBlockReader&& other) noexcept {
+  if (this != &other) {
+    cancelPrefetch();
+    mBim = std::move(other.mBim);
+    mFam = std::move(other.mFam);
+    mBedFile = std::move(other.mBedFile);
+    mBlockSize = other.mBlockSize;
+    mBytesPerSite = other.mBytesPerSite;
+    mBlockStart = other.mBlockStart;
+    mCurrentBlockSize = other.mCurrentBlockSize;
+    mNextSite = other.mNextSite;
+    mPrefetch = other.mPrefetch;
+    mPackedBlock = std::move(other.mPackedBlock);
+    mPrefetchBlock = std::move(other.mPrefetchBlock);
+    mPendingRead = std::move(other.mPendingRead);
+    mBlock = std::move(other.mBlock);
+    mBlockBim = std::move(other.mBlockBim);
+  }
+  return *this;
+}
+
+BedBlockReader::~BedBlockReader() {
+  cancelPrefetch();
+}
+
+void BedBlockReader::startPrefetch() {
+  const unsigned long numSites = std::min(mBlockSize, getNumSites() - mNextSite);
+  if (!mPrefetch || numSites == 0ul) {
+    return;
+  }
+
+  // Capture the file and buffer rather than this, as their addresses are unchanged if the reader is moved
+  const std::size_t offset = bedMagicBytes.size() + mNextSite * mBytesPerSite;
+  const std::size_t numBytes = numSites * mBytesPerSite;
+  mPendingRead = std::async(std::launch::async,
+                            [file = mBedFile.get(), buffer = mPrefetchBlock.data(), offset, numBytes]() {
+                              file->readAt(offset, buffer, numBytes);
+                            });
+}
+
+void BedBlockReader::cancelPrefetch() noexcept {
+  if (mPendingRead.valid()) {
+    mPendingRead.wait();
+    mPendingRead = std::future<void>();
+  }
+}
+
+bool BedBlockReader::nextBlock() {
+  mBlockStart = mNextSite;
+  mCurrentBlockSize = std::min(mBlockSize, getNumSites() - mNextSite);
+  mNextSite += mCurrentBlockSize;
+
+  if (mCurrentBlockSize == 0ul) {
+    mBlockBim = BimFile();
+    return false;
+  }
+
+  if (mPendingRead.valid()) {
+    // The prefetched block is the one now required; get() rethrows any exception from the background read
+    mPendingRead.get();
+    std::swap(mPackedBlock, mPrefetchBlock);
+  } else {
+    mBedFile->readAt(bedMagicBytes.size() + mBlockStart * mBytesPerSite, mPackedBlock.data(),
+                     mCurrentBlockSize * mBytesPerSite);
+  }
+  startPrefetch();
+
+  for (unsigned long i = 0ul; i < mCurrentBlockSize; ++i) {
+    decode_bed_row(getPackedSite(i), 0ul, getNumIndividuals(), mBlock.col(static_cast<index_t>(i)).data(), 1ul);
+  }
+
+  std::vector<unsigned long> siteIds(mCurrentBlockSize);
+  std::iota(siteIds.begin(), siteIds.end(), mBlockStart);
+  mBlockBim = mBim.subset(siteIds);
+  return true;
+}
+
+void BedBlockReader::reset() {
+  cancelPrefetch();
+  mBlockStart = 0ul;
+  mCurrentBlockSize = 0ul;
+  mNextSite = 0ul;
+  mBlockBim = BimFile();
+}
+
+Eigen::Ref<const mat_uint8_t> BedBlockReader::getBlock() const {
+  return mBlock.leftCols(static_cast<index_t>(mCurrentBlockSize));
+}
+
+const uint8_t* BedBlockReader::getPackedSite(unsigned long siteInBlock) const {
+  assert(siteInBlock < mCurrentBlockSize);
+  return mPackedBlock.data() + siteInBlock * mBytesPerSite;
+}
+
+const BimFile& BedBlockReader::getBlockBim() const {
+  return mBlockBim;
+}
+
+unsigned long BedBlockReader::getBlockStart() const {
+  return mBlockStart;
+}
+
+unsigned long BedBlockReader::getBlockSize() const {
+  return mCurrentBlockSize;
+}
+
+unsigned long BedBlockReader::getMaxBlockSize() const {
+  return mBlockSize;
+}
+
+unsigned long BedBlockReader::getNumSites() const {
+  return mBim.getNumSites();
+}
+
+unsigned long BedBlockReader::getNumIndividuals() const {
+  return mFam.getNumIndividuals();
+}
+
+const BimFile& BedBlockReader::getBim() const {
+  return mBim;
+}
+
+const FamFile& BedBlockReader::getFam() const {
+  return mFam;
+}
+
+} // namespace asmc
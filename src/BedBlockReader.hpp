@@ -0,0 +1,169 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_BED_BLOCK_READER_HPP
+#define DATA_MODULE_BED_BLOCK_READER_HPP
+
+#include "BimFile.hpp"
+#include "EigenTypes.hpp"
+#include "FamFile.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+class RandomAccessFile;
+
+/**
+ * Read a PLINK fileset in consecutive blocks of sites, so that statistics can be computed over a .bed file that is
+ * larger than memory. Only one block is held at a time: each call to nextBlock() decodes the next block of sites into
+ * the same preallocated #individuals x blockSize matrix, using the same encoding as BedMatrixType::getData().
+ *
+ * While a block is being decoded and used, the packed bytes of the following block are read on a background thread into
+ * a second buffer, so that waiting for I/O overlaps with computation rather than adding to it.
+ *
+ * A typical loop is:
+ *
+ *   BedBlockReader reader(bedFile, bimFile, famFile, 1024ul);
+ *   while (reader.nextBlock()) {
+ *     auto block = reader.getBlock();
+ *     ...
+ *   }
+ */
+class BedBlockReader {
+
+private:
+  /** The sites in the fileset, read from the .bim file */
+  BimFile mBim;
+
+  /** The individuals in the fileset, read from the .fam file */
+  FamFile mFam;
+
+  /** The open .bed file */
+  std::unique_ptr<RandomAccessFile> mBedFile;
+
+  /** The maximum number of sites in each block */
+  unsigned long mBlockSize = 0ul;
+
+  /** The number of bytes used by each site in the .bed file */
+  unsigned long mBytesPerSite = 0ul;
+
+  /** The index of the first site in the current block */
+  unsigned long mBlockStart = 0ul;
+
+  /** The number of sites in the current block, which is 0 before the first block and after the last */
+  unsigned long mCurrentBlockSize = 0ul;
+
+  /** The index of the first site in the next block */
+  unsigned long mNextSite = 0ul;
+
+  /** Whether to read the next block on a background thread while the current block is in use */
+  bool mPrefetch = true;
+
+  /** The packed bytes of the current block, as read from the .bed file */
+  std::vector<uint8_t> mPackedBlock;
+
+  /** The buffer into which the next block is prefetched */
+  std::vector<uint8_t> mPrefetchBlock;
+
+  /** The pending background read of the next block, if any, into mPrefetchBlock */
+  std::future<void> mPendingRead;
+
+  /**
+   * Start reading the block beginning at mNextSite into mPrefetchBlock on a background thread.
+   */
+  void startPrefetch();
+
+  /**
+   * Wait for any pending background read to finish, discarding its result.
+   */
+  void cancelPrefetch() noexcept;
+
+  /** The decoded #individuals x blockSize genotypes of the current block */
+  mat_uint8_t mBlock;
+
+  /** The .bim metadata of the sites in the current block, refreshed by nextBlock() */
+  BimFile mBlockBim;
+
+public:
+  /**
+   * Open a PLINK fileset for reading in blocks. The .bim and .fam files are read in full, and the .bed file is checked
+   * against them, but no genotypes are read until nextBlock() is called.
+   *
+   * @param bedFile path to the .bed file
+   * @param bimFile path to the .bim file
+   * @param famFile path to the .fam file
+   * @param blockSize the maximum number of sites in each block, which must be at least 1
+   * @param prefetch whether to read each block on a background thread while the previous block is in use
+   */
+  BedBlockReader(std::string_view bedFile, std::string_view bimFile, std::string_view famFile, unsigned long blockSize,
+                 bool prefetch = true);
+
+  BedBlockReader(const BedBlockReader&) = delete;
+  BedBlockReader& operator=(const BedBlockReader&) = delete;
+  BedBlockReader(BedBlockReader&& other) noexcept;
+  BedBlockReader& operator=(BedBlockReader&& other) noexcept;
+  ~BedBlockReader();
+
+  /**
+   * Read and decode the next block of sites, replacing the current block.
+   *
+   * @return whether a block was read, which is false once every site has been read
+   */
+  bool nextBlock();
+
+  /**
+   * Return to the start of the .bed file, so that the next call to nextBlock() reads the first block again.
+   */
+  void reset();
+
+  /**
+   * Get the decoded genotypes of the current block, with one row per individual and one column per site. Values are
+   * 0, 1 or 2 copies of the second allele, or 3 for missing data. The view is invalidated by the next call to
+   * nextBlock() or reset().
+   *
+   * @return a #individuals x getBlockSize() view of the current block
+   */
+  [[nodiscard]] Eigen::Ref<const mat_uint8_t> getBlock() const;
+
+  /**
+   * Get the packed bytes of a site in the current block, in SNP-major .bed layout.
+   *
+   * @param siteInBlock the index of the site within the current block
+   * @return pointer to (#individuals + 3) / 4 packed bytes
+   */
+  [[nodiscard]] const uint8_t* getPackedSite(unsigned long siteInBlock) const;
+
+  /**
+   * @return the .bim metadata of the sites in the current block, which is replaced by the next call to nextBlock() or
+   * reset()
+   */
+  [[nodiscard]] const BimFile& getBlockBim() const;
+
+  /**
+   * @return the index in the fileset of the first site in the current block
+   */
+  [[nodiscard]] unsigned long getBlockStart() const;
+
+  /**
+   * @return the number of sites in the current block
+   */
+  [[nodiscard]] unsigned long getBlockSize() const;
+
+  [[nodiscard]] unsigned long getMaxBlockSize() const;
+  [[nodiscard]] unsigned long getNumSites() const;
+  [[nodiscard]] unsigned long getNumIndividuals() const;
+  [[nodiscard]] const BimFile& getBim() const;
+  [[nodiscard]] const FamFile& getFam() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_BED_BLOCK_READER_HPP
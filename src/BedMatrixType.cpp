@@ -3,19 +3,34 @@
 
 #include "BedMatrixType.hpp"
 
+#include "BedWriter.hpp"
+
 extern "C" {
 #include "third_party/pandas_plink/bed_reader.h"
 }
 
+#include "utils/BedUtils.hpp"
+#include "utils/BufferedFileWriter.hpp"
 #include "utils/FileUtils.hpp"
+#include "utils/MemoryMappedFile.hpp"
+#include "utils/RandomAccessFile.hpp"
 #include "utils/StringUtils.hpp"
+#include "utils/ThreadUtils.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <exception>
 #include <filesystem>
+#include <future>
+#include <iterator>
+#include <limits>
 #include <string_view>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 
 #include <fmt/core.h>
@@ -24,8 +39,24 @@ extern "C" {
 
 namespace asmc {
 
+namespace {
+
+/** Target size of each positioned read from a .bed file, so that several sites are fetched per system call */
+constexpr std::size_t bedReadBytes = 1ul << 22;
+
+/**
+ * Number of sites transposed together from an individual-major .bed file, so that each individual's row is read a
+ * whole 64-byte cache line at a time
+ */
+constexpr unsigned long transposeBlockSites = 256ul;
+
+/** Number of sites formatted by a thread as a single chunk of a .frq file */
+constexpr unsigned long frqSitesPerChunk = 1ul << 16;
+
+} // namespace
+
 BedMatrixType BedMatrixType::createFromBedBimFam(std::string_view bedFile, std::string_view bimFile,
-                                                 std::string_view famFile) {
+                                                 std::string_view famFile, const BedLoadOptions& options) {
   if (!fs::exists(bedFile) || !fs::is_regular_file(bedFile)) {
     throw std::runtime_error(fmt::format("Expected .bed file, but got {}", bedFile));
   }
@@ -37,135 +68,544 @@ BedMatrixType BedMatrixType::createFromBedBimFam(std::string_view bedFile, std::
   }
 
   BedMatrixType instance;
-  instance.readBimFile(bimFile);
-  instance.readFamFile(famFile);
-  instance.readBedFile(bedFile);
+  instance.mStorage = options.storage;
+  instance.selectSubset(BimFile(bimFile, options.useMetadataCache, options.numThreads),
+                        FamFile(famFile, options.useMetadataCache, options.numThreads), options);
+
+  switch (options.storage) {
+  case BedStorage::Decoded:
+    instance.readBedFile(bedFile, options.numThreads);
+    break;
+  case BedStorage::MemoryMapped:
+    instance.mapBedFile(bedFile, options.numThreads, options.cacheSiteStatistics);
+    break;
+  case BedStorage::Packed:
+    instance.readPackedBedFile(bedFile, options.numThreads, options.cacheSiteStatistics);
+    break;
+  }
 
   return instance;
 }
 
-void BedMatrixType::determineFamDelimiter(const fs::path& famFile) {
-  auto gzFile = gzopen(famFile.string().c_str(), "r");
-  auto firstLine = readNextLineFromGzip(gzFile);
+void BedMatrixType::selectSubset(const BimFile& bim, const FamFile& fam, const BedLoadOptions& options) {
+  mFileNumSites = bim.getNumSites();
+  mFileNumIndividuals = fam.getNumIndividuals();
+
+  const std::unordered_set<std::string_view> extract(options.extractSiteIds.begin(), options.extractSiteIds.end());
+  for (unsigned long siteId = 0ul; siteId < mFileNumSites; ++siteId) {
+    const unsigned long position = bim.getPhysicalPositions().at(siteId);
+    if ((!extract.empty() && extract.count(bim.getSnpIds().at(siteId)) == 0ul) ||
+        (!options.chromosome.empty() && bim.getChrId(siteId) != options.chromosome) ||
+        position < options.regionStart || position > options.regionEnd) {
+      continue;
+    }
+    mFileSiteIds.emplace_back(siteId);
+  }
 
-  std::vector<std::string> delimiters = {" ", "\t"};
-  for (const auto& delimiter : delimiters) {
-    if (splitTextByDelimiter(firstLine, delimiter).size() == 6ul) {
-      mFamDelimeter = delimiter;
-      gzclose(gzFile);
-      return;
+  const std::unordered_set<std::string_view> keep(options.keepIndividualIds.begin(), options.keepIndividualIds.end());
+  for (unsigned long individualId = 0ul; individualId < mFileNumIndividuals; ++individualId) {
+    if (keep.empty() || keep.count(fam.getIndividualIds().at(individualId)) > 0ul) {
+      mFileIndividualIds.emplace_back(individualId);
     }
   }
-  gzclose(gzFile);
-  throw std::runtime_error(fmt::format("Could not determine delimiter for .fam file {}", famFile.string()));
+
+  if (isIndividualSubset() && mStorage == BedStorage::MemoryMapped) {
+    throw std::runtime_error("A subset of individuals cannot be loaded with BedStorage::MemoryMapped, because the "
+                             "mapped .bed file holds every individual; use BedStorage::Packed instead");
+  }
+
+  mBim = mFileSiteIds.size() == mFileNumSites ? bim : bim.subset(mFileSiteIds);
+  mFam = isIndividualSubset() ? fam.subset(mFileIndividualIds) : fam;
+}
+
+bool BedMatrixType::isIndividualSubset() const {
+  return mFileIndividualIds.size() != mFileNumIndividuals;
 }
 
-void BedMatrixType::readBedFile(const fs::path& bedFile) {
+void BedMatrixType::readBedFile(const fs::path& bedFile, unsigned long numThreads) {
   mData.resize(static_cast<index_t>(getNumIndividuals()), static_cast<index_t>(getNumSites()));
+  allocateSiteStatistics();
+
+  // Each site is a contiguous column of mData, so threads write to disjoint memory. The per-site counts are taken from
+  // the packed bytes as they are read, rather than in later passes over the decoded matrix.
+  readBedRows(bedFile, numThreads, [this](unsigned long siteId, const uint8_t* row) {
+    decode_bed_row(row, 0ul, getNumIndividuals(), mData.col(static_cast<index_t>(siteId)).data(), 1ul);
+    storeSiteStatistics(siteId, row);
+  });
+  mHasSiteStatistics = true;
+}
 
-  const auto nRows = static_cast<uint64_t>(getNumSites());
-  const auto nCols = static_cast<uint64_t>(getNumIndividuals());
-  const auto rowStart = static_cast<uint64_t>(0ul);
-  const auto colStart = static_cast<uint64_t>(0ul);
-  const auto rowEnd = nRows;
-  const auto colEnd = nCols;
-  std::array<uint64_t, 2> strides = {static_cast<uint64_t>(mData.colStride()),
-                                     static_cast<uint64_t>(mData.rowStride())};
+void BedMatrixType::readPackedBedFile(const fs::path& bedFile, unsigned long numThreads, bool cacheSiteStatistics) {
+  mPacked = PackedGenotypeMatrix(getNumIndividuals(), getNumSites());
+  if (cacheSiteStatistics) {
+    allocateSiteStatistics();
+  }
+  readBedRows(bedFile, numThreads, [this, cacheSiteStatistics](unsigned long siteId, const uint8_t* row) {
+    mPacked.setSite(siteId, row);
+    if (cacheSiteStatistics) {
+      storeSiteStatistics(siteId, row);
+    }
+  });
+  mHasSiteStatistics = cacheSiteStatistics;
+}
 
-  read_bed_chunk(bedFile.string().data(), nRows, nCols, rowStart, colStart, rowEnd, colEnd, mData.data(),
-                 strides.data());
-  mMissingCounts = (mData.array() == static_cast<uint8_t>(mMissingInt)).colwise().count().cast<unsigned long>();
+void BedMatrixType::allocateSiteStatistics() {
+  mMissingCounts.resize(static_cast<index_t>(getNumSites()));
+  mAlleleCounts.resize(static_cast<index_t>(getNumSites()));
+  mHeterozygousCounts.resize(static_cast<index_t>(getNumSites()));
 }
 
-void BedMatrixType::readBimFile(const fs::path& bimFile) {
-  auto gzFile = gzopen(bimFile.string().c_str(), "r");
+void BedMatrixType::storeSiteStatistics(unsigned long siteId, const uint8_t* row) {
+  const BedSiteCounts counts = countBedRow(row, getNumIndividuals());
+  mMissingCounts(static_cast<index_t>(siteId)) = counts.numMissing;
+  mAlleleCounts(static_cast<index_t>(siteId)) = counts.getAlleleCount();
+  mHeterozygousCounts(static_cast<index_t>(siteId)) = counts.numHeterozygous;
+}
 
-  while (!gzeof(gzFile)) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), "\t");
-    if (!line.empty()) {
-      assert(line.size() == 6ul);
+void BedMatrixType::readBedRows(const fs::path& bedFile, unsigned long numThreads,
+                                const std::function<void(unsigned long, const uint8_t*)>& processSite) const {
+  const RandomAccessFile file(bedFile);
 
-      mSiteNames.emplace_back(line.at(1));
-      mGeneticPositions.emplace_back(std::stod(line.at(2)));
-      mPhysicalPositions.emplace_back(std::stoul(line.at(3)));
-    }
+  std::array<uint8_t, 3> header = {};
+  if (file.size() >= header.size()) {
+    file.readAt(0ul, header.data(), header.size());
+  }
+  if (validateBedFile(bedFile, header.data(), file.size(), mFileNumSites, mFileNumIndividuals) ==
+      BedLayout::IndividualMajor) {
+    readIndividualMajorBedRows(bedFile, numThreads, processSite);
+    return;
   }
 
-  gzclose(gzFile);
+  const unsigned long bytesPerSite = (mFileNumIndividuals + 3ul) / 4ul;
+  if (bytesPerSite == 0ul) {
+    return;
+  }
+  const unsigned long sitesPerRead = std::max(static_cast<unsigned long>(bedReadBytes) / bytesPerSite, 1ul);
+  const bool subsetIndividuals = isIndividualSubset();
+
+  // Each thread reads its range of sites in order, so let the operating system read ahead of it
+  file.adviseSequential();
+
+  parallelFor(0ul, getNumSites(), numThreads, [&](unsigned long first, unsigned long last) {
+    std::vector<uint8_t> buffer(std::min(sitesPerRead, last - first) * bytesPerSite);
+    std::vector<uint8_t> subsetRow(subsetIndividuals ? (getNumIndividuals() + 3ul) / 4ul : 0ul);
+
+    unsigned long blockStart = first;
+    while (blockStart < last) {
+      // Read a run of loaded sites that are contiguous in the file with a single call
+      unsigned long blockSize = 1ul;
+      while (blockStart + blockSize < last && blockSize < sitesPerRead &&
+             mFileSiteIds[blockStart + blockSize] == mFileSiteIds[blockStart] + blockSize) {
+        ++blockSize;
+      }
+      file.readAt(bedMagicBytes.size() + mFileSiteIds[blockStart] * bytesPerSite, buffer.data(),
+                  blockSize * bytesPerSite);
+
+      for (unsigned long i = 0ul; i < blockSize; ++i) {
+        const uint8_t* row = buffer.data() + i * bytesPerSite;
+        if (subsetIndividuals) {
+          subsetBedRow(row, mFileIndividualIds, subsetRow.data());
+          row = subsetRow.data();
+        }
+        processSite(blockStart + i, row);
+      }
+      blockStart += blockSize;
+    }
+  });
 }
 
-void BedMatrixType::readFamFile(const fs::path& famFile) {
-  determineFamDelimiter(famFile);
-  auto gzFile = gzopen(famFile.string().c_str(), "r");
+void BedMatrixType::readIndividualMajorBedRows(
+    const fs::path& bedFile, unsigned long numThreads,
+    const std::function<void(unsigned long, const uint8_t*)>& processSite) const {
+  if (mFileNumIndividuals == 0ul) {
+    return;
+  }
 
-  unsigned long numIndividuals = 0ul;
-  while (!gzeof(gzFile)) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), mFamDelimeter);
-    if (!line.empty()) {
-      assert(line.size() == 6ul);
-      numIndividuals++;
+  const MemoryMappedFile mapping(bedFile);
+  const uint8_t* genotypes = mapping.data() + bedMagicBytes.size();
+  const unsigned long bytesPerIndividual = (mFileNumSites + 3ul) / 4ul;
+  const unsigned long fileBytesPerSite = 8ul * ((mFileNumIndividuals + 31ul) / 32ul);
+  const bool subsetIndividuals = isIndividualSubset();
+
+  parallelFor(0ul, getNumSites(), numThreads, [&](unsigned long first, unsigned long last) {
+    std::vector<uint8_t> block(transposeBlockSites * fileBytesPerSite);
+    std::vector<uint8_t> subsetRow(subsetIndividuals ? (getNumIndividuals() + 3ul) / 4ul : 0ul);
+
+    // Loaded sites are in file order, so each block is transposed at most once by each thread
+    unsigned long blockStart = std::numeric_limits<unsigned long>::max();
+    for (unsigned long siteId = first; siteId < last; ++siteId) {
+      const unsigned long fileSiteId = mFileSiteIds[siteId];
+      if (blockStart == std::numeric_limits<unsigned long>::max() || fileSiteId >= blockStart + transposeBlockSites) {
+        blockStart = fileSiteId - fileSiteId % transposeBlockSites;
+        transposeIndividualMajorBed(genotypes, bytesPerIndividual, mFileNumIndividuals, blockStart,
+                                    std::min(transposeBlockSites, mFileNumSites - blockStart), block.data(),
+                                    fileBytesPerSite);
+      }
+
+      const uint8_t* row = block.data() + (fileSiteId - blockStart) * fileBytesPerSite;
+      if (subsetIndividuals) {
+        subsetBedRow(row, mFileIndividualIds, subsetRow.data());
+        row = subsetRow.data();
+      }
+      processSite(siteId, row);
     }
+  });
+}
+
+void BedMatrixType::mapBedFile(const fs::path& bedFile, unsigned long numThreads, bool cacheSiteStatistics) {
+  mBedMapping = std::make_shared<const MemoryMappedFile>(bedFile);
+  mBytesPerSite = (mFileNumIndividuals + 3ul) / 4ul;
+  if (validateBedFile(bedFile, mBedMapping->data(), mBedMapping->size(), mFileNumSites, mFileNumIndividuals) ==
+      BedLayout::IndividualMajor) {
+    throw std::runtime_error(fmt::format("The individual-major .bed file {} cannot be loaded with "
+                                         "BedStorage::MemoryMapped; use BedStorage::Packed instead",
+                                         bedFile.string()));
+  }
+
+  if (cacheSiteStatistics) {
+    allocateSiteStatistics();
+    parallelFor(0ul, getNumSites(), numThreads, [this](unsigned long first, unsigned long last) {
+      for (unsigned long siteId = first; siteId < last; ++siteId) {
+        storeSiteStatistics(siteId, getPackedSite(siteId));
+      }
+    });
+    mHasSiteStatistics = true;
+  }
+}
+
+const uint8_t* BedMatrixType::getPackedSite(unsigned long siteId) const {
+  assert(mStorage != BedStorage::Decoded);
+  if (mStorage == BedStorage::Packed) {
+    return mPacked.getSiteBytes(siteId);
   }
-  mNumIndividuals = numIndividuals;
-  gzclose(gzFile);
+  return mBedMapping->data() + bedMagicBytes.size() + mFileSiteIds[siteId] * mBytesPerSite;
 }
 
 unsigned long BedMatrixType::getAlleleCount(unsigned long siteId) const {
   assert(siteId < getNumSites());
-  return mData.col(static_cast<index_t>(siteId)).cast<unsigned long>().sum() -
-         static_cast<unsigned long>(mMissingInt) * getMissingCount(siteId);
+  if (mHasSiteStatistics) {
+    return mAlleleCounts(static_cast<index_t>(siteId));
+  }
+  return countBedRow(getPackedSite(siteId), getNumIndividuals()).getAlleleCount();
 }
 
 rvec_ul_t BedMatrixType::getAlleleCounts() const {
-  return mData.cast<unsigned long>().colwise().sum().array() -
-         (static_cast<unsigned long>(mMissingInt) * mMissingCounts).array();
+  if (mHasSiteStatistics) {
+    return mAlleleCounts;
+  }
+  rvec_ul_t counts(static_cast<index_t>(getNumSites()));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    counts(static_cast<index_t>(siteId)) = getAlleleCount(siteId);
+  }
+  return counts;
+}
+
+BedStorage BedMatrixType::getStorage() const {
+  return mStorage;
 }
 
 unsigned long BedMatrixType::getNumIndividuals() const {
-  return mNumIndividuals;
+  return mFam.getNumIndividuals();
 }
 
 unsigned long BedMatrixType::getNumSites() const {
-  return static_cast<unsigned long>(mGeneticPositions.size());
+  return mBim.getNumSites();
 }
 
 const std::vector<unsigned long>& BedMatrixType::getPhysicalPositions() const {
-  return mPhysicalPositions;
+  return mBim.getPhysicalPositions();
 }
 
 const std::vector<double>& BedMatrixType::getGeneticPositions() const {
-  return mGeneticPositions;
+  return mBim.getGeneticPositions();
 }
 
 const mat_uint8_t& BedMatrixType::getData() const {
+  if (mStorage != BedStorage::Decoded) {
+    throw std::runtime_error("The decoded data matrix is only available for a BedMatrixType loaded with "
+                             "BedStorage::Decoded");
+  }
   return mData;
 }
 
 mat_float_t BedMatrixType::getDataAsFloat() const {
-  return (mData.cast<float>().array() == static_cast<float>(mMissingInt)).select(mMissingFloat, mData.cast<float>());
+  mat_float_t data(static_cast<index_t>(getNumIndividuals()), static_cast<index_t>(getNumSites()));
+  exportData(data);
+  return data;
+}
+
+void BedMatrixType::exportData(Eigen::Ref<mat_float_t> out, const GenotypeExportOptions& options,
+                               unsigned long numThreads) const {
+  checkExportSize(out.rows(), out.cols());
+  exportDataImpl<float>(0ul, out, options, numThreads);
+}
+
+void BedMatrixType::exportData(Eigen::Ref<mat_dbl_t> out, const GenotypeExportOptions& options,
+                               unsigned long numThreads) const {
+  checkExportSize(out.rows(), out.cols());
+  exportDataImpl<double>(0ul, out, options, numThreads);
+}
+
+void BedMatrixType::exportData(Eigen::Ref<mat_int8_t> out, const GenotypeExportOptions& options,
+                               unsigned long numThreads) const {
+  if (options.centre || options.scale) {
+    throw std::runtime_error("Centred or scaled genotypes cannot be exported as int8");
+  }
+  checkExportSize(out.rows(), out.cols());
+  exportDataImpl<int8_t>(0ul, out, options, numThreads);
+}
+
+void BedMatrixType::exportSites(unsigned long firstSite, Eigen::Ref<mat_float_t> out,
+                                const GenotypeExportOptions& options, unsigned long numThreads) const {
+  checkExportRange(firstSite, out.rows(), out.cols());
+  exportDataImpl<float>(firstSite, out, options, numThreads);
+}
+
+void BedMatrixType::exportSites(unsigned long firstSite, Eigen::Ref<mat_dbl_t> out,
+                                const GenotypeExportOptions& options, unsigned long numThreads) const {
+  checkExportRange(firstSite, out.rows(), out.cols());
+  exportDataImpl<double>(firstSite, out, options, numThreads);
+}
+
+void BedMatrixType::checkExportSize(index_t rows, index_t cols) const {
+  if (static_cast<unsigned long>(rows) != getNumIndividuals() || static_cast<unsigned long>(cols) != getNumSites()) {
+    throw std::runtime_error(fmt::format("Expected an output matrix of {} individuals x {} sites, but got {} x {}",
+                                         getNumIndividuals(), getNumSites(), rows, cols));
+  }
+}
+
+void BedMatrixType::checkExportRange(unsigned long firstSite, index_t rows, index_t cols) const {
+  if (static_cast<unsigned long>(rows) != getNumIndividuals()) {
+    throw std::runtime_error(fmt::format("Expected an output matrix with {} rows, one per individual, but got {}",
+                                         getNumIndividuals(), rows));
+  }
+  if (firstSite > getNumSites() || static_cast<unsigned long>(cols) > getNumSites() - firstSite) {
+    throw std::runtime_error(fmt::format("Cannot export {} sites starting from site {}, as there are only {} sites",
+                                         cols, firstSite, getNumSites()));
+  }
+}
+
+template <typename T>
+void BedMatrixType::exportDataImpl(unsigned long firstSite,
+                                   Eigen::Ref<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>> out,
+                                   const GenotypeExportOptions& options, unsigned long numThreads) const {
+  parallelFor(0ul, static_cast<unsigned long>(out.cols()), numThreads, [&](unsigned long first, unsigned long last) {
+    for (unsigned long col = first; col < last; ++col) {
+      const unsigned long siteId = firstSite + col;
+      const unsigned long numObserved = getNumIndividuals() - getMissingCount(siteId);
+      const double mean = numObserved == 0ul ? 0.0
+                                             : static_cast<double>(getAlleleCount(siteId)) /
+                                                   static_cast<double>(numObserved);
+      const double shift = options.centre ? mean : 0.0;
+      const double variance = mean * (1.0 - 0.5 * mean);
+      const double factor = options.scale && variance > 0.0 ? 1.0 / std::sqrt(variance) : 1.0;
+
+      // The output value for each decoded genotype 0, 1, 2, and 3 (missing), so that each genotype is a table lookup
+      std::array<T, 4> values = {};
+      for (unsigned g = 0u; g < 3u; ++g) {
+        values[g] = static_cast<T>((static_cast<double>(g) - shift) * factor);
+      }
+      if constexpr (std::is_floating_point_v<T>) {
+        values[3] = options.impute ? static_cast<T>((mean - shift) * factor) : std::numeric_limits<T>::quiet_NaN();
+      } else {
+        values[3] = options.impute ? static_cast<T>(std::lround(mean)) : static_cast<T>(-1);
+      }
+
+      T* column = out.col(static_cast<index_t>(col)).data();
+      if (mStorage == BedStorage::Decoded) {
+        const uint8_t* genotypes = mData.col(static_cast<index_t>(siteId)).data();
+        for (unsigned long i = 0ul; i < getNumIndividuals(); ++i) {
+          column[i] = values[genotypes[i]];
+        }
+      } else {
+        const std::array<T, 4> valuesByCode = {values[0], values[3], values[1], values[2]};
+        const uint8_t* row = getPackedSite(siteId);
+        const unsigned long numFullBytes = getNumIndividuals() / 4ul;
+        for (unsigned long b = 0ul; b < numFullBytes; ++b) {
+          const unsigned byte = row[b];
+          column[4ul * b] = valuesByCode[byte & 3u];
+          column[4ul * b + 1ul] = valuesByCode[(byte >> 2u) & 3u];
+          column[4ul * b + 2ul] = valuesByCode[(byte >> 4u) & 3u];
+          column[4ul * b + 3ul] = valuesByCode[byte >> 6u];
+        }
+        for (unsigned long i = 4ul * numFullBytes; i < getNumIndividuals(); ++i) {
+          column[i] = valuesByCode[getBedCode(row, i)];
+        }
+      }
+    }
+  });
 }
 
 rvec_uint8_t BedMatrixType::getIndividual(unsigned long individualId) const {
   assert(individualId < getNumIndividuals());
+  if (hasIndividualMajorCache()) {
+    rvec_uint8_t individual(static_cast<index_t>(getNumSites()));
+    getIndividual(individualId, individual);
+    return individual;
+  }
+  if (mStorage != BedStorage::Decoded) {
+    rvec_uint8_t individual(static_cast<index_t>(getNumSites()));
+    // A memory-mapped site holds every individual in the file, which is the same as those loaded
+    for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+      individual(static_cast<index_t>(siteId)) = bedCodeToGenotype[getBedCode(getPackedSite(siteId), individualId)];
+    }
+    return individual;
+  }
   return mData.row(static_cast<index_t>(individualId));
 }
 
+void BedMatrixType::getIndividual(unsigned long individualId, Eigen::Ref<rvec_uint8_t> out) const {
+  assert(individualId < getNumIndividuals());
+  if (static_cast<unsigned long>(out.size()) != getNumSites()) {
+    throw std::runtime_error(
+        fmt::format("Expected an output vector of {} sites, but got {}", getNumSites(), out.size()));
+  }
+  decode_bed_row(getPackedIndividual(individualId), 0ul, getNumSites(), out.data(), 1ul);
+}
+
+const uint8_t* BedMatrixType::getPackedIndividual(unsigned long individualId) const {
+  assert(individualId < getNumIndividuals());
+  cacheIndividualMajor();
+  return reinterpret_cast<const uint8_t*>(mIndividualMajor->words.data() +
+                                          individualId * mIndividualMajor->wordsPerIndividual);
+}
+
+void BedMatrixType::cacheIndividualMajor(unsigned long numThreads) const {
+  std::call_once(mIndividualMajor->built, [this, numThreads]() {
+    buildIndividualMajor(numThreads);
+    mIndividualMajor->isBuilt = true;
+  });
+}
+
+bool BedMatrixType::hasIndividualMajorCache() const {
+  return mIndividualMajor->isBuilt;
+}
+
+void BedMatrixType::buildIndividualMajor(unsigned long numThreads) const {
+  const unsigned long numSites = getNumSites();
+  const unsigned long numIndividuals = getNumIndividuals();
+  const unsigned long wordsPerIndividual = (numSites + 31ul) / 32ul;
+  const unsigned long bytesPerIndividual = wordsPerIndividual * static_cast<unsigned long>(sizeof(uint64_t));
+  mIndividualMajor->wordsPerIndividual = wordsPerIndividual;
+  mIndividualMajor->words.assign(numIndividuals * wordsPerIndividual, 0ull);
+  auto* out = reinterpret_cast<uint8_t*>(mIndividualMajor->words.data());
+
+  // Each thread transposes blocks of whole 64-byte lines of the output rows. Within a block, individuals are taken in
+  // chunks so that the packed input and the output lines being written both stay in cache.
+  constexpr unsigned long chunkIndividuals = 1024ul;
+  constexpr unsigned long chunkBytes = chunkIndividuals / 4ul;
+  const unsigned long numBlocks = (numSites + transposeBlockSites - 1ul) / transposeBlockSites;
+  parallelFor(0ul, numBlocks, numThreads, [&](unsigned long firstBlock, unsigned long lastBlock) {
+    std::vector<uint8_t> chunk(transposeBlockSites * chunkBytes);
+    for (unsigned long block = firstBlock; block < lastBlock; ++block) {
+      const unsigned long blockStart = block * transposeBlockSites;
+      const unsigned long blockSites = std::min(transposeBlockSites, numSites - blockStart);
+      for (unsigned long firstIndividual = 0ul; firstIndividual < numIndividuals; firstIndividual += chunkIndividuals) {
+        const unsigned long numChunkIndividuals = std::min(chunkIndividuals, numIndividuals - firstIndividual);
+        const unsigned long numChunkBytes = (numChunkIndividuals + 3ul) / 4ul;
+
+        // Gather the packed bytes of this chunk of individuals at each site of the block, as rows of a SNP-major tile
+        for (unsigned long i = 0ul; i < blockSites; ++i) {
+          const unsigned long siteId = blockStart + i;
+          uint8_t* row = chunk.data() + i * chunkBytes;
+          if (mStorage == BedStorage::Decoded) {
+            encodeBedRow(mData.col(static_cast<index_t>(siteId)).data() + firstIndividual, numChunkIndividuals, row);
+          } else {
+            std::copy_n(getPackedSite(siteId) + firstIndividual / 4ul, numChunkBytes, row);
+          }
+        }
+
+        // Transposing the tile turns each individual's codes at the block's sites into part of its output row
+        transposeIndividualMajorBed(chunk.data(), chunkBytes, blockSites, 0ul, numChunkIndividuals,
+                                    out + firstIndividual * bytesPerIndividual + blockStart / 4ul, bytesPerIndividual);
+      }
+    }
+  });
+}
+
 cvec_uint8_t BedMatrixType::getSite(unsigned long siteId) const {
   assert(siteId < getNumSites());
+  if (mStorage != BedStorage::Decoded) {
+    cvec_uint8_t site(static_cast<index_t>(getNumIndividuals()));
+    decode_bed_row(getPackedSite(siteId), 0ul, getNumIndividuals(), site.data(), 1ul);
+    return site;
+  }
   return mData.col(static_cast<index_t>(siteId));
 }
 
-const std::vector<std::string>& BedMatrixType::getSiteNames() const {
-  return mSiteNames;
+void BedMatrixType::copyPackedSite(unsigned long siteId, uint8_t* out) const {
+  assert(siteId < getNumSites());
+  if (mStorage == BedStorage::Decoded) {
+    encodeBedRow(mData.col(static_cast<index_t>(siteId)).data(), getNumIndividuals(), out);
+  } else {
+    std::copy_n(getPackedSite(siteId), (getNumIndividuals() + 3ul) / 4ul, out);
+  }
+}
+
+std::vector<std::string> BedMatrixType::getSiteNames() const {
+  return mBim.getSnpIds().toVector();
+}
+
+std::string_view BedMatrixType::getSiteName(unsigned long siteId) const {
+  return mBim.getSnpIds().at(siteId);
+}
+
+std::vector<std::string> BedMatrixType::getChrIds() const {
+  return mBim.getChrIds();
+}
+
+std::vector<std::string> BedMatrixType::getIndividualIds() const {
+  return mFam.getIndividualIds().toVector();
+}
+
+const BimFile& BedMatrixType::getBim() const {
+  return mBim;
+}
+
+const FamFile& BedMatrixType::getFam() const {
+  return mFam;
 }
 
 unsigned long BedMatrixType::getMissingCount(unsigned long siteId) const {
   assert(siteId < getNumSites());
-  return mMissingCounts(static_cast<index_t>(siteId));
+  if (mHasSiteStatistics) {
+    return mMissingCounts(static_cast<index_t>(siteId));
+  }
+  return countBedRow(getPackedSite(siteId), getNumIndividuals()).numMissing;
 }
 
 rvec_ul_t BedMatrixType::getMissingCounts() const {
-  return mMissingCounts;
+  if (mHasSiteStatistics) {
+    return mMissingCounts;
+  }
+  rvec_ul_t counts(static_cast<index_t>(getNumSites()));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    counts(static_cast<index_t>(siteId)) = getMissingCount(siteId);
+  }
+  return counts;
+}
+
+unsigned long BedMatrixType::getHeterozygousCount(unsigned long siteId) const {
+  assert(siteId < getNumSites());
+  if (mHasSiteStatistics) {
+    return mHeterozygousCounts(static_cast<index_t>(siteId));
+  }
+  return countBedRow(getPackedSite(siteId), getNumIndividuals()).numHeterozygous;
+}
+
+rvec_ul_t BedMatrixType::getHeterozygousCounts() const {
+  if (mHasSiteStatistics) {
+    return mHeterozygousCounts;
+  }
+  rvec_ul_t counts(static_cast<index_t>(getNumSites()));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    counts(static_cast<index_t>(siteId)) = getHeterozygousCount(siteId);
+  }
+  return counts;
+}
+
+bool BedMatrixType::hasSiteStatistics() const {
+  return mHasSiteStatistics;
 }
 
 double BedMatrixType::getMissingFrequency(unsigned long siteId) const {
@@ -173,7 +613,7 @@ double BedMatrixType::getMissingFrequency(unsigned long siteId) const {
 }
 
 rvec_dbl_t BedMatrixType::getMissingFrequencies() const {
-  return mMissingCounts.cast<double>().array() / static_cast<double>(getNumIndividuals());
+  return getMissingCounts().cast<double>().array() / static_cast<double>(getNumIndividuals());
 }
 
 unsigned long BedMatrixType::getMinorAlleleCount(unsigned long siteId) const {
@@ -220,20 +660,100 @@ cvec_dbl_t BedMatrixType::getDerivedAlleleFrequencies() const {
          (2.0 * (getNumIndividuals() - getMissingCounts().array()).cast<double>());
 }
 
-void BedMatrixType::writeFrequencies(std::string_view frqFile) {
-
-  rvec_dbl_t freq = getMinorAlleleFrequencies();
-  rvec_ul_t NCHROBS = 2ul * (getNumIndividuals() - mMissingCounts.array());
+void BedMatrixType::writeFrequencies(std::string_view frqFile, unsigned long numThreads) const {
+  const bool compress = fs::path(frqFile).extension() == ".gz";
+  const unsigned long chunksPerRound = resolveNumThreads(numThreads);
+  const unsigned long numChunks = std::max((getNumSites() + frqSitesPerChunk - 1ul) / frqSitesPerChunk, 1ul);
+
+  const std::vector<std::string>& chrNames = mBim.getChrNames();
+  const std::vector<uint16_t>& chrCodes = mBim.getChrCodes();
+  const StringColumn& snpIds = mBim.getSnpIds();
+  const StringColumn& allele1 = mBim.getAllele1();
+  const StringColumn& allele2 = mBim.getAllele2();
+
+  BufferedFileWriter writer(frqFile);
+
+  // Each chunk is formatted, and compressed if required, by one thread. The chunks of one round are written on a
+  // background thread while the next round is formatted.
+  std::array<std::vector<fmt::memory_buffer>, 2> text;
+  std::array<std::vector<std::vector<char>>, 2> compressed;
+  std::future<void> pendingWrite;
+
+  unsigned long round = 0ul;
+  for (unsigned long roundStart = 0ul; roundStart < numChunks; roundStart += chunksPerRound, ++round) {
+    const unsigned long roundChunks = std::min(chunksPerRound, numChunks - roundStart);
+    std::vector<fmt::memory_buffer>& roundText = text[round % 2ul];
+    std::vector<std::vector<char>>& roundCompressed = compressed[round % 2ul];
+    roundText.resize(roundChunks);
+    roundCompressed.resize(roundChunks);
+
+    parallelFor(0ul, roundChunks, numThreads, [&](unsigned long first, unsigned long last) {
+      for (unsigned long chunk = first; chunk < last; ++chunk) {
+        fmt::memory_buffer& buffer = roundText[chunk];
+        buffer.clear();
+        auto out = std::back_inserter(buffer);
+
+        const unsigned long chunkStart = (roundStart + chunk) * frqSitesPerChunk;
+        if (chunkStart == 0ul) {
+          fmt::format_to(out, " CHR           SNP   A1   A2          MAF  NCHROBS\n");
+        }
+        for (unsigned long siteId = chunkStart; siteId < std::min(chunkStart + frqSitesPerChunk, getNumSites());
+             ++siteId) {
+          // The minor allele is the first allele unless the second is strictly less common
+          const unsigned long numObserved = getNumIndividuals() - getMissingCount(siteId);
+          const unsigned long secondCount = getAlleleCount(siteId);
+          const bool secondIsMinor = secondCount < numObserved;
+          const std::string_view minor = secondIsMinor ? allele2[siteId] : allele1[siteId];
+          const std::string_view major = secondIsMinor ? allele1[siteId] : allele2[siteId];
+          const std::string& chrId = chrNames[chrCodes[siteId]];
+          if (numObserved == 0ul) {
+            fmt::format_to(out, "{:>4}{:>14}{:>5}{:>5}{:>13}{:>9}\n", chrId, snpIds[siteId], minor, major,
+                           "NA", 0);
+          } else {
+            const unsigned long minorCount = secondIsMinor ? secondCount : 2ul * numObserved - secondCount;
+            const double maf = static_cast<double>(minorCount) / (2.0 * static_cast<double>(numObserved));
+            fmt::format_to(out, "{:>4}{:>14}{:>5}{:>5}{:>13.4g}{:>9}\n", chrId, snpIds[siteId], minor, major,
+                           maf, 2ul * numObserved);
+          }
+        }
+
+        if (compress) {
+          compressGzipMember(buffer.data(), buffer.size(), roundCompressed[chunk]);
+        }
+      }
+    });
+
+    if (pendingWrite.valid()) {
+      pendingWrite.get();
+    }
+    pendingWrite = std::async(std::launch::async, [&writer, &roundText, &roundCompressed, compress]() {
+      for (unsigned long chunk = 0ul; chunk < roundText.size(); ++chunk) {
+        if (compress) {
+          writer.write(roundCompressed[chunk].data(), roundCompressed[chunk].size());
+        } else {
+          writer.write(roundText[chunk].data(), roundText[chunk].size());
+        }
+      }
+    });
+  }
 
-  FILE* fp = std::fopen(frqFile.data(), "w");
-  fmt::print(fp, " CHR           SNP   A1   A2          MAF  NCHROBS\n", freq[0], NCHROBS[0]);
+  pendingWrite.get();
+  writer.close();
+}
 
-  for (unsigned long i = 0ul; i < getNumSites(); ++i) {
-    auto ii = static_cast<index_t>(i);
-    fmt::print(fp, "{:>4}{:>14}{:>5}{:>5}{:>13}{:>9}\n", 1, mSiteNames.at(i), 1, 2, freq[ii], NCHROBS[ii]);
+void BedMatrixType::writeBedBimFam(std::string_view bedFile, std::string_view bimFile, std::string_view famFile,
+                                   unsigned long numThreads) const {
+  if (mStorage == BedStorage::Decoded) {
+    asmc::writeBedBimFam(bedFile, bimFile, famFile, mData, mBim, mFam, numThreads);
+    return;
   }
 
-  std::fclose(fp);
+  writeBedFile(
+      bedFile, getNumSites(), getNumIndividuals(),
+      [this](unsigned long siteId, uint8_t* out) { copyPackedSite(siteId, out); },
+      numThreads);
+  mBim.write(bimFile);
+  mFam.write(famFile);
 }
 
 } // namespace asmc
@@ -4,10 +4,18 @@
 #ifndef DATA_MODULE_BED_MATRIX_TYPE_HPP
 #define DATA_MODULE_BED_MATRIX_TYPE_HPP
 
+#include "BimFile.hpp"
 #include "EigenTypes.hpp"
+#include "FamFile.hpp"
+#include "PackedGenotypeMatrix.hpp"
 
+#include <atomic>
 #include <filesystem>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -15,6 +23,80 @@ namespace asmc {
 
 namespace fs = std::filesystem;
 
+class MemoryMappedFile;
+
+/**
+ * How the genotype data from a .bed file is held in memory.
+ */
+enum class BedStorage {
+  /** Decode every genotype into a #individuals x #sites matrix of uint8_t when the fileset is loaded */
+  Decoded,
+  /** Memory map the .bed file, and decode genotypes from the mapped bytes only when they are requested */
+  MemoryMapped,
+  /** Hold the genotypes at 2 bits per call, a quarter of the memory of Decoded, and decode them when requested */
+  Packed,
+};
+
+/**
+ * Options controlling how BedMatrixType::createFromBedBimFam loads a PLINK fileset.
+ */
+struct BedLoadOptions {
+  /** How the genotype data is held in memory */
+  BedStorage storage = BedStorage::Decoded;
+
+  /**
+   * The number of threads used to read and decode the .bed file, and to decompress BGZF .bim and .fam files, where 0
+   * means one per hardware thread
+   */
+  unsigned long numThreads = 1ul;
+
+  /**
+   * Whether to count missing, heterozygous and second-allele genotypes at each site while the .bed file is read, so
+   * that count and frequency getters do not rescan the genotypes. BedStorage::Decoded always caches these counts.
+   */
+  bool cacheSiteStatistics = false;
+
+  /**
+   * Whether to load the .bim and .fam files from binary sidecars written next to them on a previous load, which is
+   * much faster than parsing the text. Sidecars are rewritten whenever they are missing, or whenever the file's size or
+   * modification time no longer matches.
+   */
+  bool useMetadataCache = false;
+
+  /** If not empty, only load individuals whose individual ID (IID) is in this list */
+  std::vector<std::string> keepIndividualIds;
+
+  /** If not empty, only load sites whose ID is in this list */
+  std::vector<std::string> extractSiteIds;
+
+  /** If not empty, only load sites on this chromosome */
+  std::string chromosome;
+
+  /** Only load sites with a physical position of at least regionStart */
+  unsigned long regionStart = 0ul;
+
+  /** Only load sites with a physical position of at most regionEnd */
+  unsigned long regionEnd = std::numeric_limits<unsigned long>::max();
+};
+
+/**
+ * Options controlling how BedMatrixType::exportData transforms genotypes as it writes them. Each site is transformed
+ * using its non-missing genotypes, whose mean is 2p for allele frequency p.
+ */
+struct GenotypeExportOptions {
+  /** Replace missing genotypes with the site mean, rather than NaN (floating point) or -1 (int8) */
+  bool impute = false;
+
+  /** Subtract the site mean from each genotype. Not available for int8 output */
+  bool centre = false;
+
+  /**
+   * Divide each genotype by sqrt(2p(1-p)), the standard deviation under Hardy-Weinberg equilibrium; monomorphic sites
+   * are left unscaled. Not available for int8 output
+   */
+  bool scale = false;
+};
+
 /**
  * A class that stores information in a #sites x #haps matrix of booleans.
  */
@@ -22,23 +104,38 @@ class BedMatrixType {
 
 private:
 
-  /** The number of individuals */
-  unsigned long mNumIndividuals = 0ul;
+  /** How the genotype data is held in memory */
+  BedStorage mStorage = BedStorage::Decoded;
+
+  /** The sites that were loaded, read from the .bim file */
+  BimFile mBim;
+
+  /** The individuals that were loaded, read from the .fam file */
+  FamFile mFam;
 
-  /** The names of each site */
-  std::vector<std::string> mSiteNames;
+  /** The number of sites in the .bed file, which may be more than the number loaded */
+  unsigned long mFileNumSites = 0ul;
 
-  /** The physical positions of each site */
-  std::vector<unsigned long> mPhysicalPositions;
+  /** The number of individuals in the .bed file, which may be more than the number loaded */
+  unsigned long mFileNumIndividuals = 0ul;
 
-  /** The genetic positions, in centimorgans, of each site */
-  std::vector<double> mGeneticPositions;
+  /** For each loaded site, its index in the .bed file */
+  std::vector<unsigned long> mFileSiteIds;
+
+  /** For each loaded individual, its index in the .bed file */
+  std::vector<unsigned long> mFileIndividualIds;
 
   /** The #sites x #haps matrix of booleans, where #haps is 2x #individuals */
   mat_uint8_t mData;
 
-  /** The detected delimeter used in the .fam file */
-  std::string mFamDelimeter = " ";
+  /** The mapped .bed file, used instead of mData for BedStorage::MemoryMapped */
+  std::shared_ptr<const MemoryMappedFile> mBedMapping;
+
+  /** The packed genotypes, used instead of mData for BedStorage::Packed */
+  PackedGenotypeMatrix mPacked;
+
+  /** The number of bytes used by each site in the .bed file */
+  unsigned long mBytesPerSite = 0ul;
 
   /** The value of missing data in integer format */
   const long mMissingInt = 3l;
@@ -46,29 +143,142 @@ private:
   /** The value of missing data in floating format */
   const float mMissingFloat = std::numeric_limits<float>::quiet_NaN();
 
+  /** Whether mMissingCounts, mAlleleCounts and mHeterozygousCounts hold the counts for every site */
+  bool mHasSiteStatistics = false;
+
   /** A row vector of the number of missing pieces of data for each site */
   rvec_ul_t mMissingCounts;
 
-  /** Determine the appropriate delimiters for the .fam file */
-  void determineFamDelimiter(const fs::path& famFile);
+  /** A row vector of the number of copies of the second allele at each site */
+  rvec_ul_t mAlleleCounts;
+
+  /** A row vector of the number of heterozygous individuals at each site */
+  rvec_ul_t mHeterozygousCounts;
+
+  /**
+   * A copy of the genotypes in individual-major layout: one row per individual of 2-bit .bed codes, one per site, with
+   * each row padded with zero codes to a whole number of 64-bit words. It is built at most once, on first use.
+   */
+  struct IndividualMajorCache {
+    std::once_flag built;
+    std::atomic<bool> isBuilt = false;
+    unsigned long wordsPerIndividual = 0ul;
+    std::vector<uint64_t> words;
+  };
+
+  /** The individual-major copy, shared between copies of this object as the genotypes never change after loading */
+  std::shared_ptr<IndividualMajorCache> mIndividualMajor = std::make_shared<IndividualMajorCache>();
+
+  /**
+   * Size the cached per-site counts, ready to be filled by storeSiteStatistics.
+   */
+  void allocateSiteStatistics();
+
+  /**
+   * Count the genotypes in a row of packed bytes and cache the counts for the given site.
+   * @param siteId the site ID
+   * @param row pointer to the packed bytes of the site
+   */
+  void storeSiteStatistics(unsigned long siteId, const uint8_t* row);
+
+  /**
+   * Fill the individual-major cache with a blocked 2-bit transpose of the genotypes.
+   * @param numThreads the number of threads to use
+   */
+  void buildIndividualMajor(unsigned long numThreads) const;
+
+  /**
+   * Select the sites and individuals to load, and store their metadata.
+   * @param bim the full contents of the .bim file
+   * @param fam the full contents of the .fam file
+   * @param options the load options specifying which sites and individuals to keep
+   */
+  void selectSubset(const BimFile& bim, const FamFile& fam, const BedLoadOptions& options);
+
+  /**
+   * @return whether only some of the individuals in the .bed file were loaded
+   */
+  [[nodiscard]] bool isIndividualSubset() const;
 
   /**
    * Read data from the .bed file.
    * @param bedFile path to the .bed file
+   * @param numThreads the number of threads to use
+   */
+  void readBedFile(const fs::path& bedFile, unsigned long numThreads);
+
+  /**
+   * Read the packed genotypes from the .bed file without decoding them.
+   * @param bedFile path to the .bed file
+   * @param numThreads the number of threads to use
+   * @param cacheSiteStatistics whether to cache the per-site counts while reading
+   */
+  void readPackedBedFile(const fs::path& bedFile, unsigned long numThreads, bool cacheSiteStatistics);
+
+  /**
+   * Validate the .bed file and pass the packed bytes of each loaded site to a callback. The range of sites is split
+   * between threads, each of which reads its sites with positioned reads, so the callback may be called concurrently
+   * for different sites. If only some individuals are loaded, the bytes passed contain only those individuals.
+   * @param bedFile path to the .bed file
+   * @param numThreads the number of threads to use
+   * @param processSite callback taking a site ID and a pointer to the packed bytes of that site
+   */
+  void readBedRows(const fs::path& bedFile, unsigned long numThreads,
+                   const std::function<void(unsigned long, const uint8_t*)>& processSite) const;
+
+  /**
+   * Pass the packed bytes of each loaded site in an individual-major .bed file to a callback, as for readBedRows. The
+   * file is memory mapped and transposed to SNP-major rows in blocks of sites, each of which is shared by the sites
+   * loaded from it.
+   * @param bedFile path to the .bed file, which has already been validated
+   * @param numThreads the number of threads to use
+   * @param processSite callback taking a site ID and a pointer to the packed bytes of that site
+   */
+  void readIndividualMajorBedRows(const fs::path& bedFile, unsigned long numThreads,
+                                  const std::function<void(unsigned long, const uint8_t*)>& processSite) const;
+
+  /**
+   * Memory map the .bed file, checking its header and that its size matches the .bim and .fam files.
+   * @param bedFile path to the .bed file
+   * @param numThreads the number of threads to use
+   * @param cacheSiteStatistics whether to scan the mapped file once to cache the per-site counts
+   */
+  void mapBedFile(const fs::path& bedFile, unsigned long numThreads, bool cacheSiteStatistics);
+
+  /**
+   * Throw a std::runtime_error unless an output matrix has one row per individual and one column per site.
+   * @param rows the number of rows in the output matrix
+   * @param cols the number of columns in the output matrix
+   */
+  void checkExportSize(index_t rows, index_t cols) const;
+
+  /**
+   * Throw a std::runtime_error unless an output matrix has one row per individual, and its columns hold sites that
+   * exist when starting from firstSite.
+   * @param firstSite the site written to the first column of the output matrix
+   * @param rows the number of rows in the output matrix
+   * @param cols the number of columns in the output matrix
    */
-  void readBedFile(const fs::path& bedFile);
+  void checkExportRange(unsigned long firstSite, index_t rows, index_t cols) const;
 
   /**
-   * Read data from the .bim file.
-   * @param bimFile path to the .bim file
+   * Write transformed genotypes of sites firstSite onwards into out, one site per column, as described for exportData.
+   * @tparam T the output scalar type
+   * @param firstSite the site written to the first column of out
+   * @param out the matrix to write to
+   * @param options how to transform the genotypes
+   * @param numThreads the number of threads to use
    */
-  void readBimFile(const fs::path& bimFile);
+  template <typename T>
+  void exportDataImpl(unsigned long firstSite, Eigen::Ref<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>> out,
+                      const GenotypeExportOptions& options, unsigned long numThreads) const;
 
   /**
-   * Read data from the .fam file.
-   * @param famFile path to the .fam file
+   * Get the packed .bed bytes for a given site. Only valid for storage other than BedStorage::Decoded.
+   * @param siteId the site ID
+   * @return pointer to the first byte of the site in the .bed file
    */
-  void readFamFile(const fs::path& famFile);
+  [[nodiscard]] const uint8_t* getPackedSite(unsigned long siteId) const;
 
   /**
    * Get the raw allele count for a given site.
@@ -95,10 +305,16 @@ public:
    * @param hapsFile path to the .bed file
    * @param samplesFile path to the .bim file
    * @param mapFile path to the .fam file
+   * @param options options controlling how the fileset is loaded
    * @return instance of a HapsMatrixType
    */
   static BedMatrixType createFromBedBimFam(std::string_view bedFile, std::string_view bimFile,
-                                           std::string_view famFile);
+                                           std::string_view famFile, const BedLoadOptions& options = {});
+
+  /**
+   * @return how the genotype data is held in memory
+   */
+  [[nodiscard]] BedStorage getStorage() const;
 
   /**
    * @return the number of individuals, determined from the .fam file
@@ -121,11 +337,41 @@ public:
   [[nodiscard]] const std::vector<double>& getGeneticPositions() const;
 
   /**
-   * @return a vector of variant names, read in from the .bim file
+   * Copy the variant names, read in from the .bim file, into a new vector. The names are held in a StringColumn, so
+   * this takes time and memory proportional to the number of sites: use getSiteName() to look up single sites.
+   *
+   * @return a new vector of variant names
+   */
+  [[nodiscard]] std::vector<std::string> getSiteNames() const;
+
+  /**
+   * @param siteId the site index
+   * @return a view of the name of the variant, read in from the .bim file, which is valid while this matrix exists
    */
-  [[nodiscard]] const std::vector<std::string>& getSiteNames() const;
+  [[nodiscard]] std::string_view getSiteName(unsigned long siteId) const;
 
   /**
+   * @return a vector of chromosome IDs, read in from the .bim file
+   */
+  [[nodiscard]] std::vector<std::string> getChrIds() const;
+
+  /**
+   * @return a vector of individual IDs (IID), read in from the .fam file
+   */
+  [[nodiscard]] std::vector<std::string> getIndividualIds() const;
+
+  /**
+   * @return the .bim metadata of the loaded sites
+   */
+  [[nodiscard]] const BimFile& getBim() const;
+
+  /**
+   * @return the .fam metadata of the loaded individuals
+   */
+  [[nodiscard]] const FamFile& getFam() const;
+
+  /**
+   * The decoded data matrix is only available with BedStorage::Decoded: a std::runtime_error will be thrown otherwise.
    * @return the vector of raw uint8_t data, contained in the .bed file with 3 representing missing data
    */
   [[nodiscard]] const mat_uint8_t& getData() const;
@@ -135,6 +381,53 @@ public:
    */
   [[nodiscard]] mat_float_t getDataAsFloat() const;
 
+  /**
+   * Write the genotypes into a caller-provided #individuals x #sites matrix, optionally imputing, centring and scaling
+   * each site in the same pass. Nothing is allocated, so the output may be a block of a larger matrix passed directly
+   * to a linear algebra routine. A std::runtime_error will be thrown if the output has the wrong size.
+   *
+   * @param out the matrix to write to
+   * @param options how to transform the genotypes
+   * @param numThreads the number of threads to use, where 0 means one per hardware thread
+   */
+  void exportData(Eigen::Ref<mat_float_t> out, const GenotypeExportOptions& options = {},
+                  unsigned long numThreads = 1ul) const;
+
+  /**
+   * Write the genotypes into a caller-provided #individuals x #sites matrix of doubles, as for the float overload.
+   */
+  void exportData(Eigen::Ref<mat_dbl_t> out, const GenotypeExportOptions& options = {},
+                  unsigned long numThreads = 1ul) const;
+
+  /**
+   * Write the genotypes into a caller-provided #individuals x #sites matrix of int8, with missing data as -1 unless
+   * imputed to the nearest integer to the site mean. A std::runtime_error will be thrown if centring or scaling is
+   * requested.
+   */
+  void exportData(Eigen::Ref<mat_int8_t> out, const GenotypeExportOptions& options = {},
+                  unsigned long numThreads = 1ul) const;
+
+  /**
+   * Write the genotypes of a contiguous range of sites into a caller-provided matrix, as for exportData, so that
+   * the genotypes can be processed a block of sites at a time. The range starts at firstSite and has one site per
+   * column of out. A std::runtime_error will be thrown if out does not have one row per individual, or if the range
+   * extends beyond the last site.
+   *
+   * @param firstSite the site written to the first column of out
+   * @param out the #individuals x #block sites matrix to write to
+   * @param options how to transform the genotypes
+   * @param numThreads the number of threads to use, where 0 means one per hardware thread
+   */
+  void exportSites(unsigned long firstSite, Eigen::Ref<mat_float_t> out, const GenotypeExportOptions& options = {},
+                   unsigned long numThreads = 1ul) const;
+
+  /**
+   * Write the genotypes of a contiguous range of sites into a caller-provided matrix of doubles, as for the float
+   * overload.
+   */
+  void exportSites(unsigned long firstSite, Eigen::Ref<mat_dbl_t> out, const GenotypeExportOptions& options = {},
+                   unsigned long numThreads = 1ul) const;
+
   /**
    * Get all variant data for a single individual.
    *
@@ -143,6 +436,39 @@ public:
    */
   [[nodiscard]] rvec_uint8_t getIndividual(unsigned long individualId) const;
 
+  /**
+   * Get all variant data for a single individual, decoded into a caller-provided row vector with one entry per site.
+   * The genotypes are read sequentially from the individual-major copy, which is built on first use, and nothing is
+   * allocated. A std::runtime_error will be thrown if the output has the wrong size.
+   *
+   * @param individualId the id of the individual
+   * @param out the row vector to write to, with 3 representing missing data
+   */
+  void getIndividual(unsigned long individualId, Eigen::Ref<rvec_uint8_t> out) const;
+
+  /**
+   * Get the genotypes of a single individual, packed at 2 bits per site with the .bed encoding, from the
+   * individual-major copy, which is built on first use. Codes beyond the last site are zero.
+   *
+   * @param individualId the id of the individual
+   * @return pointer to the (#sites + 3) / 4 bytes of the individual's genotypes
+   */
+  [[nodiscard]] const uint8_t* getPackedIndividual(unsigned long individualId) const;
+
+  /**
+   * Build the individual-major copy of the genotypes now, rather than on the first per-individual access, using
+   * several threads. The copy uses (#sites + 3) / 4 bytes per individual, rounded up to a multiple of 8. Once it
+   * exists, getIndividual also reads from it. Calling this again has no effect.
+   *
+   * @param numThreads the number of threads to use, where 0 means one per hardware thread
+   */
+  void cacheIndividualMajor(unsigned long numThreads = 1ul) const;
+
+  /**
+   * @return whether the individual-major copy of the genotypes has been built
+   */
+  [[nodiscard]] bool hasIndividualMajorCache() const;
+
   /**
    * Get all individual data for a single site.
    *
@@ -151,6 +477,14 @@ public:
    */
   [[nodiscard]] cvec_uint8_t getSite(unsigned long siteId) const;
 
+  /**
+   * Copy the genotypes of a single site, packed at 2 bits per individual in SNP-major .bed layout, for any storage.
+   *
+   * @param siteId the id of the site
+   * @param out pointer to (#individuals + 3) / 4 bytes to receive the packed genotypes
+   */
+  void copyPackedSite(unsigned long siteId, uint8_t* out) const;
+
   /**
    * Get the count of missing data for a given site.
    * @param siteId the site ID
@@ -164,6 +498,24 @@ public:
    */
   [[nodiscard]] rvec_ul_t getMissingCounts() const;
 
+  /**
+   * Get the number of heterozygous individuals at a given site.
+   * @param siteId the site ID
+   * @return the number of heterozygous individuals at the given site
+   */
+  [[nodiscard]] unsigned long getHeterozygousCount(unsigned long siteId) const;
+
+  /**
+   * Get the number of heterozygous individuals at all sites.
+   * @return a vector of counts, one for each site
+   */
+  [[nodiscard]] rvec_ul_t getHeterozygousCounts() const;
+
+  /**
+   * @return whether per-site counts were cached when the fileset was loaded
+   */
+  [[nodiscard]] bool hasSiteStatistics() const;
+
   /**
    * Get the frequency of missing data for a given site.
    * @param siteId the site ID
@@ -230,11 +582,30 @@ public:
   [[nodiscard]] cvec_dbl_t getDerivedAlleleFrequencies() const;
 
   /**
-   * Write a .frq file containing the frequency data.
+   * Write a PLINK .frq file with the minor allele frequency of each site. Each line holds the chromosome, site ID,
+   * minor (A1) and major (A2) allele codes from the .bim file, the minor allele frequency, and the number of observed
+   * allele copies; the frequency is NA if every genotype at the site is missing.
+   *
+   * Lines are formatted by several threads, in chunks that are written while the next chunks are formatted. If the
+   * path ends in .gz the file is gzip-compressed, with each chunk compressed by its thread as a separate gzip member.
+   * A std::runtime_error will be thrown if the file cannot be written.
+   *
+   * @param frqFile path to the .frq or .frq.gz file to write to
+   * @param numThreads the number of threads to use, where 0 means one per hardware thread
+   */
+  void writeFrequencies(std::string_view frqFile, unsigned long numThreads = 1ul) const;
+
+  /**
+   * Write the loaded sites and individuals to a SNP-major PLINK fileset. Packed and memory-mapped genotypes are copied
+   * without being decoded, and decoded genotypes are packed in parallel.
    *
-   * @param frqFile path to the .frq file to write to
+   * @param bedFile path to the .bed file to write
+   * @param bimFile path to the .bim file to write
+   * @param famFile path to the .fam file to write
+   * @param numThreads the number of threads used to pack sites, where 0 means one per hardware thread
    */
-  void writeFrequencies(std::string_view frqFile);
+  void writeBedBimFam(std::string_view bedFile, std::string_view bimFile, std::string_view famFile,
+                      unsigned long numThreads = 1ul) const;
 };
 
 } // namespace asmc
@@ -0,0 +1,90 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedWriter.hpp"
+
+#include "utils/BedUtils.hpp"
+#include "utils/BufferedFileWriter.hpp"
+#include "utils/ThreadUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <future>
+#include <vector>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+namespace {
+
+/** Target number of bytes packed by each thread in each round before the round is written */
+constexpr unsigned long bedWriteBytesPerThread = 1ul << 22;
+
+} // namespace
+
+void writeBedFile(std::string_view bedFile, unsigned long numSites, unsigned long numIndividuals,
+                  const std::function<void(unsigned long, uint8_t*)>& packSite, unsigned long numThreads) {
+  BufferedFileWriter writer(bedFile);
+  writer.write(bedMagicBytes.data(), bedMagicBytes.size());
+
+  const unsigned long bytesPerSite = (numIndividuals + 3ul) / 4ul;
+  if (bytesPerSite > 0ul && numSites > 0ul) {
+    const unsigned long sitesPerThread = std::max(bedWriteBytesPerThread / bytesPerSite, 1ul);
+    const unsigned long sitesPerRound = std::min(sitesPerThread * resolveNumThreads(numThreads), numSites);
+
+    // One buffer is packed while the other is written on a background thread
+    std::array<std::vector<uint8_t>, 2> buffers;
+    std::future<void> pendingWrite;
+
+    unsigned long round = 0ul;
+    for (unsigned long roundStart = 0ul; roundStart < numSites; roundStart += sitesPerRound, ++round) {
+      const unsigned long roundSites = std::min(sitesPerRound, numSites - roundStart);
+      std::vector<uint8_t>& buffer = buffers[round % 2ul];
+      buffer.resize(roundSites * bytesPerSite);
+
+      parallelFor(roundStart, roundStart + roundSites, numThreads, [&](unsigned long first, unsigned long last) {
+        for (unsigned long siteId = first; siteId < last; ++siteId) {
+          packSite(siteId, buffer.data() + (siteId - roundStart) * bytesPerSite);
+        }
+      });
+
+      if (pendingWrite.valid()) {
+        pendingWrite.get();
+      }
+      pendingWrite = std::async(std::launch::async,
+                                [&writer, &buffer]() { writer.write(buffer.data(), buffer.size()); });
+    }
+
+    pendingWrite.get();
+  }
+
+  writer.close();
+}
+
+void writeBedFile(std::string_view bedFile, const Eigen::Ref<const mat_uint8_t>& data, unsigned long numThreads) {
+  const auto numIndividuals = static_cast<unsigned long>(data.rows());
+  writeBedFile(
+      bedFile, static_cast<unsigned long>(data.cols()), numIndividuals,
+      [&data, numIndividuals](unsigned long siteId, uint8_t* out) {
+        encodeBedRow(data.col(static_cast<index_t>(siteId)).data(), numIndividuals, out);
+      },
+      numThreads);
+}
+
+void writeBedBimFam(std::string_view bedFile, std::string_view bimFile, std::string_view famFile,
+                    const Eigen::Ref<const mat_uint8_t>& data, const BimFile& bim, const FamFile& fam,
+                    unsigned long numThreads) {
+  if (static_cast<unsigned long>(data.cols()) != bim.getNumSites() ||
+      static_cast<unsigned long>(data.rows()) != fam.getNumIndividuals()) {
+    throw std::runtime_error(fmt::format("Cannot write a fileset with {} individuals and {} sites, as the metadata "
+                                         "describes {} individuals and {} sites",
+                                         data.rows(), data.cols(), fam.getNumIndividuals(), bim.getNumSites()));
+  }
+  writeBedFile(bedFile, data, numThreads);
+  bim.write(bimFile);
+  fam.write(famFile);
+}
+
+} // namespace asmc
@@ -0,0 +1,59 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_BED_WRITER_HPP
+#define DATA_MODULE_BED_WRITER_HPP
+
+#include "BimFile.hpp"
+#include "EigenTypes.hpp"
+#include "FamFile.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace asmc {
+
+/**
+ * Write a SNP-major PLINK .bed file site by site. Sites are packed in parallel, in rounds of several megabytes per
+ * thread, and each round is written to the file with a single large write while the next round is packed.
+ *
+ * @param bedFile path to the .bed file to write
+ * @param numSites the number of sites
+ * @param numIndividuals the number of individuals
+ * @param packSite callback taking a site ID and a pointer to (numIndividuals + 3) / 4 bytes, which it must fill with
+ * the packed genotypes of that site; it may be called concurrently for different sites
+ * @param numThreads the number of threads used to pack sites, where 0 means one per hardware thread
+ */
+void writeBedFile(std::string_view bedFile, unsigned long numSites, unsigned long numIndividuals,
+                  const std::function<void(unsigned long, uint8_t*)>& packSite, unsigned long numThreads = 1ul);
+
+/**
+ * Write a #individuals x #sites matrix of decoded genotypes to a SNP-major PLINK .bed file. Values are 0, 1 or 2
+ * copies of the second allele, or 3 for missing data, as returned by BedMatrixType::getData().
+ *
+ * @param bedFile path to the .bed file to write
+ * @param data the genotypes, which may be a block of a larger matrix
+ * @param numThreads the number of threads used to pack sites, where 0 means one per hardware thread
+ */
+void writeBedFile(std::string_view bedFile, const Eigen::Ref<const mat_uint8_t>& data, unsigned long numThreads = 1ul);
+
+/**
+ * Write a #individuals x #sites matrix of decoded genotypes to a PLINK fileset, with matching .bim and .fam files. A
+ * std::runtime_error will be thrown if the number of sites or individuals in the metadata does not match the data.
+ *
+ * @param bedFile path to the .bed file to write
+ * @param bimFile path to the .bim file to write
+ * @param famFile path to the .fam file to write
+ * @param data the genotypes, which may be a block of a larger matrix
+ * @param bim the sites, one per column of data
+ * @param fam the individuals, one per row of data
+ * @param numThreads the number of threads used to pack sites, where 0 means one per hardware thread
+ */
+void writeBedBimFam(std::string_view bedFile, std::string_view bimFile, std::string_view famFile,
+                    const Eigen::Ref<const mat_uint8_t>& data, const BimFile& bim, const FamFile& fam,
+                    unsigned long numThreads = 1ul);
+
+} // namespace asmc
+
+#endif // DATA_MODULE_BED_WRITER_HPP
@@ -0,0 +1,268 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BimFile.hpp"
+
+#include "utils/BufferedFileWriter.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/MetadataCache.hpp"
+#include "utils/StringUtils.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+namespace {
+
+/** Whether the standard library provides std::from_chars for floating point types; if not, strtod is used */
+#if defined(__cpp_lib_to_chars)
+constexpr bool hasFloatingPointFromChars = true;
+#else
+constexpr bool hasFloatingPointFromChars = false;
+#endif
+
+/**
+ * Parse a whole field as a number, allowing a leading '+'.
+ *
+ * @param field the text of the field
+ * @param value the number, if the field is valid
+ * @return whether the field is a valid number with no trailing characters
+ */
+template <typename T> bool parseNumber(std::string_view field, T& value) {
+  if (!field.empty() && field.front() == '+') {
+    field.remove_prefix(1ul);
+  }
+  if (field.empty()) {
+    return false;
+  }
+  if constexpr (std::is_floating_point_v<T> && !hasFloatingPointFromChars) {
+    const std::string copy(field);
+    char* parsedEnd = nullptr;
+    value = static_cast<T>(std::strtod(copy.c_str(), &parsedEnd));
+    return parsedEnd == copy.c_str() + copy.size();
+  } else {
+    const auto [parsedEnd, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return ec == std::errc() && parsedEnd == field.data() + field.size();
+  }
+}
+
+} // namespace
+
+BimFile::BimFile(std::string_view bimFile, bool useCache, unsigned long numThreads) : mInputFile{bimFile} {
+  if (!fs::is_regular_file(mInputFile)) {
+    throw std::runtime_error(fmt::format("Error: .bim file {} does not exist\n", mInputFile.string()));
+  }
+  if (useCache && readCache()) {
+    return;
+  }
+  readFile(numThreads);
+  if (useCache) {
+    writeCache();
+  }
+}
+
+void BimFile::readFile(unsigned long numThreads) {
+  withFileContents(mInputFile, [this](std::string_view text) { parse(text); }, numThreads);
+}
+
+void BimFile::parse(std::string_view text) {
+  const std::size_t maxNumSites = countLines(text);
+  mChrCodes.reserve(maxNumSites);
+  mSnpIds.reserve(maxNumSites, 0ul);
+  mGeneticPositions.reserve(maxNumSites);
+  mPhysicalPositions.reserve(maxNumSites);
+  mAllele1.reserve(maxNumSites, 0ul);
+  mAllele2.reserve(maxNumSites, 0ul);
+
+  // Sites are usually grouped by chromosome, so most lines match the previous line's chromosome
+  std::unordered_map<std::string_view, uint16_t> chrCodes;
+  std::string_view previousChr;
+  uint16_t previousCode = 0u;
+
+  std::vector<std::string_view> fields;
+  while (!text.empty()) {
+    const std::string_view line = popLine(text);
+    if (line.empty()) {
+      continue;
+    }
+
+    splitIntoViews(line, '\t', fields);
+    if (fields.size() != 6ul) {
+      throw std::runtime_error(fmt::format("Error: .bim file {} line {} contains {} columns, but should contain 6\n",
+                                           mInputFile.string(), 1ul + mSnpIds.size(), fields.size()));
+    }
+
+    double geneticPosition = 0.0;
+    unsigned long physicalPosition = 0ul;
+    if (!parseNumber(fields[2], geneticPosition) || !parseNumber(fields[3], physicalPosition)) {
+      throw std::runtime_error(fmt::format(
+          "Error: .bim file {} line {} should contain a floating point genetic position in the third column and an "
+          "unsigned integer physical position in the fourth column, but found {} and {}\n",
+          mInputFile.string(), 1ul + mSnpIds.size(), fields[2], fields[3]));
+    }
+
+    if (mChrCodes.empty() || fields[0] != previousChr) {
+      const auto [it, inserted] = chrCodes.try_emplace(fields[0], static_cast<uint16_t>(mChrNames.size()));
+      if (inserted) {
+        if (mChrNames.size() > std::numeric_limits<uint16_t>::max()) {
+          throw std::runtime_error(fmt::format("Error: .bim file {} contains more than {} distinct chromosome IDs\n",
+                                               mInputFile.string(), 1ul + std::numeric_limits<uint16_t>::max()));
+        }
+        mChrNames.emplace_back(fields[0]);
+      }
+      previousChr = fields[0];
+      previousCode = it->second;
+    }
+
+    mChrCodes.emplace_back(previousCode);
+    mSnpIds.push_back(fields[1]);
+    mGeneticPositions.emplace_back(geneticPosition);
+    mPhysicalPositions.emplace_back(physicalPosition);
+    mAllele1.push_back(fields[4]);
+    mAllele2.push_back(fields[5]);
+  }
+}
+
+bool BimFile::readCache() {
+  auto cache = MetadataCacheReader::open(mInputFile, "bim");
+  if (!cache) {
+    return false;
+  }
+
+  try {
+    std::vector<std::string> chrNames = cache->readStrings().toVector();
+    std::vector<uint16_t> chrCodes = cache->readVector<uint16_t>();
+    StringColumn snpIds = cache->readStrings();
+    std::vector<double> geneticPositions = cache->readVector<double>();
+    std::vector<unsigned long> physicalPositions = cache->readVector<unsigned long>();
+    StringColumn allele1 = cache->readStrings();
+    StringColumn allele2 = cache->readStrings();
+
+    const std::size_t numSites = chrCodes.size();
+    if (snpIds.size() != numSites || geneticPositions.size() != numSites || physicalPositions.size() != numSites ||
+        allele1.size() != numSites || allele2.size() != numSites) {
+      return false;
+    }
+
+    mChrNames = std::move(chrNames);
+    mChrCodes = std::move(chrCodes);
+    mSnpIds = std::move(snpIds);
+    mGeneticPositions = std::move(geneticPositions);
+    mPhysicalPositions = std::move(physicalPositions);
+    mAllele1 = std::move(allele1);
+    mAllele2 = std::move(allele2);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+  return true;
+}
+
+void BimFile::writeCache() const {
+  MetadataCacheWriter cache("bim");
+  cache.writeStrings(mChrNames);
+  cache.writeVector(mChrCodes);
+  cache.writeStrings(mSnpIds);
+  cache.writeVector(mGeneticPositions);
+  cache.writeVector(mPhysicalPositions);
+  cache.writeStrings(mAllele1);
+  cache.writeStrings(mAllele2);
+  cache.save(mInputFile);
+}
+
+BimFile BimFile::subset(const std::vector<unsigned long>& siteIds) const {
+  BimFile result;
+  result.mInputFile = mInputFile;
+  result.mChrCodes.reserve(siteIds.size());
+  result.mSnpIds.reserve(siteIds.size(), 0ul);
+  result.mGeneticPositions.reserve(siteIds.size());
+  result.mPhysicalPositions.reserve(siteIds.size());
+  result.mAllele1.reserve(siteIds.size(), 0ul);
+  result.mAllele2.reserve(siteIds.size(), 0ul);
+
+  // Only the chromosomes of the kept sites are carried over, so the codes are remapped
+  std::vector<int> newCodes(mChrNames.size(), -1);
+  for (const unsigned long siteId : siteIds) {
+    const uint16_t code = mChrCodes.at(siteId);
+    if (newCodes[code] < 0) {
+      newCodes[code] = static_cast<int>(result.mChrNames.size());
+      result.mChrNames.emplace_back(mChrNames[code]);
+    }
+    result.mChrCodes.emplace_back(static_cast<uint16_t>(newCodes[code]));
+    result.mSnpIds.push_back(mSnpIds[siteId]);
+    result.mGeneticPositions.emplace_back(mGeneticPositions[siteId]);
+    result.mPhysicalPositions.emplace_back(mPhysicalPositions[siteId]);
+    result.mAllele1.push_back(mAllele1[siteId]);
+    result.mAllele2.push_back(mAllele2[siteId]);
+  }
+
+  return result;
+}
+
+unsigned long BimFile::getNumSites() const {
+  return static_cast<unsigned long>(mSnpIds.size());
+}
+
+const std::vector<std::string>& BimFile::getChrNames() const {
+  return mChrNames;
+}
+
+const std::vector<uint16_t>& BimFile::getChrCodes() const {
+  return mChrCodes;
+}
+
+const StringColumn& BimFile::getSnpIds() const {
+  return mSnpIds;
+}
+
+const std::vector<double>& BimFile::getGeneticPositions() const {
+  return mGeneticPositions;
+}
+
+const std::vector<unsigned long>& BimFile::getPhysicalPositions() const {
+  return mPhysicalPositions;
+}
+
+const StringColumn& BimFile::getAllele1() const {
+  return mAllele1;
+}
+
+const StringColumn& BimFile::getAllele2() const {
+  return mAllele2;
+}
+
+const std::string& BimFile::getChrId(unsigned long siteId) const {
+  return mChrNames[mChrCodes.at(siteId)];
+}
+
+std::vector<std::string> BimFile::getChrIds() const {
+  std::vector<std::string> chrIds;
+  chrIds.reserve(mChrCodes.size());
+  for (const uint16_t code : mChrCodes) {
+    chrIds.emplace_back(mChrNames[code]);
+  }
+  return chrIds;
+}
+
+void BimFile::write(std::string_view bimFile) const {
+  BufferedFileWriter writer(bimFile);
+  for (unsigned long i = 0ul; i < getNumSites(); ++i) {
+    fmt::format_to(std::back_inserter(writer.buffer()), "{}\t{}\t{}\t{}\t{}\t{}\n", mChrNames[mChrCodes[i]], mSnpIds[i],
+                   mGeneticPositions[i], mPhysicalPositions[i], mAllele1[i], mAllele2[i]);
+    writer.flushIfFull();
+  }
+  writer.close();
+}
+
+} // namespace asmc
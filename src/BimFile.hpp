@@ -0,0 +1,141 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_BIM_FILE_HPP
+#define DATA_MODULE_BIM_FILE_HPP
+
+#include "utils/StringColumn.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * A class that reads and stores a PLINK .bim file.
+ *
+ * The sites are stored by column. Chromosome IDs are stored as small codes into a dictionary of the distinct IDs, and
+ * the SNP IDs and alleles are each held in a single character arena.
+ */
+class BimFile {
+
+private:
+
+  /** Path to the input file */
+  fs::path mInputFile;
+
+  /** The distinct chromosome IDs, in order of first appearance. These need not necessarily be numeric IDs */
+  std::vector<std::string> mChrNames;
+
+  /** The chromosome of each site, as an index into mChrNames */
+  std::vector<uint16_t> mChrCodes;
+
+  /** The site/SNP IDs */
+  StringColumn mSnpIds;
+
+  /** The genetic positions, in centimorgans */
+  std::vector<double> mGeneticPositions;
+
+  /** The physical positions, in base pairs */
+  std::vector<unsigned long> mPhysicalPositions;
+
+  /** The first allele of each site, whose homozygous genotype is coded 0 */
+  StringColumn mAllele1;
+
+  /** The second allele of each site, whose copies are counted by the decoded genotypes */
+  StringColumn mAllele2;
+
+  /**
+   * Read the whole file into memory, mapping it if it is not compressed, and parse it.
+   *
+   * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+   */
+  void readFile(unsigned long numThreads);
+
+  /**
+   * Parse the text of a .bim file into the columns, checking each line has six tab-separated columns, a floating point
+   * genetic position and an unsigned integer physical position. Empty lines are skipped.
+   *
+   * @param text the contents of the file
+   */
+  void parse(std::string_view text);
+
+  /**
+   * Load the parsed file from its binary sidecar, if it has a valid one.
+   *
+   * @return whether the sidecar was loaded
+   */
+  bool readCache();
+
+  /**
+   * Write the parsed file to its binary sidecar, ignoring any failure to do so.
+   */
+  void writeCache() const;
+
+public:
+  /**
+   * Create an empty BimFile, containing no sites.
+   */
+  BimFile() = default;
+
+  /**
+   * Read a PLINK .bim file: a tab-separated text file with no header, and one line per variant with the fields:
+   * 1. chromosome code / ID (string)
+   * 2. variant/SNP identifier (string)
+   * 3. genetic position in centimorgans (float)
+   * 4. physical position in base pairs (integer)
+   * 5. allele 1 (string)
+   * 6. allele 2 (string)
+   *
+   * @param bimFile path to the .bim file
+   * @param useCache whether to load the sites from a binary sidecar next to the file, if it is up to date, and to
+   * write the sidecar after parsing the file otherwise
+   * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+   */
+  explicit BimFile(std::string_view bimFile, bool useCache = false, unsigned long numThreads = 1ul);
+
+  /**
+   * Create a BimFile containing a subset of the sites in this one.
+   *
+   * @param siteIds the indices of the sites to keep, in the order they should appear
+   * @return a BimFile containing only the given sites
+   */
+  [[nodiscard]] BimFile subset(const std::vector<unsigned long>& siteIds) const;
+
+  [[nodiscard]] unsigned long getNumSites() const;
+  [[nodiscard]] const std::vector<std::string>& getChrNames() const;
+  [[nodiscard]] const std::vector<uint16_t>& getChrCodes() const;
+  [[nodiscard]] const StringColumn& getSnpIds() const;
+  [[nodiscard]] const std::vector<double>& getGeneticPositions() const;
+  [[nodiscard]] const std::vector<unsigned long>& getPhysicalPositions() const;
+  [[nodiscard]] const StringColumn& getAllele1() const;
+  [[nodiscard]] const StringColumn& getAllele2() const;
+
+  /**
+   * @param siteId the index of a site
+   * @return the chromosome ID of the site
+   */
+  [[nodiscard]] const std::string& getChrId(unsigned long siteId) const;
+
+  /**
+   * @return a copy of the chromosome ID of every site
+   */
+  [[nodiscard]] std::vector<std::string> getChrIds() const;
+
+  /**
+   * Write the sites to a tab-separated PLINK .bim file. A std::runtime_error will be thrown if the file cannot be
+   * written.
+   *
+   * @param bimFile path to the .bim file to write
+   */
+  void write(std::string_view bimFile) const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_BIM_FILE_HPP
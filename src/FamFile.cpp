@@ -0,0 +1,202 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "FamFile.hpp"
+
+#include "utils/BufferedFileWriter.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/MetadataCache.hpp"
+#include "utils/StringUtils.hpp"
+
+#include <exception>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+FamFile::FamFile(std::string_view famFile, bool useCache, unsigned long numThreads) : mInputFile{famFile} {
+  if (!fs::is_regular_file(mInputFile)) {
+    throw std::runtime_error(fmt::format("Error: .fam file {} does not exist\n", mInputFile.string()));
+  }
+  if (useCache && readCache()) {
+    return;
+  }
+  readFile(numThreads);
+  if (useCache) {
+    writeCache();
+  }
+}
+
+void FamFile::readFile(unsigned long numThreads) {
+  withFileContents(mInputFile, [this](std::string_view text) { parse(text); }, numThreads);
+}
+
+void FamFile::parse(std::string_view text) {
+  const std::size_t maxNumIndividuals = countLines(text);
+  mFamilyIds.reserve(maxNumIndividuals, 0ul);
+  mIndividualIds.reserve(maxNumIndividuals, 0ul);
+  mPaternalIds.reserve(maxNumIndividuals, 0ul);
+  mMaternalIds.reserve(maxNumIndividuals, 0ul);
+  mSexCodes.reserve(maxNumIndividuals);
+  mPhenotypes.reserve(maxNumIndividuals, 0ul);
+
+  bool delimiterKnown = false;
+  std::vector<std::string_view> fields;
+  while (!text.empty()) {
+    const std::string_view line = popLine(text);
+    if (line.empty()) {
+      continue;
+    }
+
+    if (!delimiterKnown) {
+      for (const char delimiter : {' ', '\t'}) {
+        splitIntoViews(line, delimiter, fields);
+        if (fields.size() == 6ul) {
+          mDelimiter = std::string(1ul, delimiter);
+          delimiterKnown = true;
+          break;
+        }
+      }
+      if (!delimiterKnown) {
+        throw std::runtime_error(fmt::format("Could not determine delimiter for .fam file {}", mInputFile.string()));
+      }
+    } else {
+      splitIntoViews(line, mDelimiter.front(), fields);
+    }
+
+    if (fields.size() != 6ul) {
+      throw std::runtime_error(fmt::format("Error: .fam file {} line {} contains {} columns, but should contain 6\n",
+                                           mInputFile.string(), 1ul + mIndividualIds.size(), fields.size()));
+    }
+
+    mFamilyIds.push_back(fields[0]);
+    mIndividualIds.push_back(fields[1]);
+    mPaternalIds.push_back(fields[2]);
+    mMaternalIds.push_back(fields[3]);
+    mSexCodes.emplace_back(fields[4] == "1" ? 1u : fields[4] == "2" ? 2u : 0u);
+    mPhenotypes.push_back(fields[5]);
+  }
+
+  if (!delimiterKnown) {
+    throw std::runtime_error(fmt::format("Could not determine delimiter for .fam file {}", mInputFile.string()));
+  }
+}
+
+bool FamFile::readCache() {
+  auto cache = MetadataCacheReader::open(mInputFile, "fam");
+  if (!cache) {
+    return false;
+  }
+
+  try {
+    const char delimiter = cache->readValue<char>();
+    StringColumn familyIds = cache->readStrings();
+    StringColumn individualIds = cache->readStrings();
+    StringColumn paternalIds = cache->readStrings();
+    StringColumn maternalIds = cache->readStrings();
+    std::vector<uint8_t> sexCodes = cache->readVector<uint8_t>();
+    StringColumn phenotypes = cache->readStrings();
+
+    const std::size_t numIndividuals = individualIds.size();
+    if ((delimiter != ' ' && delimiter != '\t') || familyIds.size() != numIndividuals ||
+        paternalIds.size() != numIndividuals || maternalIds.size() != numIndividuals ||
+        sexCodes.size() != numIndividuals || phenotypes.size() != numIndividuals) {
+      return false;
+    }
+
+    mDelimiter = std::string(1ul, delimiter);
+    mFamilyIds = std::move(familyIds);
+    mIndividualIds = std::move(individualIds);
+    mPaternalIds = std::move(paternalIds);
+    mMaternalIds = std::move(maternalIds);
+    mSexCodes = std::move(sexCodes);
+    mPhenotypes = std::move(phenotypes);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+  return true;
+}
+
+void FamFile::writeCache() const {
+  MetadataCacheWriter cache("fam");
+  cache.writeValue(mDelimiter.front());
+  cache.writeStrings(mFamilyIds);
+  cache.writeStrings(mIndividualIds);
+  cache.writeStrings(mPaternalIds);
+  cache.writeStrings(mMaternalIds);
+  cache.writeVector(mSexCodes);
+  cache.writeStrings(mPhenotypes);
+  cache.save(mInputFile);
+}
+
+FamFile FamFile::subset(const std::vector<unsigned long>& individualIds) const {
+  FamFile result;
+  result.mInputFile = mInputFile;
+  result.mDelimiter = mDelimiter;
+  result.mFamilyIds.reserve(individualIds.size(), 0ul);
+  result.mIndividualIds.reserve(individualIds.size(), 0ul);
+  result.mPaternalIds.reserve(individualIds.size(), 0ul);
+  result.mMaternalIds.reserve(individualIds.size(), 0ul);
+  result.mSexCodes.reserve(individualIds.size());
+  result.mPhenotypes.reserve(individualIds.size(), 0ul);
+
+  for (const unsigned long individualId : individualIds) {
+    result.mFamilyIds.push_back(mFamilyIds.at(individualId));
+    result.mIndividualIds.push_back(mIndividualIds.at(individualId));
+    result.mPaternalIds.push_back(mPaternalIds.at(individualId));
+    result.mMaternalIds.push_back(mMaternalIds.at(individualId));
+    result.mSexCodes.emplace_back(mSexCodes.at(individualId));
+    result.mPhenotypes.push_back(mPhenotypes.at(individualId));
+  }
+
+  return result;
+}
+
+unsigned long FamFile::getNumIndividuals() const {
+  return static_cast<unsigned long>(mIndividualIds.size());
+}
+
+const std::string& FamFile::getDelimiter() const {
+  return mDelimiter;
+}
+
+const StringColumn& FamFile::getFamilyIds() const {
+  return mFamilyIds;
+}
+
+const StringColumn& FamFile::getIndividualIds() const {
+  return mIndividualIds;
+}
+
+const StringColumn& FamFile::getPaternalIds() const {
+  return mPaternalIds;
+}
+
+const StringColumn& FamFile::getMaternalIds() const {
+  return mMaternalIds;
+}
+
+const std::vector<uint8_t>& FamFile::getSexCodes() const {
+  return mSexCodes;
+}
+
+const StringColumn& FamFile::getPhenotypes() const {
+  return mPhenotypes;
+}
+
+void FamFile::write(std::string_view famFile) const {
+  BufferedFileWriter writer(famFile);
+  const std::string& d = mDelimiter;
+  for (unsigned long i = 0ul; i < getNumIndividuals(); ++i) {
+    fmt::format_to(std::back_inserter(writer.buffer()), "{}{}{}{}{}{}{}{}{}{}{}\n", mFamilyIds[i], d,
+                   mIndividualIds[i], d, mPaternalIds[i], d, mMaternalIds[i], d, static_cast<unsigned>(mSexCodes[i]), d,
+                   mPhenotypes[i]);
+    writer.flushIfFull();
+  }
+  writer.close();
+}
+
+} // namespace asmc
@@ -0,0 +1,126 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_FAM_FILE_HPP
+#define DATA_MODULE_FAM_FILE_HPP
+
+#include "utils/StringColumn.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * A class that reads and stores a PLINK .fam file.
+ *
+ * The individuals are stored by column: the IDs and phenotypes are each held in a single character arena, and the sex
+ * codes as one byte per individual.
+ */
+class FamFile {
+
+private:
+
+  /** Path to the input file */
+  fs::path mInputFile;
+
+  /** The detected delimiter used in the .fam file */
+  std::string mDelimiter = " ";
+
+  /** The family IDs (FID) */
+  StringColumn mFamilyIds;
+
+  /** The within-family individual IDs (IID) */
+  StringColumn mIndividualIds;
+
+  /** The within-family IDs of each individual's father, or 0 if not in the dataset */
+  StringColumn mPaternalIds;
+
+  /** The within-family IDs of each individual's mother, or 0 if not in the dataset */
+  StringColumn mMaternalIds;
+
+  /** The sex codes: 1 for male, 2 for female, 0 for unknown */
+  std::vector<uint8_t> mSexCodes;
+
+  /** The phenotype values, kept as text so that they are written back unchanged */
+  StringColumn mPhenotypes;
+
+  /**
+   * Read the whole file into memory, mapping it if it is not compressed, and parse it.
+   *
+   * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+   */
+  void readFile(unsigned long numThreads);
+
+  /**
+   * Parse the text of a .fam file into the columns in a single pass. The delimiter, either a space or a tab, is
+   * determined from the first non-empty line, and every line is checked to have six columns. Empty lines are skipped.
+   *
+   * @param text the contents of the file
+   */
+  void parse(std::string_view text);
+
+  /**
+   * Load the parsed file from its binary sidecar, if it has a valid one.
+   *
+   * @return whether the sidecar was loaded
+   */
+  bool readCache();
+
+  /**
+   * Write the parsed file to its binary sidecar, ignoring any failure to do so.
+   */
+  void writeCache() const;
+
+public:
+  /**
+   * Create an empty FamFile, containing no individuals.
+   */
+  FamFile() = default;
+
+  /**
+   * Read a PLINK .fam file: a space- or tab-separated text file with no header, and one line per individual with the
+   * fields family ID, individual ID, father ID, mother ID, sex code, and phenotype. As in PLINK, a sex code other than
+   * 1 or 2 is read as unknown.
+   *
+   * @param famFile path to the .fam file
+   * @param useCache whether to load the individuals from a binary sidecar next to the file, if it is up to date, and
+   * to write the sidecar after parsing the file otherwise
+   * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+   */
+  explicit FamFile(std::string_view famFile, bool useCache = false, unsigned long numThreads = 1ul);
+
+  /**
+   * Create a FamFile containing a subset of the individuals in this one.
+   *
+   * @param individualIds the indices of the individuals to keep, in the order they should appear
+   * @return a FamFile containing only the given individuals
+   */
+  [[nodiscard]] FamFile subset(const std::vector<unsigned long>& individualIds) const;
+
+  [[nodiscard]] unsigned long getNumIndividuals() const;
+  [[nodiscard]] const std::string& getDelimiter() const;
+  [[nodiscard]] const StringColumn& getFamilyIds() const;
+  [[nodiscard]] const StringColumn& getIndividualIds() const;
+  [[nodiscard]] const StringColumn& getPaternalIds() const;
+  [[nodiscard]] const StringColumn& getMaternalIds() const;
+  [[nodiscard]] const std::vector<uint8_t>& getSexCodes() const;
+  [[nodiscard]] const StringColumn& getPhenotypes() const;
+
+  /**
+   * Write the individuals to a PLINK .fam file, using the same delimiter as the file that was read. A
+   * std::runtime_error will be thrown if the file cannot be written.
+   *
+   * @param famFile path to the .fam file to write
+   */
+  void write(std::string_view famFile) const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_FAM_FILE_HPP
@@ -4,20 +4,28 @@
 #include "GeneticMap.hpp"
 
 #include "utils/FileUtils.hpp"
+#include "utils/LineReader.hpp"
+#include "utils/MetadataCache.hpp"
 #include "utils/StringUtils.hpp"
 #include "utils/VectorUtils.hpp"
 
 #include <exception>
 #include <iostream>
+#include <utility>
 
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
 namespace asmc {
 
-GeneticMap::GeneticMap(std::string_view mapFile) : mInputFile{mapFile} {
-  validateFile();
-  readFile();
+GeneticMap::GeneticMap(std::string_view mapFile, bool useCache) : mInputFile{mapFile} {
+  if (!useCache || !readCache()) {
+    validateFile();
+    readFile();
+    if (useCache) {
+      writeCache();
+    }
+  }
   validateMap();
 }
 
@@ -109,19 +117,19 @@ void GeneticMap::readFile() {
   mGeneticPositions.reserve(mNumSites);
   mPhysicalPositions.reserve(mNumSites);
 
-  auto gzFile = gzopen(mInputFile.string().c_str(), "r");
+  LineReader reader(mInputFile);
+  std::string_view text;
 
   // Skip header, if present
   if (mHasHeader) {
-    readNextLineFromGzip(gzFile);
+    reader.nextLine(text);
   }
 
-  while (!gzeof(gzFile)) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), "\t");
+  while (reader.nextLine(text)) {
+    std::vector<std::string> line = splitTextByDelimiter(text, "\t");
     if (!line.empty()) {
 
       if (line.size() != mNumCols) {
-        gzclose(gzFile);
         throw std::runtime_error(
             fmt::format("Error: Genetic map file {} line {} contains {} columns, but the first data row contains {}\n",
                         mInputFile.string(), 1ul + mGeneticPositions.size(), line.size(), mNumCols));
@@ -131,7 +139,6 @@ void GeneticMap::readFile() {
         mPhysicalPositions.emplace_back(ulFromString(line.at(0ul)));
         mGeneticPositions.emplace_back(dblFromString(line.at(2ul)));
       } catch (const std::runtime_error&) {
-        gzclose(gzFile);
         throw std::runtime_error(fmt::format(
             "Error: Genetic map file {} line {} should contain an unsigned integer physical position in the first "
             "column and a floating point genetic position in the third column, but found {} and {}\n",
@@ -139,8 +146,6 @@ void GeneticMap::readFile() {
       }
     }
   }
-
-  gzclose(gzFile);
 }
 
 void GeneticMap::validateMap() {
@@ -185,6 +190,41 @@ void GeneticMap::validateMap() {
   }
 }
 
+bool GeneticMap::readCache() {
+  auto cache = MetadataCacheReader::open(mInputFile, "geneticmap");
+  if (!cache) {
+    return false;
+  }
+
+  try {
+    const auto hasHeader = cache->readValue<unsigned long>();
+    const auto numCols = cache->readValue<unsigned long>();
+    std::vector<double> geneticPositions = cache->readVector<double>();
+    std::vector<unsigned long> physicalPositions = cache->readVector<unsigned long>();
+    if (geneticPositions.size() != physicalPositions.size()) {
+      return false;
+    }
+
+    mHasHeader = hasHeader;
+    mNumCols = numCols;
+    mNumSites = static_cast<unsigned long>(physicalPositions.size());
+    mGeneticPositions = std::move(geneticPositions);
+    mPhysicalPositions = std::move(physicalPositions);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+  return true;
+}
+
+void GeneticMap::writeCache() const {
+  MetadataCacheWriter cache("geneticmap");
+  cache.writeValue(mHasHeader);
+  cache.writeValue(mNumCols);
+  cache.writeVector(mGeneticPositions);
+  cache.writeVector(mPhysicalPositions);
+  cache.save(mInputFile);
+}
+
 unsigned long GeneticMap::getNumSites() const {
   return mNumSites;
 }
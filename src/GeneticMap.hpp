@@ -71,6 +71,18 @@ private:
    */
   void validateMap();
 
+  /**
+   * Load the parsed map from its binary sidecar, if it has a valid one.
+   *
+   * @return whether the sidecar was loaded
+   */
+  bool readCache();
+
+  /**
+   * Write the parsed map to its binary sidecar, ignoring any failure to do so.
+   */
+  void writeCache() const;
+
 public:
   /**
    * Read a genetic .map file: a tab-separated text file with or without a header header row, and one line per variant
@@ -82,8 +94,10 @@ public:
    * All lines must have the same number of columns.
    *
    * @param mapFile path to the .map file
+   * @param useCache whether to load the map from a binary sidecar next to the file, if it is up to date, and to write
+   * the sidecar after parsing the file otherwise
    */
-  explicit GeneticMap(std::string_view mapFile);
+  explicit GeneticMap(std::string_view mapFile, bool useCache = false);
 
   [[nodiscard]] unsigned long getNumSites() const;
   [[nodiscard]] unsigned long getNumCols() const;
@@ -0,0 +1,172 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "GeneticRelationshipMatrix.hpp"
+
+#include "BedMatrixType.hpp"
+#include "utils/BufferedFileWriter.hpp"
+#include "utils/ThreadUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+namespace {
+
+/**
+ * Add Z Z^T to the lower triangle of grm, where Z holds one standardised site per column. The rows of the triangle are
+ * split into chunks of near-equal area, and each thread updates the rows of its own chunk.
+ *
+ * @param grm the matrix to update
+ * @param block the standardised genotypes
+ * @param numThreads the number of threads to use
+ */
+void accumulateLowerTriangle(mat_float_t& grm, const Eigen::Ref<const mat_float_t>& block, unsigned long numThreads) {
+  const auto n = static_cast<unsigned long>(grm.rows());
+  const unsigned long numChunks = std::max(1ul, std::min(resolveNumThreads(numThreads), n));
+
+  // The triangle above row r has area proportional to r^2, so chunk k ends at row n * sqrt((k + 1) / numChunks)
+  auto chunkEnd = [n, numChunks](unsigned long chunk) {
+    if (chunk + 1ul >= numChunks) {
+      return n;
+    }
+    const double fraction = static_cast<double>(chunk + 1ul) / static_cast<double>(numChunks);
+    return static_cast<unsigned long>(std::lround(static_cast<double>(n) * std::sqrt(fraction)));
+  };
+
+  parallelFor(0ul, numChunks, numChunks, [&](unsigned long first, unsigned long last) {
+    for (unsigned long chunk = first; chunk < last; ++chunk) {
+      const auto rowStart = static_cast<index_t>(chunk == 0ul ? 0ul : chunkEnd(chunk - 1ul));
+      const auto numRows = static_cast<index_t>(chunkEnd(chunk)) - rowStart;
+      if (numRows <= 0) {
+        continue;
+      }
+      const auto rows = block.middleRows(rowStart, numRows);
+      grm.block(rowStart, 0, numRows, rowStart).noalias() += rows * block.topRows(rowStart).transpose();
+      grm.block(rowStart, rowStart, numRows, numRows).selfadjointView<Eigen::Lower>().rankUpdate(rows);
+    }
+  });
+}
+
+} // namespace
+
+GeneticRelationshipMatrix GeneticRelationshipMatrix::createFromBedMatrix(const BedMatrixType& bedMatrix,
+                                                                         unsigned long blockSize,
+                                                                         unsigned long numThreads) {
+  if (blockSize == 0ul) {
+    throw std::runtime_error("Expected a block size of at least one site");
+  }
+
+  const unsigned long numIndividuals = bedMatrix.getNumIndividuals();
+  const unsigned long numSites = bedMatrix.getNumSites();
+
+  GeneticRelationshipMatrix grm;
+  grm.mFam = bedMatrix.getFam();
+  grm.mMatrix = mat_float_t::Zero(static_cast<index_t>(numIndividuals), static_cast<index_t>(numIndividuals));
+
+  for (unsigned long siteId = 0ul; siteId < numSites; ++siteId) {
+    const unsigned long numObserved = numIndividuals - bedMatrix.getMissingCount(siteId);
+    const unsigned long alleleCount = bedMatrix.getDerivedAlleleCount(siteId);
+    if (alleleCount > 0ul && alleleCount < 2ul * numObserved) {
+      ++grm.mNumSites;
+    }
+  }
+
+  GenotypeExportOptions options;
+  options.impute = true;
+  options.centre = true;
+  options.scale = true;
+
+  // Standardise the next block on a background thread while the current block is accumulated
+  const unsigned long numBlocks = (numSites + blockSize - 1ul) / blockSize;
+  std::vector<mat_float_t> blocks(2ul, mat_float_t(static_cast<index_t>(numIndividuals),
+                                                   static_cast<index_t>(std::min<unsigned long>(blockSize, numSites))));
+  auto exportBlock = [&](unsigned long blockId) {
+    const unsigned long firstSite = blockId * blockSize;
+    const auto numBlockSites = static_cast<index_t>(std::min<unsigned long>(blockSize, numSites - firstSite));
+    bedMatrix.exportSites(firstSite, blocks[blockId % 2ul].leftCols(numBlockSites), options);
+  };
+
+  std::future<void> pendingExport;
+  if (numBlocks > 0ul) {
+    pendingExport = std::async(std::launch::async, exportBlock, 0ul);
+  }
+  for (unsigned long blockId = 0ul; blockId < numBlocks; ++blockId) {
+    pendingExport.get();
+    if (blockId + 1ul < numBlocks) {
+      pendingExport = std::async(std::launch::async, exportBlock, blockId + 1ul);
+    }
+    const unsigned long firstSite = blockId * blockSize;
+    const auto numBlockSites = static_cast<index_t>(std::min<unsigned long>(blockSize, numSites - firstSite));
+    try {
+      accumulateLowerTriangle(grm.mMatrix, blocks[blockId % 2ul].leftCols(numBlockSites), numThreads);
+    } catch (...) {
+      if (pendingExport.valid()) {
+        pendingExport.wait();
+      }
+      throw;
+    }
+  }
+
+  if (grm.mNumSites > 0ul) {
+    grm.mMatrix /= static_cast<float>(grm.mNumSites);
+  }
+
+  // Mirror the lower triangle: row j left of the diagonal is copied to column j above it
+  for (index_t j = 1; j < grm.mMatrix.cols(); ++j) {
+    grm.mMatrix.col(j).head(j) = grm.mMatrix.row(j).head(j).transpose();
+  }
+
+  return grm;
+}
+
+unsigned long GeneticRelationshipMatrix::getNumIndividuals() const {
+  return static_cast<unsigned long>(mMatrix.rows());
+}
+
+unsigned long GeneticRelationshipMatrix::getNumSites() const {
+  return mNumSites;
+}
+
+const FamFile& GeneticRelationshipMatrix::getFam() const {
+  return mFam;
+}
+
+const mat_float_t& GeneticRelationshipMatrix::getMatrix() const {
+  return mMatrix;
+}
+
+void GeneticRelationshipMatrix::writeBinary(std::string_view prefix) const {
+  const std::string prefixString(prefix);
+
+  // Row i of the lower triangle is the start of column i, as the matrix is symmetric
+  BufferedFileWriter grmBin(prefixString + ".grm.bin");
+  for (index_t i = 0; i < mMatrix.cols(); ++i) {
+    grmBin.write(mMatrix.col(i).data(), static_cast<std::size_t>(i + 1) * sizeof(float));
+  }
+  grmBin.close();
+
+  const std::vector<float> numSites(static_cast<std::size_t>(getNumIndividuals()), static_cast<float>(mNumSites));
+  BufferedFileWriter grmNBin(prefixString + ".grm.N.bin");
+  for (std::size_t i = 0ul; i < numSites.size(); ++i) {
+    grmNBin.write(numSites.data(), (i + 1ul) * sizeof(float));
+  }
+  grmNBin.close();
+
+  BufferedFileWriter grmId(prefixString + ".grm.id");
+  for (unsigned long i = 0ul; i < getNumIndividuals(); ++i) {
+    fmt::format_to(std::back_inserter(grmId.buffer()), "{}\t{}\n", mFam.getFamilyIds()[i], mFam.getIndividualIds()[i]);
+    grmId.flushIfFull();
+  }
+  grmId.close();
+}
+
+} // namespace asmc
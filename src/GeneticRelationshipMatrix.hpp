@@ -0,0 +1,86 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_GENETIC_RELATIONSHIP_MATRIX_HPP
+#define DATA_MODULE_GENETIC_RELATIONSHIP_MATRIX_HPP
+
+#include "EigenTypes.hpp"
+#include "FamFile.hpp"
+
+#include <string_view>
+
+namespace asmc {
+
+class BedMatrixType;
+
+/**
+ * The #individuals x #individuals genetic relationship matrix (GRM) A = Z Z^T / M, where Z holds the genotypes of M
+ * polymorphic sites, each imputed with its mean, centred, and scaled by sqrt(2p(1-p)) for allele frequency p.
+ *
+ * Sites are processed in blocks: each block is standardised directly into a preallocated #individuals x blockSize
+ * matrix and added to the lower triangle with a matrix product, with the rows of the triangle shared between threads.
+ * The next block is standardised on a background thread while the current one is accumulated, so the full matrix of
+ * standardised genotypes is never held in memory.
+ */
+class GeneticRelationshipMatrix {
+
+private:
+  /** The individuals, one per row and column of the matrix */
+  FamFile mFam;
+
+  /** The number of polymorphic sites contributing to the matrix */
+  unsigned long mNumSites = 0ul;
+
+  /** The symmetric #individuals x #individuals relationship matrix */
+  mat_float_t mMatrix;
+
+public:
+  /** The default number of sites standardised and accumulated at a time */
+  static constexpr unsigned long defaultBlockSize = 1024ul;
+
+  GeneticRelationshipMatrix() = default;
+
+  /**
+   * Compute the relationship matrix of every individual in a BedMatrixType, using all of its sites. Monomorphic sites,
+   * and sites where every genotype is missing, contribute nothing and are not counted in M.
+   *
+   * @param bedMatrix the genotypes
+   * @param blockSize the number of sites accumulated at a time
+   * @param numThreads the number of threads to use, where 0 means one per hardware thread
+   * @return the relationship matrix
+   */
+  static GeneticRelationshipMatrix createFromBedMatrix(const BedMatrixType& bedMatrix,
+                                                       unsigned long blockSize = defaultBlockSize,
+                                                       unsigned long numThreads = 1ul);
+
+  [[nodiscard]] unsigned long getNumIndividuals() const;
+
+  /**
+   * @return the number of polymorphic sites, M, contributing to the matrix
+   */
+  [[nodiscard]] unsigned long getNumSites() const;
+
+  /**
+   * @return the individuals, one per row and column of the matrix
+   */
+  [[nodiscard]] const FamFile& getFam() const;
+
+  /**
+   * @return the symmetric #individuals x #individuals relationship matrix
+   */
+  [[nodiscard]] const mat_float_t& getMatrix() const;
+
+  /**
+   * Write the matrix in the binary format used by GCTA. Three files are written:
+   *  - prefix.grm.bin: the lower triangle, including the diagonal, row by row, as little-endian 32-bit floats;
+   *  - prefix.grm.N.bin: the number of sites used for each entry of prefix.grm.bin, in the same layout;
+   *  - prefix.grm.id: the family and individual ID of each row, separated by a tab.
+   *
+   * @param prefix path to the files to write, without the .grm.* extension
+   */
+  void writeBinary(std::string_view prefix) const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_GENETIC_RELATIONSHIP_MATRIX_HPP
@@ -0,0 +1,177 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "HapsBlockReader.hpp"
+
+#include "utils/FileUtils.hpp"
+#include "utils/HapsUtils.hpp"
+#include "utils/LineReader.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+HapsBlockReader::HapsBlockReader(std::string_view hapsFile, std::string_view samplesFile, std::string_view mapFile,
+                                 unsigned long blockSize)
+    : mHapsFile{hapsFile}, mMapFile{mapFile}, mBlockSize{blockSize} {
+
+  if (blockSize == 0ul) {
+    throw std::runtime_error("The block size of a HapsBlockReader must be at least 1");
+  }
+  if (!fs::exists(hapsFile) || !fs::is_regular_file(hapsFile)) {
+    throw std::runtime_error(fmt::format("Expected .hap[s][.gz] file, but got {}", hapsFile));
+  }
+  if (!fs::exists(samplesFile) || !fs::is_regular_file(samplesFile)) {
+    throw std::runtime_error(fmt::format("Expected .sample[s] file, but got {}", samplesFile));
+  }
+  if (!fs::exists(mapFile) || !fs::is_regular_file(mapFile)) {
+    throw std::runtime_error(fmt::format("Expected .map file, but got {}", mapFile));
+  }
+
+  mNumIndividuals = readHapsSamplesFile(samplesFile);
+  mNumSites = countLinesInFile(mMapFile);
+
+  // Allocate the buffers once, sized for the largest block that will be read
+  const unsigned long maxBlockSize = std::min(mBlockSize, mNumSites);
+  mBlock = PackedHaplotypeMatrix(getNumHaps(), maxBlockSize);
+  mGeneticPositions.reserve(maxBlockSize);
+  mPhysicalPositions.reserve(maxBlockSize);
+  mWords.resize(mBlock.getWordsPerSite());
+
+  reset();
+}
+
+HapsBlockReader::HapsBlockReader(HapsBlockReader&& other) noexcept = default;
+HapsBlockReader& HapsBlockReader::operator=(HapsBlockReader&& other) noexcept = default;
+HapsBlockReader::~HapsBlockReader() = default;
+
+void HapsBlockReader::readMapSite() {
+  std::string_view line;
+  double geneticPosition = 0.0;
+  unsigned long physicalPosition = 0ul;
+  while (mMapReader->nextLine(line)) {
+    if (parseHapsMapRow(line, geneticPosition, physicalPosition)) {
+      mGeneticPositions.push_back(geneticPosition);
+      mPhysicalPositions.push_back(physicalPosition);
+      return;
+    }
+  }
+  throw std::runtime_error(fmt::format("Expected {} to contain {} sites, but it ended after {}", mMapFile.string(),
+                                       mNumSites, mBlockStart + mGeneticPositions.size()));
+}
+
+void HapsBlockReader::checkNoExtraLines() {
+  // Other than empty lines, such as a possible expected newline at the end of the file
+  unsigned long linesInFile = mNumSites;
+  std::string_view line;
+  while (mHapsReader->nextLine(line)) {
+    if (!line.empty()) {
+      linesInFile++;
+    }
+  }
+
+  if (linesInFile != mNumSites) {
+    throw std::runtime_error(
+        fmt::format("Expected {} to contain {} lines, but found {}", mHapsFile.string(), mNumSites, linesInFile));
+  }
+}
+
+bool HapsBlockReader::nextBlock() {
+  mBlockStart = mNextSite;
+  mCurrentBlockSize = std::min(mBlockSize, mNumSites - mNextSite);
+  mGeneticPositions.clear();
+  mPhysicalPositions.clear();
+
+  if (mCurrentBlockSize == 0ul) {
+    return false;
+  }
+
+  // A file with too few lines has an empty row at its end
+  std::string_view line;
+  for (unsigned long siteInBlock = 0ul; siteInBlock < mCurrentBlockSize; ++siteInBlock) {
+    readMapSite();
+    if (!mHapsReader->nextLine(line)) {
+      line = {};
+    }
+    try {
+      parseHapsRow(line, mNumIndividuals, mWords.data());
+    } catch (const std::runtime_error& e) {
+      throw std::runtime_error(fmt::format("Error on line {} of {}:\n{}", 1ul + mBlockStart + siteInBlock,
+                                           mHapsFile.string(), e.what()));
+    }
+    mBlock.setSite(siteInBlock, mWords.data());
+  }
+
+  mNextSite += mCurrentBlockSize;
+  if (mNextSite == mNumSites) {
+    checkNoExtraLines();
+  }
+  return true;
+}
+
+void HapsBlockReader::reset() {
+  mHapsReader = std::make_unique<LineReader>(mHapsFile);
+  mMapReader = std::make_unique<LineReader>(mMapFile);
+  mBlockStart = 0ul;
+  mCurrentBlockSize = 0ul;
+  mNextSite = 0ul;
+  mGeneticPositions.clear();
+  mPhysicalPositions.clear();
+}
+
+const uint64_t* HapsBlockReader::getPackedSite(unsigned long siteInBlock) const {
+  assert(siteInBlock < mCurrentBlockSize);
+  return mBlock.getSiteWords(siteInBlock);
+}
+
+unsigned long HapsBlockReader::getAlleleCount(unsigned long siteInBlock) const {
+  assert(siteInBlock < mCurrentBlockSize);
+  return mBlock.getAlleleCount(siteInBlock);
+}
+
+mat_uint8_t HapsBlockReader::getBlockData() const {
+  mat_uint8_t data(static_cast<index_t>(mCurrentBlockSize), static_cast<index_t>(getNumHaps()));
+  for (unsigned long siteInBlock = 0ul; siteInBlock < mCurrentBlockSize; ++siteInBlock) {
+    mBlock.unpackSite(siteInBlock, data.data() + siteInBlock, data.outerStride());
+  }
+  return data;
+}
+
+const std::vector<double>& HapsBlockReader::getBlockGeneticPositions() const {
+  return mGeneticPositions;
+}
+
+const std::vector<unsigned long>& HapsBlockReader::getBlockPhysicalPositions() const {
+  return mPhysicalPositions;
+}
+
+unsigned long HapsBlockReader::getBlockStart() const {
+  return mBlockStart;
+}
+
+unsigned long HapsBlockReader::getBlockSize() const {
+  return mCurrentBlockSize;
+}
+
+unsigned long HapsBlockReader::getMaxBlockSize() const {
+  return mBlockSize;
+}
+
+unsigned long HapsBlockReader::getNumSites() const {
+  return mNumSites;
+}
+
+unsigned long HapsBlockReader::getNumIndividuals() const {
+  return mNumIndividuals;
+}
+
+unsigned long HapsBlockReader::getNumHaps() const {
+  return 2ul * mNumIndividuals;
+}
+
+} // namespace asmc
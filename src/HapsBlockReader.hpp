@@ -0,0 +1,174 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_HAPS_BLOCK_READER_HPP
+#define DATA_MODULE_HAPS_BLOCK_READER_HPP
+
+#include "EigenTypes.hpp"
+#include "PackedHaplotypeMatrix.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+class LineReader;
+
+/**
+ * Read a .hap[s][.gz] file, with its .sample[s] and .map files, in consecutive blocks of sites, for jobs that need a
+ * single pass over the haplotypes such as computing frequencies or converting formats. The .haps and .map files are
+ * streamed side by side, and only one block is held at a time: each call to nextBlock() packs the next block of sites
+ * into the same preallocated PackedHaplotypeMatrix, alongside their genetic and physical positions. Memory use depends
+ * on the block size and the number of haplotypes, but not on the number of sites.
+ *
+ * Rows are validated as they are read, and a std::runtime_error is thrown from nextBlock() with the same messages as
+ * HapsMatrixType::createFromHapsPlusSamples. Extra lines at the end of the .haps file are detected when the last block
+ * is read.
+ *
+ * A typical loop is:
+ *
+ *   HapsBlockReader reader(hapsFile, samplesFile, mapFile, 1024ul);
+ *   while (reader.nextBlock()) {
+ *     for (unsigned long i = 0ul; i < reader.getBlockSize(); ++i) {
+ *       const uint64_t* alleles = reader.getPackedSite(i);
+ *       ...
+ *     }
+ *   }
+ */
+class HapsBlockReader {
+
+private:
+  /** Paths to the .hap[s][.gz] and .map files, which are reopened by reset() */
+  fs::path mHapsFile;
+  fs::path mMapFile;
+
+  /** The number of individuals, read from the .sample[s] file */
+  unsigned long mNumIndividuals = 0ul;
+
+  /** The number of sites, which is the number of non-empty lines in the .map file */
+  unsigned long mNumSites = 0ul;
+
+  /** The maximum number of sites in each block */
+  unsigned long mBlockSize = 0ul;
+
+  /** The index of the first site in the current block */
+  unsigned long mBlockStart = 0ul;
+
+  /** The number of sites in the current block, which is 0 before the first block and after the last */
+  unsigned long mCurrentBlockSize = 0ul;
+
+  /** The index of the first site in the next block */
+  unsigned long mNextSite = 0ul;
+
+  /** The open .hap[s][.gz] and .map files */
+  std::unique_ptr<LineReader> mHapsReader;
+  std::unique_ptr<LineReader> mMapReader;
+
+  /** The packed alleles of the current block, with room for the largest block */
+  PackedHaplotypeMatrix mBlock;
+
+  /** The genetic positions, in centimorgans, and physical positions of the sites in the current block */
+  std::vector<double> mGeneticPositions;
+  std::vector<unsigned long> mPhysicalPositions;
+
+  /** Space for one packed site as it is parsed */
+  std::vector<uint64_t> mWords;
+
+  /**
+   * Read the next site from the .map file into the current block. A std::runtime_error will be thrown if the .map
+   * file has no more sites.
+   */
+  void readMapSite();
+
+  /**
+   * Check that the .hap[s][.gz] file has no non-empty lines after the last site, and throw a std::runtime_error if it
+   * does.
+   */
+  void checkNoExtraLines();
+
+public:
+  /**
+   * Open a .hap[s][.gz] file for reading in blocks. The .sample[s] file is read in full, and the .map file is counted,
+   * but no haplotypes are read until nextBlock() is called.
+   *
+   * @param hapsFile path to the .hap[s][.gz] file
+   * @param samplesFile path to the .sample[s] file
+   * @param mapFile path to the .map file
+   * @param blockSize the maximum number of sites in each block, which must be at least 1
+   */
+  HapsBlockReader(std::string_view hapsFile, std::string_view samplesFile, std::string_view mapFile,
+                  unsigned long blockSize);
+
+  HapsBlockReader(const HapsBlockReader&) = delete;
+  HapsBlockReader& operator=(const HapsBlockReader&) = delete;
+  HapsBlockReader(HapsBlockReader&& other) noexcept;
+  HapsBlockReader& operator=(HapsBlockReader&& other) noexcept;
+  ~HapsBlockReader();
+
+  /**
+   * Read and validate the next block of sites, replacing the current block.
+   *
+   * @return whether a block was read, which is false once every site has been read
+   */
+  bool nextBlock();
+
+  /**
+   * Return to the start of the files, so that the next call to nextBlock() reads the first block again.
+   */
+  void reset();
+
+  /**
+   * Get the packed alleles of a site in the current block.
+   *
+   * @param siteInBlock the index of the site within the current block
+   * @return pointer to (#haps + 63) / 64 words, with bit h % 64 of word h / 64 set if haplotype h carries allele 1
+   */
+  [[nodiscard]] const uint64_t* getPackedSite(unsigned long siteInBlock) const;
+
+  /**
+   * @param siteInBlock the index of the site within the current block
+   * @return the number of haplotypes carrying allele 1 at the site
+   */
+  [[nodiscard]] unsigned long getAlleleCount(unsigned long siteInBlock) const;
+
+  /**
+   * Unpack the current block, in the same layout as HapsMatrixType::getData().
+   *
+   * @return a getBlockSize() x #haps matrix of alleles
+   */
+  [[nodiscard]] mat_uint8_t getBlockData() const;
+
+  /**
+   * @return the genetic positions, in centimorgans, of the sites in the current block
+   */
+  [[nodiscard]] const std::vector<double>& getBlockGeneticPositions() const;
+
+  /**
+   * @return the physical positions of the sites in the current block
+   */
+  [[nodiscard]] const std::vector<unsigned long>& getBlockPhysicalPositions() const;
+
+  /**
+   * @return the index of the first site in the current block
+   */
+  [[nodiscard]] unsigned long getBlockStart() const;
+
+  /**
+   * @return the number of sites in the current block
+   */
+  [[nodiscard]] unsigned long getBlockSize() const;
+
+  [[nodiscard]] unsigned long getMaxBlockSize() const;
+  [[nodiscard]] unsigned long getNumSites() const;
+  [[nodiscard]] unsigned long getNumIndividuals() const;
+  [[nodiscard]] unsigned long getNumHaps() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_HAPS_BLOCK_READER_HPP
@@ -3,12 +3,19 @@
 
 #include "HapsMatrixType.hpp"
 
-#include "utils/FileUtils.hpp"
+#include "utils/HapsUtils.hpp"
+#include "utils/LineReader.hpp"
 #include "utils/StringUtils.hpp"
+#include "utils/ThreadUtils.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
+#include <functional>
+#include <future>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -18,8 +25,30 @@
 
 namespace asmc {
 
+namespace {
+
+/** A piece of a .hap[s][.gz] file holding whole lines, and what was found when its rows were parsed */
+struct HapsChunk {
+  /** The buffer taken from the LineReader, which holds the lines */
+  std::vector<char> storage;
+
+  /** The text of the lines, which points into storage */
+  std::string_view text;
+
+  /** The 0-based line number of the first line */
+  unsigned long firstLine = 0ul;
+
+  /** The number of non-empty lines beyond the expected number of sites */
+  unsigned long numExtraLines = 0ul;
+
+  /** The error for the first invalid row, or empty if every row is valid */
+  std::string error;
+};
+
+} // namespace
+
 HapsMatrixType HapsMatrixType::createFromHapsPlusSamples(std::string_view hapsFile, std::string_view samplesFile,
-                                                         std::string_view mapFile) {
+                                                         std::string_view mapFile, unsigned long numThreads) {
 
   if (!fs::exists(hapsFile) || !fs::is_regular_file(hapsFile)) {
     throw std::runtime_error(fmt::format("Expected .hap[s][.gz] file, but got {}", hapsFile));
@@ -35,127 +64,115 @@ HapsMatrixType HapsMatrixType::createFromHapsPlusSamples(std::string_view hapsFi
 
   instance.readSamplesFile(samplesFile);
   instance.readMapFile(mapFile);
-  instance.readHapsFile(hapsFile);
+  instance.readHapsFile(hapsFile, numThreads);
 
   return instance;
 }
 
 void HapsMatrixType::readSamplesFile(const fs::path& samplesFile) {
-
-  auto gzFile = gzopen(samplesFile.string().c_str(), "r");
-
-  // Process first two lines that contain header information
-  std::vector<std::string> line1 = splitTextByDelimiter(readNextLineFromGzip(gzFile), " ");
-  if (line1.size() < 3 || line1.at(0) != "ID_1" || line1.at(1) != "ID_2" || line1.at(2) != "missing") {
-    gzclose(gzFile);
-    throw std::runtime_error(
-        fmt::format("Expected fist row of .samples file {} to start \"ID_1 ID_2 missing\"", samplesFile.string()));
-  }
-
-  std::vector<std::string> line2 = splitTextByDelimiter(readNextLineFromGzip(gzFile), " ");
-  if (line2.size() < 3 || line2.at(0) != "0" || line2.at(1) != "0" || line2.at(2) != "0") {
-    gzclose(gzFile);
-    throw std::runtime_error(
-        fmt::format("Expected second row of .samples file {} to start \"0 0 0\"", samplesFile.string()));
-  }
-
-  // Read the individuals information
-  unsigned long numIndividuals = 0;
-  while (!gzeof(gzFile)) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), " ");
-    if (!line.empty()) {
-      numIndividuals++;
-    }
-  }
-
-  mNumIndividuals = numIndividuals;
-
-  gzclose(gzFile);
+  mNumIndividuals = readHapsSamplesFile(samplesFile);
 }
 
-void HapsMatrixType::readHapsFile(const fs::path& hapsFile) {
-
-  // Check that haps file is the expected shape, and size the data matrix appropriately
-  validateHapsFile(hapsFile);
-  mData.resize(static_cast<index_t>(getNumSites()), static_cast<index_t>(2ul * mNumIndividuals));
+void HapsMatrixType::readMapFile(const fs::path& mapFile) {
 
-  auto gzFile = gzopen(hapsFile.string().c_str(), "r");
+  LineReader reader(mapFile);
+  std::string_view text;
+  double geneticPosition = 0.0;
+  unsigned long physicalPosition = 0ul;
 
-  for (index_t rowId = 0l; rowId < static_cast<index_t>(getNumSites()); ++rowId) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), " ");
-    assert(line.size() == 2ul * mNumIndividuals + 5ul);
-    for (index_t colId = 0l; colId < static_cast<index_t>(2ul * mNumIndividuals); ++colId) {
-      assert(line[static_cast<size_t>(5l + colId)].size() == 1ul);
-      mData(rowId, colId) = line[static_cast<size_t>(5l + colId)] == "1";
+  while (reader.nextLine(text)) {
+    if (parseHapsMapRow(text, geneticPosition, physicalPosition)) {
+      mGeneticPositions.emplace_back(geneticPosition);
+      mPhysicalPositions.emplace_back(physicalPosition);
     }
   }
-
-  gzclose(gzFile);
 }
 
-void HapsMatrixType::readMapFile(const fs::path& mapFile) {
-
-  auto gzFile = gzopen(mapFile.string().c_str(), "r");
-
-  while (!gzeof(gzFile)) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), "\t");
-    if (!line.empty()) {
-      assert(line.size() == 4ul);
-      mGeneticPositions.emplace_back(std::stod(line.at(2)));
-      mPhysicalPositions.emplace_back(std::stoul(line.at(3)));
+void HapsMatrixType::readHapsFile(const fs::path& hapsFile, unsigned long numThreads) {
+
+  const unsigned long numSites = getNumSites();
+  mData = PackedHaplotypeMatrix(getNumHaps(), numSites);
+
+  LineReader reader(hapsFile, LineReader::defaultBufferSize, numThreads);
+  auto readBatch = [&reader](std::vector<HapsChunk>& batch) {
+    unsigned long numChunks = 0ul;
+    while (numChunks < batch.size()) {
+      const unsigned long firstLine = reader.getLineNumber();
+      HapsChunk& chunk = batch[numChunks];
+      if (!reader.nextLines(chunk.storage, chunk.text)) {
+        break;
+      }
+      numChunks++;
+      chunk.firstLine = firstLine;
+      chunk.numExtraLines = 0ul;
+      chunk.error.clear();
     }
+    return numChunks;
+  };
+
+  // Store the rows of one chunk, stopping at its first invalid row. Lines beyond the expected number of sites are
+  // only counted, other than empty lines, such as a possible expected newline at the end of the file
+  auto parseChunk = [this, numSites, &hapsFile](HapsChunk& chunk) {
+    std::vector<uint64_t> words(mData.getWordsPerSite());
+    std::string_view text = chunk.text;
+    for (unsigned long lineId = chunk.firstLine; !text.empty(); ++lineId) {
+      const std::string_view line = popLine(text);
+      if (lineId >= numSites) {
+        chunk.numExtraLines += line.empty() ? 0ul : 1ul;
+        continue;
+      }
+      try {
+        parseHapsRow(line, mNumIndividuals, words.data());
+      } catch (const std::runtime_error& e) {
+        chunk.error = fmt::format("Error on line {} of {}:\n{}", 1ul + lineId, hapsFile.string(), e.what());
+        return;
+      }
+      mData.setSite(lineId, words.data());
+    }
+  };
+
+  // Chunks are checked in order, so the error reported is the first in the file whatever the number of threads
+  const unsigned long chunksPerBatch = resolveNumThreads(numThreads);
+  std::vector<HapsChunk> batch(chunksPerBatch);
+  std::vector<HapsChunk> nextBatch(chunksPerBatch);
+  unsigned long numChunks = readBatch(batch);
+  unsigned long numExtraLines = 0ul;
+  while (numChunks > 0ul) {
+    auto pendingRead = std::async(std::launch::async, readBatch, std::ref(nextBatch));
+    parallelFor(0ul, numChunks, chunksPerBatch, [&](unsigned long first, unsigned long last) {
+      for (unsigned long chunkId = first; chunkId < last; ++chunkId) {
+        parseChunk(batch[chunkId]);
+      }
+    });
+    pendingRead.wait();
+
+    for (unsigned long chunkId = 0ul; chunkId < numChunks; ++chunkId) {
+      if (!batch[chunkId].error.empty()) {
+        throw std::runtime_error(batch[chunkId].error);
+      }
+      numExtraLines += batch[chunkId].numExtraLines;
+    }
+    numChunks = pendingRead.get();
+    std::swap(batch, nextBatch);
   }
 
-  gzclose(gzFile);
-}
-
-void HapsMatrixType::validateHapsFile(const fs::path& hapsFile) {
-
-  auto gzFile = gzopen(hapsFile.string().c_str(), "r");
-  unsigned long linesInFile = 0ul;
-
-  // Get as many lines as we expect are valid, and check that they are valid
-  for (unsigned long siteId = 0; siteId < getNumSites(); ++siteId) {
+  // A file with too few lines has an empty row at its end
+  const unsigned long linesRead = reader.getLineNumber();
+  if (linesRead < numSites) {
     try {
-      validateHapsRow(splitTextByDelimiter(readNextLineFromGzip(gzFile), " "));
+      std::vector<uint64_t> words(mData.getWordsPerSite());
+      parseHapsRow({}, mNumIndividuals, words.data());
     } catch (const std::runtime_error& e) {
-      gzclose(gzFile);
-      throw std::runtime_error(fmt::format("Error on line {} of {}:\n{}", 1ul + siteId, hapsFile.string(), e.what()));
-    }
-    linesInFile++;
-  }
-
-  // Check for any extra lines, other than a possible expected newline at the end of the file
-  while (!gzeof(gzFile)) {
-    if (!readNextLineFromGzip(gzFile).empty()) {
-      linesInFile++;
+      throw std::runtime_error(
+          fmt::format("Error on line {} of {}:\n{}", 1ul + linesRead, hapsFile.string(), e.what()));
     }
   }
 
   // Error if there are the wrong number of lines
-  if (linesInFile != getNumSites()) {
-    gzclose(gzFile);
+  const unsigned long linesInFile = numSites + numExtraLines;
+  if (linesInFile != numSites) {
     throw std::runtime_error(
-        fmt::format("Expected {} to contain {} lines, but found {}", hapsFile.string(), getNumSites(), linesInFile));
-  }
-
-  gzclose(gzFile);
-}
-
-void HapsMatrixType::validateHapsRow(const std::vector<std::string>& row) const {
-
-  // Check that the row contains the correct number of elements
-  const unsigned long expectedNumCols = 2ul * mNumIndividuals + 5ul;
-  if (row.size() != expectedNumCols) {
-    throw std::runtime_error(fmt::format("Expected row to contain to contain 2x{}+5={} entries, but found {}",
-                                         mNumIndividuals, expectedNumCols, row.size()));
-  }
-
-  // Check that the 2N boolean values are either 0 or 1
-  for (unsigned long col = 5; col < expectedNumCols; ++col) {
-    if (!(row[col] == "0" || row[col] == "1"))
-      throw std::runtime_error(
-          fmt::format("Expected row to contain to boolean data, but column {} was \"{}\"", 1ul + col, row[col]));
+        fmt::format("Expected {} to contain {} lines, but found {}", hapsFile.string(), numSites, linesInFile));
   }
 }
 
@@ -179,33 +196,51 @@ const std::vector<double>& HapsMatrixType::getGeneticPositions() const {
   return mGeneticPositions;
 }
 
-const mat_uint8_t& HapsMatrixType::getData() const {
+const PackedHaplotypeMatrix& HapsMatrixType::getPackedData() const {
   return mData;
 }
 
+mat_uint8_t HapsMatrixType::getData() const {
+  mat_uint8_t data(static_cast<index_t>(getNumSites()), static_cast<index_t>(getNumHaps()));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    mData.unpackSite(siteId, data.data() + siteId, data.outerStride());
+  }
+  return data;
+}
+
 mat_float_t HapsMatrixType::getDataAsFloat() const {
-  return mData.cast<float>();
+  return getData().cast<float>();
 }
 
 rvec_uint8_t HapsMatrixType::getSite(unsigned long siteId) const {
   assert(siteId < getNumSites());
-  return mData.row(static_cast<index_t>(siteId));
+  rvec_uint8_t site(static_cast<index_t>(getNumHaps()));
+  mData.unpackSite(siteId, site.data());
+  return site;
 }
 
 cvec_uint8_t HapsMatrixType::getHap(unsigned long hapId) const {
   assert(hapId < getNumHaps());
-  return mData.col(static_cast<index_t>(hapId));
+  cvec_uint8_t hap(static_cast<index_t>(getNumSites()));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    hap[static_cast<index_t>(siteId)] = mData.getAllele(hapId, siteId);
+  }
+  return hap;
 }
 
 mat_uint8_t HapsMatrixType::getIndividual(unsigned long individualId) const {
   assert(individualId < getNumIndividuals());
-  return mData.block(static_cast<index_t>(0), static_cast<index_t>(2ul * individualId), mData.rows(),
-                     static_cast<index_t>(2ul));
+  mat_uint8_t individual(static_cast<index_t>(getNumSites()), static_cast<index_t>(2));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    individual(static_cast<index_t>(siteId), 0) = mData.getAllele(2ul * individualId, siteId);
+    individual(static_cast<index_t>(siteId), 1) = mData.getAllele(2ul * individualId + 1ul, siteId);
+  }
+  return individual;
 }
 
 unsigned long HapsMatrixType::getAlleleCount(unsigned long siteId) const {
   assert(siteId < getNumSites());
-  return mData.row(static_cast<index_t>(siteId)).cast<unsigned long>().sum();
+  return mData.getAlleleCount(siteId);
 }
 
 unsigned long HapsMatrixType::getMinorAlleleCount(unsigned long siteId) const {
@@ -220,7 +255,11 @@ unsigned long HapsMatrixType::getDerivedAlleleCount(unsigned long siteId) const
 }
 
 cvec_ul_t HapsMatrixType::getAlleleCounts() const {
-  return mData.cast<unsigned long>().rowwise().sum();
+  cvec_ul_t counts(static_cast<index_t>(getNumSites()));
+  for (unsigned long siteId = 0ul; siteId < getNumSites(); ++siteId) {
+    counts[static_cast<index_t>(siteId)] = mData.getAlleleCount(siteId);
+  }
+  return counts;
 }
 
 cvec_ul_t HapsMatrixType::getMinorAlleleCounts() const {
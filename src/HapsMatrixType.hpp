@@ -5,7 +5,9 @@
 #define DATA_MODULE_HAPS_MATRIX_TYPE_HPP
 
 #include "EigenTypes.hpp"
+#include "PackedHaplotypeMatrix.hpp"
 
+#include <cstdint>
 #include <filesystem>
 #include <string_view>
 #include <vector>
@@ -17,7 +19,9 @@ namespace asmc {
 namespace fs = std::filesystem;
 
 /**
- * A class that stores information in a #sites x #haps matrix of booleans.
+ * A class that stores information in a #sites x #haps matrix of booleans, packed at one bit per allele. Allele counts
+ * and frequencies are computed with popcounts of the packed words, and the accessors returning Eigen types unpack the
+ * alleles on demand.
  */
 class HapsMatrixType {
 
@@ -32,7 +36,7 @@ private:
   std::vector<double> mGeneticPositions;
 
   /** The #sites x #haps matrix of booleans, where #haps is 2x #individuals */
-  mat_uint8_t mData;
+  PackedHaplotypeMatrix mData;
 
   /**
    * Read data out of the .sample[s] file, which contains metadata about each individual.
@@ -43,9 +47,18 @@ private:
   /**
    * Read data out of the .hap[s][.gz] file, which contains #sites rows, and 5 + 2 * #individuals columns. The first 5
    * columns contain metadata, followed by two columns of boolean values per individual.
+   *
+   * The file is read in a single streaming pass. A background thread reads the decompressed text in chunks of whole
+   * lines, one chunk per parser thread, and each batch of chunks is parsed in parallel while the next is read. Each
+   * chunk knows the line it starts at, so its rows are stored directly into their own sites. A std::runtime_error will
+   * be thrown, giving the line number of the first problem in the file, if:
+   *  1. a row does not contain 5 + 2N columns, where N is the number of individuals
+   *  2. a row contains anything other than 0 or 1 in the haps columns
+   *  3. the number of rows is not equal to the number of sites, determined from the .map file
    * @param hapsFile path to the .hap[s][.gz] file
+   * @param numThreads the number of threads to decompress and parse rows with, where 0 means one per hardware thread
    */
-  void readHapsFile(const fs::path& hapsFile);
+  void readHapsFile(const fs::path& hapsFile, unsigned long numThreads);
 
   /**
    * Read data from the .map file, which contains genetic and physical positions for each site.
@@ -53,23 +66,6 @@ private:
    */
   void readMapFile(const fs::path& mapFile);
 
-  /**
-   * Validate the haps file by checking:
-   *  1. every row contains 5 + 2N columns, where N is the number of individuals
-   *  2. every row contains only boolean values in the haps columns
-   *  3. the number of rows is equal to the number of sites, determined from the .map file
-   * @param hapsFile path to the .hap[s][.gz] file
-   */
-  void validateHapsFile(const fs::path& hapsFile);
-
-  /**
-   * Validate an individual row from the .hap[s][.gz] file:
-   *  1. it contains exactly 5 + 2N columns, where N is the number of individuals
-   *  2. it contains only boolean values in the haps columns
-   * @param row the row read from the .hap[s][.gz] file
-   */
-  void validateHapsRow(const std::vector<std::string>& row) const;
-
   /**
    * Get the raw allele count for a given site.
    * @param siteId the site ID
@@ -95,10 +91,12 @@ public:
    * @param hapsFile path to the .hap[s][.gz] file
    * @param samplesFile path to the .sample[s] file
    * @param mapFile path to the .map file
+   * @param numThreads the number of threads to decompress and parse the .hap[s][.gz] file with, where 0 means one per
+   * hardware thread
    * @return instance of a HapsMatrixType
    */
   static HapsMatrixType createFromHapsPlusSamples(std::string_view hapsFile, std::string_view samplesFile,
-                                                  std::string_view mapFile);
+                                                  std::string_view mapFile, unsigned long numThreads = 1ul);
 
   /**
    * @return the number of individuals, determined from the .sample[s] file
@@ -126,9 +124,14 @@ public:
   [[nodiscard]] const std::vector<double>& getGeneticPositions() const;
 
   /**
-   * @return the matrix of raw uint8_t data
+   * @return the packed matrix of alleles, one bit per haplotype
+   */
+  [[nodiscard]] const PackedHaplotypeMatrix& getPackedData() const;
+
+  /**
+   * @return the matrix of raw uint8_t data, unpacked from bits
    */
-  [[nodiscard]] const mat_uint8_t& getData() const;
+  [[nodiscard]] mat_uint8_t getData() const;
 
   /**
    * @return the matrix of raw data, cast to float
@@ -0,0 +1,383 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "LdMatrix.hpp"
+
+#include "BedMatrixType.hpp"
+#include "HapsMatrixType.hpp"
+#include "utils/BedUtils.hpp"
+#include "utils/ThreadUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+namespace {
+
+/** Number of samples held in each word of a bit-plane */
+constexpr unsigned long samplesPerWord = 64ul;
+
+/**
+ * Sites stored as bit-planes: plane p of site s is a run of words, with bit k of word w set according to sample
+ * 64w + k. Bits beyond the last sample are zero in every plane.
+ */
+struct SitePlanes {
+  unsigned long numPlanes = 0ul;
+  unsigned long wordsPerPlane = 0ul;
+  std::vector<uint64_t> words;
+
+  SitePlanes(unsigned long numSites, unsigned long planes, unsigned long numSamples)
+      : numPlanes{planes}, wordsPerPlane{(numSamples + samplesPerWord - 1ul) / samplesPerWord},
+        words(numSites * planes * wordsPerPlane, 0ull) {
+  }
+
+  uint64_t* plane(unsigned long siteId, unsigned long planeId) {
+    return words.data() + (siteId * numPlanes + planeId) * wordsPerPlane;
+  }
+
+  [[nodiscard]] const uint64_t* plane(unsigned long siteId, unsigned long planeId) const {
+    return words.data() + (siteId * numPlanes + planeId) * wordsPerPlane;
+  }
+};
+
+/**
+ * Gather the even-numbered bits of a word into its low 32 bits, so that bit 2k moves to bit k.
+ */
+inline uint64_t compactEvenBits(uint64_t word) {
+  word &= 0x5555555555555555ull;
+  word = (word | (word >> 1u)) & 0x3333333333333333ull;
+  word = (word | (word >> 2u)) & 0x0F0F0F0F0F0F0F0Full;
+  word = (word | (word >> 4u)) & 0x00FF00FF00FF00FFull;
+  word = (word | (word >> 8u)) & 0x0000FFFF0000FFFFull;
+  word = (word | (word >> 16u)) & 0x00000000FFFFFFFFull;
+  return word;
+}
+
+/**
+ * Convert a row of packed .bed bytes into three planes: at least one copy of the second allele (codes 10 and 11), two
+ * copies (code 11), and observed (any code but 01).
+ *
+ * @param row the packed row, padded with zero bytes to a multiple of 16 bytes
+ * @param numIndividuals the number of individuals
+ * @param carrier the plane of individuals with at least one copy of the second allele
+ * @param homozygous the plane of individuals with two copies of the second allele
+ * @param observed the plane of individuals with a genotype that is not missing
+ */
+void bedRowToPlanes(const uint8_t* row, unsigned long numIndividuals, uint64_t* carrier, uint64_t* homozygous,
+                    uint64_t* observed) {
+  const unsigned long numWords = (numIndividuals + samplesPerWord - 1ul) / samplesPerWord;
+  for (unsigned long w = 0ul; w < numWords; ++w) {
+    uint64_t halves[2];
+    std::memcpy(halves, row + 16ul * w, sizeof(halves));
+    const uint64_t low = compactEvenBits(halves[0]) | (compactEvenBits(halves[1]) << 32u);
+    const uint64_t high = compactEvenBits(halves[0] >> 1u) | (compactEvenBits(halves[1] >> 1u) << 32u);
+    uint64_t valid = ~0ull;
+    if (const unsigned long remainder = numIndividuals - w * samplesPerWord; remainder < samplesPerWord) {
+      valid = (1ull << remainder) - 1ull;
+    }
+    carrier[w] = high & valid;
+    homozygous[w] = low & high & valid;
+    observed[w] = ~(low & ~high) & valid;
+  }
+}
+
+/**
+ * Convert r^2 and D' from sums over the samples observed at both sites of a pair, computed exactly in integers.
+ *
+ * @param n the number of samples observed at both sites
+ * @param sumA the sum of values at the first site
+ * @param sumAA the sum of squared values at the first site
+ * @param sumB the sum of values at the second site
+ * @param sumBB the sum of squared values at the second site
+ * @param sumAB the sum of products of values at the two sites
+ * @param ploidy the number of haplotypes summed in each value: 1 for haplotypes, 2 for genotype dosages
+ * @param r2 receives r^2, or NaN if either site is monomorphic among the samples
+ * @param dPrime receives D', or NaN if it is undefined
+ */
+void ldFromSums(int64_t n, int64_t sumA, int64_t sumAA, int64_t sumB, int64_t sumBB, int64_t sumAB, double ploidy,
+                float& r2, float& dPrime) {
+  constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+  if (n == 0) {
+    r2 = nan;
+    dPrime = nan;
+    return;
+  }
+
+  // n^2 times the covariance and variances
+  const auto cov = static_cast<double>(n * sumAB - sumA * sumB);
+  const auto varA = static_cast<double>(n * sumAA - sumA * sumA);
+  const auto varB = static_cast<double>(n * sumBB - sumB * sumB);
+  r2 = varA > 0.0 && varB > 0.0 ? static_cast<float>((cov / varA) * (cov / varB)) : nan;
+
+  const auto numSamples = static_cast<double>(n);
+  const double d = cov / (numSamples * numSamples * ploidy);
+  const double pA = static_cast<double>(sumA) / (numSamples * ploidy);
+  const double pB = static_cast<double>(sumB) / (numSamples * ploidy);
+  const double dMax =
+      d < 0.0 ? std::min(pA * pB, (1.0 - pA) * (1.0 - pB)) : std::min(pA * (1.0 - pB), (1.0 - pA) * pB);
+  dPrime = dMax > 0.0 ? static_cast<float>(std::clamp(d / dMax, -1.0, 1.0)) : nan;
+}
+
+/**
+ * For each site i, find one past the last site j such that (i, j) is within the LD window and on the same chromosome.
+ *
+ * @param options the LD options
+ * @param physicalPositions the physical position of each site
+ * @param geneticPositions the genetic position of each site
+ * @param chrCodes the chromosome code of each site, or empty if every site is on the same chromosome
+ * @return the end of the window of each site
+ */
+std::vector<unsigned long> computeWindowEnds(const LdOptions& options,
+                                             const std::vector<unsigned long>& physicalPositions,
+                                             const std::vector<double>& geneticPositions,
+                                             const std::vector<uint16_t>& chrCodes) {
+  if (!(options.windowSize >= 0.0)) {
+    throw std::runtime_error(fmt::format("Expected a non-negative LD window size, but got {}", options.windowSize));
+  }
+
+  const auto numSites = static_cast<unsigned long>(physicalPositions.size());
+  auto sameChromosome = [&chrCodes](unsigned long a, unsigned long b) {
+    return chrCodes.empty() || chrCodes[a] == chrCodes[b];
+  };
+
+  for (unsigned long siteId = 1ul; siteId < numSites; ++siteId) {
+    if (!sameChromosome(siteId - 1ul, siteId)) {
+      continue;
+    }
+    if ((options.windowUnit == LdWindowUnit::BasePairs &&
+         physicalPositions[siteId] < physicalPositions[siteId - 1ul]) ||
+        (options.windowUnit == LdWindowUnit::Centimorgans &&
+         geneticPositions[siteId] < geneticPositions[siteId - 1ul])) {
+      throw std::runtime_error(
+          fmt::format("Expected site positions to be sorted within each chromosome, but site {} precedes site {}",
+                      siteId, siteId - 1ul));
+    }
+  }
+
+  auto withinWindow = [&](unsigned long a, unsigned long b) {
+    switch (options.windowUnit) {
+    case LdWindowUnit::BasePairs:
+      return static_cast<double>(physicalPositions[b] - physicalPositions[a]) <= options.windowSize;
+    case LdWindowUnit::Centimorgans:
+      return geneticPositions[b] - geneticPositions[a] <= options.windowSize;
+    default:
+      return static_cast<double>(b - a) <= options.windowSize;
+    }
+  };
+
+  std::vector<unsigned long> windowEnds(numSites);
+  unsigned long end = 0ul;
+  for (unsigned long siteId = 0ul; siteId < numSites; ++siteId) {
+    end = std::max(end, siteId + 1ul);
+    while (end < numSites && sameChromosome(siteId, end) && withinWindow(siteId, end)) {
+      ++end;
+    }
+    windowEnds[siteId] = end;
+  }
+  return windowEnds;
+}
+
+} // namespace
+
+template <typename PairFunction>
+void LdMatrix::computePairs(const std::vector<unsigned long>& windowEnds, const LdOptions& options,
+                            PairFunction&& pairLd) {
+  mNumSites = static_cast<unsigned long>(windowEnds.size());
+
+  // Each thread fills the rows of a contiguous chunk of sites, and the chunks are concatenated in order
+  const unsigned long numChunks = std::max(1ul, std::min(resolveNumThreads(options.numThreads), mNumSites));
+  std::vector<LdMatrix> chunks(numChunks);
+  parallelFor(0ul, numChunks, numChunks, [&](unsigned long first, unsigned long last) {
+    for (unsigned long chunk = first; chunk < last; ++chunk) {
+      LdMatrix& rows = chunks[chunk];
+      for (unsigned long siteA = chunk * mNumSites / numChunks; siteA < (chunk + 1ul) * mNumSites / numChunks;
+           ++siteA) {
+        for (unsigned long siteB = siteA + 1ul; siteB < windowEnds[siteA]; ++siteB) {
+          float r2 = 0.f;
+          float dPrime = 0.f;
+          pairLd(siteA, siteB, r2, dPrime);
+          if (options.minR2 <= 0.0 || static_cast<double>(r2) >= options.minR2) {
+            rows.mColumnIds.push_back(siteB);
+            rows.mR2.push_back(r2);
+            rows.mDPrime.push_back(dPrime);
+          }
+        }
+        rows.mRowOffsets.push_back(static_cast<unsigned long>(rows.mColumnIds.size()));
+      }
+    }
+  });
+
+  mRowOffsets.assign(1ul, 0ul);
+  mRowOffsets.reserve(mNumSites + 1ul);
+  for (const LdMatrix& rows : chunks) {
+    const unsigned long offset = static_cast<unsigned long>(mColumnIds.size());
+    for (auto it = rows.mRowOffsets.begin() + 1; it != rows.mRowOffsets.end(); ++it) {
+      mRowOffsets.push_back(offset + *it);
+    }
+    mColumnIds.insert(mColumnIds.end(), rows.mColumnIds.begin(), rows.mColumnIds.end());
+    mR2.insert(mR2.end(), rows.mR2.begin(), rows.mR2.end());
+    mDPrime.insert(mDPrime.end(), rows.mDPrime.begin(), rows.mDPrime.end());
+  }
+}
+
+LdMatrix LdMatrix::createFromBedMatrix(const BedMatrixType& bedMatrix, const LdOptions& options) {
+  const unsigned long numSites = bedMatrix.getNumSites();
+  const unsigned long numIndividuals = bedMatrix.getNumIndividuals();
+  const std::vector<unsigned long> windowEnds = computeWindowEnds(
+      options, bedMatrix.getPhysicalPositions(), bedMatrix.getGeneticPositions(), bedMatrix.getBim().getChrCodes());
+
+  SitePlanes planes(numSites, 3ul, numIndividuals);
+  parallelFor(0ul, numSites, options.numThreads, [&](unsigned long first, unsigned long last) {
+    std::vector<uint8_t> row(16ul * planes.wordsPerPlane, 0u);
+    for (unsigned long siteId = first; siteId < last; ++siteId) {
+      bedMatrix.copyPackedSite(siteId, row.data());
+      bedRowToPlanes(row.data(), numIndividuals, planes.plane(siteId, 0ul), planes.plane(siteId, 1ul),
+                     planes.plane(siteId, 2ul));
+    }
+  });
+
+  LdMatrix ld;
+  ld.computePairs(windowEnds, options, [&planes](unsigned long siteA, unsigned long siteB, float& r2, float& dPrime) {
+    const uint64_t* carrierA = planes.plane(siteA, 0ul);
+    const uint64_t* homozygousA = planes.plane(siteA, 1ul);
+    const uint64_t* observedA = planes.plane(siteA, 2ul);
+    const uint64_t* carrierB = planes.plane(siteB, 0ul);
+    const uint64_t* homozygousB = planes.plane(siteB, 1ul);
+    const uint64_t* observedB = planes.plane(siteB, 2ul);
+
+    // A dosage is carrier + homozygous, and its square is carrier + 3 homozygous. Missing genotypes are zero in the
+    // carrier and homozygous planes, so products need no mask, but single-site sums are masked by the other site.
+    unsigned long n = 0ul;
+    unsigned long carrierASum = 0ul;
+    unsigned long homozygousASum = 0ul;
+    unsigned long carrierBSum = 0ul;
+    unsigned long homozygousBSum = 0ul;
+    unsigned long productSum = 0ul;
+    withHardwarePopcount([&] {
+      for (unsigned long w = 0ul; w < planes.wordsPerPlane; ++w) {
+        n += popcount64(observedA[w] & observedB[w]);
+        carrierASum += popcount64(carrierA[w] & observedB[w]);
+        homozygousASum += popcount64(homozygousA[w] & observedB[w]);
+        carrierBSum += popcount64(carrierB[w] & observedA[w]);
+        homozygousBSum += popcount64(homozygousB[w] & observedA[w]);
+        productSum += popcount64(carrierA[w] & carrierB[w]) + popcount64(carrierA[w] & homozygousB[w]) +
+                      popcount64(homozygousA[w] & carrierB[w]) + popcount64(homozygousA[w] & homozygousB[w]);
+      }
+    });
+
+    const auto sumA = static_cast<int64_t>(carrierASum + homozygousASum);
+    const auto sumB = static_cast<int64_t>(carrierBSum + homozygousBSum);
+    ldFromSums(static_cast<int64_t>(n), sumA, static_cast<int64_t>(carrierASum + 3ul * homozygousASum), sumB,
+               static_cast<int64_t>(carrierBSum + 3ul * homozygousBSum), static_cast<int64_t>(productSum), 2.0, r2,
+               dPrime);
+  });
+  return ld;
+}
+
+LdMatrix LdMatrix::createFromHapsMatrix(const HapsMatrixType& hapsMatrix, const LdOptions& options) {
+  const unsigned long numSites = hapsMatrix.getNumSites();
+  const unsigned long numHaps = hapsMatrix.getNumHaps();
+  const std::vector<unsigned long> windowEnds =
+      computeWindowEnds(options, hapsMatrix.getPhysicalPositions(), hapsMatrix.getGeneticPositions(), {});
+
+  // The packed haplotypes are already a single bit-plane per site
+  const PackedHaplotypeMatrix& packed = hapsMatrix.getPackedData();
+  std::vector<unsigned long> alleleCounts(numSites);
+  parallelFor(0ul, numSites, options.numThreads, [&](unsigned long first, unsigned long last) {
+    for (unsigned long siteId = first; siteId < last; ++siteId) {
+      alleleCounts[siteId] = packed.getAlleleCount(siteId);
+    }
+  });
+
+  LdMatrix ld;
+  ld.computePairs(windowEnds, options, [&](unsigned long siteA, unsigned long siteB, float& r2, float& dPrime) {
+    const uint64_t* planeA = packed.getSiteWords(siteA);
+    const uint64_t* planeB = packed.getSiteWords(siteB);
+    const unsigned long numWords = packed.getWordsPerSite();
+    const unsigned long productSum = withHardwarePopcount([planeA, planeB, numWords] {
+      unsigned long sum = 0ul;
+      for (unsigned long w = 0ul; w < numWords; ++w) {
+        sum += popcount64(planeA[w] & planeB[w]);
+      }
+      return sum;
+    });
+
+    // Haplotypes are 0 or 1, so each sum of squares is the sum itself
+    const auto sumA = static_cast<int64_t>(alleleCounts[siteA]);
+    const auto sumB = static_cast<int64_t>(alleleCounts[siteB]);
+    ldFromSums(static_cast<int64_t>(numHaps), sumA, sumA, sumB, sumB, static_cast<int64_t>(productSum), 1.0, r2,
+               dPrime);
+  });
+  return ld;
+}
+
+unsigned long LdMatrix::findPair(unsigned long siteA, unsigned long siteB) const {
+  if (siteA > siteB) {
+    std::swap(siteA, siteB);
+  }
+  if (siteB >= mNumSites) {
+    return static_cast<unsigned long>(mColumnIds.size());
+  }
+  const auto rowBegin = mColumnIds.begin() + static_cast<std::ptrdiff_t>(mRowOffsets[siteA]);
+  const auto rowEnd = mColumnIds.begin() + static_cast<std::ptrdiff_t>(mRowOffsets[siteA + 1ul]);
+  const auto it = std::lower_bound(rowBegin, rowEnd, siteB);
+  if (it == rowEnd || *it != siteB) {
+    return static_cast<unsigned long>(mColumnIds.size());
+  }
+  return static_cast<unsigned long>(it - mColumnIds.begin());
+}
+
+unsigned long LdMatrix::getNumSites() const {
+  return mNumSites;
+}
+
+unsigned long LdMatrix::getNumPairs() const {
+  return static_cast<unsigned long>(mColumnIds.size());
+}
+
+const std::vector<unsigned long>& LdMatrix::getRowOffsets() const {
+  return mRowOffsets;
+}
+
+const std::vector<unsigned long>& LdMatrix::getColumnIds() const {
+  return mColumnIds;
+}
+
+const std::vector<float>& LdMatrix::getR2Values() const {
+  return mR2;
+}
+
+const std::vector<float>& LdMatrix::getDPrimeValues() const {
+  return mDPrime;
+}
+
+bool LdMatrix::hasPair(unsigned long siteA, unsigned long siteB) const {
+  return findPair(siteA, siteB) < mColumnIds.size();
+}
+
+float LdMatrix::getR2(unsigned long siteA, unsigned long siteB) const {
+  const unsigned long pairId = findPair(siteA, siteB);
+  if (pairId == mColumnIds.size()) {
+    throw std::runtime_error(fmt::format("LD between sites {} and {} is not stored", siteA, siteB));
+  }
+  return mR2[pairId];
+}
+
+float LdMatrix::getDPrime(unsigned long siteA, unsigned long siteB) const {
+  const unsigned long pairId = findPair(siteA, siteB);
+  if (pairId == mColumnIds.size()) {
+    throw std::runtime_error(fmt::format("LD between sites {} and {} is not stored", siteA, siteB));
+  }
+  return mDPrime[pairId];
+}
+
+} // namespace asmc
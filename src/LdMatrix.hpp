@@ -0,0 +1,157 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_LD_MATRIX_HPP
+#define DATA_MODULE_LD_MATRIX_HPP
+
+#include <vector>
+
+namespace asmc {
+
+class BedMatrixType;
+class HapsMatrixType;
+
+/**
+ * The unit in which the LD window between two sites is measured.
+ */
+enum class LdWindowUnit {
+  /** The number of sites between the two sites */
+  Sites,
+  /** The distance in base pairs between the physical positions of the two sites */
+  BasePairs,
+  /** The distance in centimorgans between the genetic positions of the two sites */
+  Centimorgans,
+};
+
+/**
+ * Options controlling which pairs of sites LdMatrix computes LD for, and which it stores.
+ */
+struct LdOptions {
+  /** The unit of windowSize */
+  LdWindowUnit windowUnit = LdWindowUnit::Sites;
+
+  /** Pairs of sites are included if they are at most this far apart, and on the same chromosome */
+  double windowSize = 100.0;
+
+  /** Only store pairs with an r^2 of at least this value. Pairs whose r^2 is undefined are only kept if this is 0 */
+  double minR2 = 0.0;
+
+  /** The number of threads to use, where 0 means one per hardware thread */
+  unsigned long numThreads = 1ul;
+};
+
+/**
+ * Pairwise linkage disequilibrium (r^2 and D') between every pair of sites within a window, held as a sparse banded
+ * matrix in compressed sparse row format. Row i holds the pairs (i, j) with j > i, in increasing order of j; the lower
+ * triangle follows by symmetry.
+ *
+ * Each site is converted to bit-planes of 64 samples per word, so that the sums needed for every pair are popcounts of
+ * ANDed words:
+ *  - for phased haplotypes, one plane holds the haplotypes carrying allele 1, and D = p_AB - p_A p_B;
+ *  - for unphased .bed genotypes, one plane holds individuals with at least one copy of the second allele, one holds
+ *    those with two, and a third masks the observed genotypes. Statistics for a pair use the individuals observed at
+ *    both sites, r^2 is the squared correlation of allele dosages, and D is the composite LD, half the covariance of
+ *    the dosages.
+ *
+ * D' is D divided by its maximum possible magnitude given the allele frequencies, so it lies in [-1, 1]. Statistics
+ * that are undefined, for example at a monomorphic site, are NaN.
+ */
+class LdMatrix {
+
+private:
+  /** The number of sites */
+  unsigned long mNumSites = 0ul;
+
+  /** The pairs of row i are stored at indices [mRowOffsets[i], mRowOffsets[i + 1]) */
+  std::vector<unsigned long> mRowOffsets = {0ul};
+
+  /** The second site of each stored pair */
+  std::vector<unsigned long> mColumnIds;
+
+  /** The r^2 of each stored pair */
+  std::vector<float> mR2;
+
+  /** The D' of each stored pair */
+  std::vector<float> mDPrime;
+
+  /**
+   * Find a stored pair.
+   * @param siteA the first site ID
+   * @param siteB the second site ID
+   * @return the index of the pair in mColumnIds, or mColumnIds.size() if it is not stored
+   */
+  [[nodiscard]] unsigned long findPair(unsigned long siteA, unsigned long siteB) const;
+
+  /**
+   * Compute and store LD for every pair of sites within the window, sharing the sites between threads.
+   * @tparam PairFunction callable with signature void(siteA, siteB, float& r2, float& dPrime)
+   * @param windowEnds for each site i, one past the last site j such that (i, j) is within the window
+   * @param options the threshold and number of threads
+   * @param pairLd the function computing LD for a pair of sites, which may be called concurrently
+   */
+  template <typename PairFunction>
+  void computePairs(const std::vector<unsigned long>& windowEnds, const LdOptions& options, PairFunction&& pairLd);
+
+public:
+  LdMatrix() = default;
+
+  /**
+   * Compute LD between the sites of a PLINK fileset, which may use any BedStorage. Missing genotypes are excluded
+   * pair by pair.
+   *
+   * @param bedMatrix the genotypes
+   * @param options the window, threshold and number of threads
+   * @return the LD matrix
+   */
+  static LdMatrix createFromBedMatrix(const BedMatrixType& bedMatrix, const LdOptions& options = {});
+
+  /**
+   * Compute LD between the sites of a set of phased haplotypes, which are treated as a single chromosome.
+   *
+   * @param hapsMatrix the haplotypes
+   * @param options the window, threshold and number of threads
+   * @return the LD matrix
+   */
+  static LdMatrix createFromHapsMatrix(const HapsMatrixType& hapsMatrix, const LdOptions& options = {});
+
+  [[nodiscard]] unsigned long getNumSites() const;
+
+  /**
+   * @return the number of stored pairs
+   */
+  [[nodiscard]] unsigned long getNumPairs() const;
+
+  [[nodiscard]] const std::vector<unsigned long>& getRowOffsets() const;
+  [[nodiscard]] const std::vector<unsigned long>& getColumnIds() const;
+  [[nodiscard]] const std::vector<float>& getR2Values() const;
+  [[nodiscard]] const std::vector<float>& getDPrimeValues() const;
+
+  /**
+   * @param siteA the first site ID
+   * @param siteB the second site ID
+   * @return whether LD between the two sites is stored; a site is not stored with itself
+   */
+  [[nodiscard]] bool hasPair(unsigned long siteA, unsigned long siteB) const;
+
+  /**
+   * Get r^2 between two sites, in either order. A std::runtime_error will be thrown if the pair is not stored.
+   *
+   * @param siteA the first site ID
+   * @param siteB the second site ID
+   * @return r^2 between the two sites
+   */
+  [[nodiscard]] float getR2(unsigned long siteA, unsigned long siteB) const;
+
+  /**
+   * Get D' between two sites, in either order. A std::runtime_error will be thrown if the pair is not stored.
+   *
+   * @param siteA the first site ID
+   * @param siteB the second site ID
+   * @return D' between the two sites
+   */
+  [[nodiscard]] float getDPrime(unsigned long siteA, unsigned long siteB) const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_LD_MATRIX_HPP
@@ -0,0 +1,63 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "PackedGenotypeMatrix.hpp"
+
+#include "utils/BedUtils.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace asmc {
+
+PackedGenotypeMatrix::PackedGenotypeMatrix(unsigned long numIndividuals, unsigned long numSites)
+    : mNumIndividuals{numIndividuals}, mNumSites{numSites},
+      mWordsPerSite{(numIndividuals + genotypesPerWord - 1ul) / genotypesPerWord},
+      mWords(mWordsPerSite * numSites, 0ull) {
+}
+
+unsigned long PackedGenotypeMatrix::getNumIndividuals() const {
+  return mNumIndividuals;
+}
+
+unsigned long PackedGenotypeMatrix::getNumSites() const {
+  return mNumSites;
+}
+
+unsigned long PackedGenotypeMatrix::getWordsPerSite() const {
+  return mWordsPerSite;
+}
+
+const uint64_t* PackedGenotypeMatrix::getSiteWords(unsigned long siteId) const {
+  assert(siteId < mNumSites);
+  return mWords.data() + siteId * mWordsPerSite;
+}
+
+const uint8_t* PackedGenotypeMatrix::getSiteBytes(unsigned long siteId) const {
+  return reinterpret_cast<const uint8_t*>(getSiteWords(siteId));
+}
+
+void PackedGenotypeMatrix::setSite(unsigned long siteId, const uint8_t* bedRow) {
+  assert(siteId < mNumSites);
+  auto* site = reinterpret_cast<uint8_t*>(mWords.data() + siteId * mWordsPerSite);
+  const std::size_t numBytes = (mNumIndividuals + 3ul) / 4ul;
+
+  std::memcpy(site, bedRow, numBytes);
+  std::memset(site + numBytes, 0, mWordsPerSite * sizeof(uint64_t) - numBytes);
+
+  // Clear the unused bits of a partially filled final byte
+  if (const unsigned long remainder = mNumIndividuals % 4ul; remainder != 0ul) {
+    site[numBytes - 1ul] = static_cast<uint8_t>(site[numBytes - 1ul] & ((1u << (2ul * remainder)) - 1u));
+  }
+}
+
+uint8_t PackedGenotypeMatrix::getGenotype(unsigned long individualId, unsigned long siteId) const {
+  assert(individualId < mNumIndividuals);
+  return bedCodeToGenotype[getBedCode(getSiteBytes(siteId), individualId)];
+}
+
+std::size_t PackedGenotypeMatrix::getSizeInBytes() const {
+  return mWords.size() * sizeof(uint64_t);
+}
+
+} // namespace asmc
@@ -0,0 +1,91 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_PACKED_GENOTYPE_MATRIX_HPP
+#define DATA_MODULE_PACKED_GENOTYPE_MATRIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace asmc {
+
+/**
+ * A #individuals x #sites matrix of genotypes stored at 2 bits per call, using the same encoding as a SNP-major .bed
+ * file. Each site occupies a whole number of 64-bit words, so every site starts on a word boundary, and genotypes in
+ * the padding at the end of each site are always zero.
+ *
+ * Genotype i of a site is held in bits 2(i%4) and 2(i%4)+1 of byte i/4 of the site, with code 00 homozygous for the
+ * first allele, 01 missing, 10 heterozygous, and 11 homozygous for the second allele.
+ */
+class PackedGenotypeMatrix {
+
+private:
+  /** The number of individuals */
+  unsigned long mNumIndividuals = 0ul;
+
+  /** The number of sites */
+  unsigned long mNumSites = 0ul;
+
+  /** The number of 64-bit words used by each site */
+  unsigned long mWordsPerSite = 0ul;
+
+  /** The packed genotypes, site after site */
+  std::vector<uint64_t> mWords;
+
+public:
+  /** Number of genotypes held in each 64-bit word */
+  static constexpr unsigned long genotypesPerWord = 32ul;
+
+  PackedGenotypeMatrix() = default;
+
+  /**
+   * Create a matrix of the given size, with every genotype set to code 00.
+   *
+   * @param numIndividuals the number of individuals
+   * @param numSites the number of sites
+   */
+  PackedGenotypeMatrix(unsigned long numIndividuals, unsigned long numSites);
+
+  [[nodiscard]] unsigned long getNumIndividuals() const;
+  [[nodiscard]] unsigned long getNumSites() const;
+  [[nodiscard]] unsigned long getWordsPerSite() const;
+
+  /**
+   * @param siteId the site ID
+   * @return pointer to the first word of the given site
+   */
+  [[nodiscard]] const uint64_t* getSiteWords(unsigned long siteId) const;
+
+  /**
+   * @param siteId the site ID
+   * @return pointer to the first byte of the given site, laid out as a row of a SNP-major .bed file
+   */
+  [[nodiscard]] const uint8_t* getSiteBytes(unsigned long siteId) const;
+
+  /**
+   * Overwrite a site with a row of packed bytes in .bed layout. Any bits beyond the last individual are cleared.
+   *
+   * @param siteId the site ID
+   * @param bedRow pointer to (#individuals + 3) / 4 bytes of packed genotypes
+   */
+  void setSite(unsigned long siteId, const uint8_t* bedRow);
+
+  /**
+   * Get a single genotype, decoded to 0, 1 or 2 copies of the second allele, or 3 for missing data.
+   *
+   * @param individualId the individual ID
+   * @param siteId the site ID
+   * @return the decoded genotype
+   */
+  [[nodiscard]] uint8_t getGenotype(unsigned long individualId, unsigned long siteId) const;
+
+  /**
+   * @return the number of bytes used to hold the genotypes
+   */
+  [[nodiscard]] std::size_t getSizeInBytes() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_PACKED_GENOTYPE_MATRIX_HPP
@@ -0,0 +1,79 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "PackedHaplotypeMatrix.hpp"
+
+#include "utils/BedUtils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace asmc {
+
+PackedHaplotypeMatrix::PackedHaplotypeMatrix(unsigned long numHaps, unsigned long numSites)
+    : mNumHaps{numHaps}, mNumSites{numSites}, mWordsPerSite{(numHaps + haplotypesPerWord - 1ul) / haplotypesPerWord},
+      mWords(mWordsPerSite * numSites, 0ull) {
+}
+
+unsigned long PackedHaplotypeMatrix::getNumHaps() const {
+  return mNumHaps;
+}
+
+unsigned long PackedHaplotypeMatrix::getNumSites() const {
+  return mNumSites;
+}
+
+unsigned long PackedHaplotypeMatrix::getWordsPerSite() const {
+  return mWordsPerSite;
+}
+
+const uint64_t* PackedHaplotypeMatrix::getSiteWords(unsigned long siteId) const {
+  assert(siteId < mNumSites);
+  return mWords.data() + siteId * mWordsPerSite;
+}
+
+void PackedHaplotypeMatrix::setSite(unsigned long siteId, const uint64_t* words) {
+  assert(siteId < mNumSites);
+  uint64_t* site = mWords.data() + siteId * mWordsPerSite;
+  std::memcpy(site, words, mWordsPerSite * sizeof(uint64_t));
+
+  // Clear the unused bits of a partially filled final word
+  if (const unsigned long remainder = mNumHaps % haplotypesPerWord; remainder != 0ul) {
+    site[mWordsPerSite - 1ul] &= (1ull << remainder) - 1ull;
+  }
+}
+
+uint8_t PackedHaplotypeMatrix::getAllele(unsigned long hapId, unsigned long siteId) const {
+  assert(hapId < mNumHaps);
+  return static_cast<uint8_t>((getSiteWords(siteId)[hapId / haplotypesPerWord] >> (hapId % haplotypesPerWord)) & 1u);
+}
+
+void PackedHaplotypeMatrix::unpackSite(unsigned long siteId, uint8_t* out, std::ptrdiff_t stride) const {
+  const uint64_t* site = getSiteWords(siteId);
+  for (unsigned long w = 0ul; w < mWordsPerSite; ++w) {
+    const unsigned long first = w * haplotypesPerWord;
+    const unsigned long last = std::min(first + haplotypesPerWord, mNumHaps);
+    uint64_t word = site[w];
+    for (unsigned long hapId = first; hapId < last; ++hapId, word >>= 1u) {
+      out[static_cast<std::ptrdiff_t>(hapId) * stride] = static_cast<uint8_t>(word & 1u);
+    }
+  }
+}
+
+unsigned long PackedHaplotypeMatrix::getAlleleCount(unsigned long siteId) const {
+  const uint64_t* site = getSiteWords(siteId);
+  return withHardwarePopcount([site, this] {
+    unsigned long count = 0ul;
+    for (unsigned long w = 0ul; w < mWordsPerSite; ++w) {
+      count += popcount64(site[w]);
+    }
+    return count;
+  });
+}
+
+std::size_t PackedHaplotypeMatrix::getSizeInBytes() const {
+  return mWords.size() * sizeof(uint64_t);
+}
+
+} // namespace asmc
@@ -0,0 +1,97 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_PACKED_HAPLOTYPE_MATRIX_HPP
+#define DATA_MODULE_PACKED_HAPLOTYPE_MATRIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace asmc {
+
+/**
+ * A #sites x #haps matrix of phased haplotype alleles stored at 1 bit per allele. Each site occupies a whole number of
+ * 64-bit words, so every site starts on a word boundary, and bits in the padding at the end of each site are always
+ * zero.
+ *
+ * The allele of haplotype h at a site is held in bit h%64 of word h/64 of the site.
+ */
+class PackedHaplotypeMatrix {
+
+private:
+  /** The number of haplotypes */
+  unsigned long mNumHaps = 0ul;
+
+  /** The number of sites */
+  unsigned long mNumSites = 0ul;
+
+  /** The number of 64-bit words used by each site */
+  unsigned long mWordsPerSite = 0ul;
+
+  /** The packed alleles, site after site */
+  std::vector<uint64_t> mWords;
+
+public:
+  /** Number of haplotypes held in each 64-bit word */
+  static constexpr unsigned long haplotypesPerWord = 64ul;
+
+  PackedHaplotypeMatrix() = default;
+
+  /**
+   * Create a matrix of the given size, with every allele set to 0.
+   *
+   * @param numHaps the number of haplotypes
+   * @param numSites the number of sites
+   */
+  PackedHaplotypeMatrix(unsigned long numHaps, unsigned long numSites);
+
+  [[nodiscard]] unsigned long getNumHaps() const;
+  [[nodiscard]] unsigned long getNumSites() const;
+  [[nodiscard]] unsigned long getWordsPerSite() const;
+
+  /**
+   * @param siteId the site ID
+   * @return pointer to the first word of the given site
+   */
+  [[nodiscard]] const uint64_t* getSiteWords(unsigned long siteId) const;
+
+  /**
+   * Overwrite a site with a row of packed words. Any bits beyond the last haplotype are cleared.
+   *
+   * @param siteId the site ID
+   * @param words pointer to getWordsPerSite() words of packed alleles
+   */
+  void setSite(unsigned long siteId, const uint64_t* words);
+
+  /**
+   * @param hapId the haplotype ID
+   * @param siteId the site ID
+   * @return the allele, 0 or 1
+   */
+  [[nodiscard]] uint8_t getAllele(unsigned long hapId, unsigned long siteId) const;
+
+  /**
+   * Unpack a site to one byte per haplotype.
+   *
+   * @param siteId the site ID
+   * @param out pointer to #haps bytes to receive the alleles
+   * @param stride the distance between consecutive alleles in out
+   */
+  void unpackSite(unsigned long siteId, uint8_t* out, std::ptrdiff_t stride = 1) const;
+
+  /**
+   * @param siteId the site ID
+   * @return the number of haplotypes carrying allele 1 at the site
+   */
+  [[nodiscard]] unsigned long getAlleleCount(unsigned long siteId) const;
+
+  /**
+   * @return the number of bytes used to hold the alleles
+   */
+  [[nodiscard]] std::size_t getSizeInBytes() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_PACKED_HAPLOTYPE_MATRIX_HPP
@@ -4,20 +4,28 @@
 #include "PlinkMap.hpp"
 
 #include "utils/FileUtils.hpp"
+#include "utils/LineReader.hpp"
+#include "utils/MetadataCache.hpp"
 #include "utils/StringUtils.hpp"
 #include "utils/VectorUtils.hpp"
 
 #include <exception>
 #include <iostream>
+#include <utility>
 
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
 namespace asmc {
 
-PlinkMap::PlinkMap(std::string_view mapFile) : mInputFile{mapFile} {
-  validateFile();
-  readFile();
+PlinkMap::PlinkMap(std::string_view mapFile, bool useCache) : mInputFile{mapFile} {
+  if (!useCache || !readCache()) {
+    validateFile();
+    readFile();
+    if (useCache) {
+      writeCache();
+    }
+  }
   validateMap();
 }
 
@@ -58,14 +66,14 @@ void PlinkMap::readFile() {
   const unsigned long genCol = 2ul;
   const unsigned long physCol = mNumCols == 4ul ? 3ul : 2ul;
 
-  auto gzFile = gzopen(mInputFile.string().c_str(), "r");
+  LineReader reader(mInputFile);
+  std::string_view text;
 
-  while (!gzeof(gzFile)) {
-    std::vector<std::string> line = splitTextByDelimiter(readNextLineFromGzip(gzFile), "\t");
+  while (reader.nextLine(text)) {
+    std::vector<std::string> line = splitTextByDelimiter(text, "\t");
     if (!line.empty()) {
 
       if (line.size() != mNumCols) {
-        gzclose(gzFile);
         throw std::runtime_error(
             fmt::format("Error: PLINK map file {} line {} contains {} columns, but line 1 contains {} columns\n",
                         mInputFile.string(), 1ul + mChrIds.size(), line.size(), mNumCols));
@@ -77,7 +85,6 @@ void PlinkMap::readFile() {
         try {
           mGeneticPositions.emplace_back(dblFromString(line.at(genCol)));
         } catch (const std::runtime_error& e) {
-          gzclose(gzFile);
           throw std::runtime_error(fmt::format(
               "Error: PLINK map file {} line {} column {}: expected floating point but got {}\n{}\n",
               mInputFile.string(), 1ul + mGeneticPositions.size(), 1ul + genCol, line.at(physCol), e.what()));
@@ -87,15 +94,12 @@ void PlinkMap::readFile() {
       try {
         mPhysicalPositions.emplace_back(ulFromString(line.at(physCol)));
       } catch (const std::runtime_error& e) {
-        gzclose(gzFile);
         throw std::runtime_error(fmt::format(
             "Error: PLINK map file {} line {} column {}: expected unsigned integer but got {}\n{}\n",
             mInputFile.string(), 1ul + mPhysicalPositions.size(), 1ul + physCol, line.at(physCol), e.what()));
       }
     }
   }
-
-  gzclose(gzFile);
 }
 
 void PlinkMap::validateMap() {
@@ -139,6 +143,47 @@ void PlinkMap::validateMap() {
   }
 }
 
+bool PlinkMap::readCache() {
+  auto cache = MetadataCacheReader::open(mInputFile, "plinkmap");
+  if (!cache) {
+    return false;
+  }
+
+  try {
+    const auto numCols = cache->readValue<unsigned long>();
+    std::vector<std::string> chrIds = cache->readStrings().toVector();
+    std::vector<std::string> snpIds = cache->readStrings().toVector();
+    std::vector<double> geneticPositions = cache->readVector<double>();
+    std::vector<unsigned long> physicalPositions = cache->readVector<unsigned long>();
+
+    const std::size_t numSites = physicalPositions.size();
+    if (chrIds.size() != numSites || snpIds.size() != numSites ||
+        geneticPositions.size() != (numCols == 4ul ? numSites : 0ul)) {
+      return false;
+    }
+
+    mNumCols = numCols;
+    mNumSites = static_cast<unsigned long>(numSites);
+    mChrIds = std::move(chrIds);
+    mSnpIds = std::move(snpIds);
+    mGeneticPositions = std::move(geneticPositions);
+    mPhysicalPositions = std::move(physicalPositions);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+  return true;
+}
+
+void PlinkMap::writeCache() const {
+  MetadataCacheWriter cache("plinkmap");
+  cache.writeValue(mNumCols);
+  cache.writeStrings(mChrIds);
+  cache.writeStrings(mSnpIds);
+  cache.writeVector(mGeneticPositions);
+  cache.writeVector(mPhysicalPositions);
+  cache.save(mInputFile);
+}
+
 unsigned long PlinkMap::getNumSites() const {
   return mNumSites;
 }
@@ -63,6 +63,18 @@ private:
    */
   void validateMap();
 
+  /**
+   * Load the parsed map from its binary sidecar, if it has a valid one.
+   *
+   * @return whether the sidecar was loaded
+   */
+  bool readCache();
+
+  /**
+   * Write the parsed map to its binary sidecar, ignoring any failure to do so.
+   */
+  void writeCache() const;
+
 public:
   /**
    * Read a PLINK .map file: a text file with no header file, and one line per variant with the following 3-4 fields:
@@ -73,8 +85,10 @@ public:
    * All lines must have the same number of columns.
    *
    * @param mapFile path to the .map file
+   * @param useCache whether to load the map from a binary sidecar next to the file, if it is up to date, and to write
+   * the sidecar after parsing the file otherwise
    */
-  explicit PlinkMap(std::string_view mapFile);
+  explicit PlinkMap(std::string_view mapFile, bool useCache = false);
 
   [[nodiscard]] unsigned long getNumSites() const;
   [[nodiscard]] unsigned long getNumCols() const;
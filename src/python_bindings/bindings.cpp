@@ -2,8 +2,12 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "BedBlockReader.hpp"
 #include "BedMatrixType.hpp"
+#include "GeneticRelationshipMatrix.hpp"
+#include "HapsBlockReader.hpp"
 #include "HapsMatrixType.hpp"
+#include "LdMatrix.hpp"
 
 #include "utils/StringUtils.hpp"
 
@@ -14,7 +18,8 @@ PYBIND11_MODULE(asmc_data_module, m) {
   m.def("stripBack", &asmc::stripBack);
 
   py::class_<asmc::HapsMatrixType>(m, "HapsMatrixType")
-      .def_static("createFromHapsPlusSamples", &asmc::HapsMatrixType::createFromHapsPlusSamples)
+      .def_static("createFromHapsPlusSamples", &asmc::HapsMatrixType::createFromHapsPlusSamples, py::arg("hapsFile"),
+                  py::arg("samplesFile"), py::arg("mapFile"), py::arg("numThreads") = 1ul)
       .def("getNumIndividuals", &asmc::HapsMatrixType::getNumIndividuals)
       .def("getNumHaps", &asmc::HapsMatrixType::getNumHaps)
       .def("getNumSites", &asmc::HapsMatrixType::getNumSites)
@@ -34,19 +39,75 @@ PYBIND11_MODULE(asmc_data_module, m) {
       .def("getMinorAlleleFrequencies", &asmc::HapsMatrixType::getMinorAlleleFrequencies)
       .def("getDerivedAlleleFrequencies", &asmc::HapsMatrixType::getDerivedAlleleFrequencies)
       ;
+  py::enum_<asmc::BedStorage>(m, "BedStorage")
+      .value("Decoded", asmc::BedStorage::Decoded)
+      .value("MemoryMapped", asmc::BedStorage::MemoryMapped)
+      .value("Packed", asmc::BedStorage::Packed);
+  py::class_<asmc::BedLoadOptions>(m, "BedLoadOptions")
+      .def(py::init<>())
+      .def_readwrite("storage", &asmc::BedLoadOptions::storage)
+      .def_readwrite("numThreads", &asmc::BedLoadOptions::numThreads)
+      .def_readwrite("cacheSiteStatistics", &asmc::BedLoadOptions::cacheSiteStatistics)
+      .def_readwrite("useMetadataCache", &asmc::BedLoadOptions::useMetadataCache)
+      .def_readwrite("keepIndividualIds", &asmc::BedLoadOptions::keepIndividualIds)
+      .def_readwrite("extractSiteIds", &asmc::BedLoadOptions::extractSiteIds)
+      .def_readwrite("chromosome", &asmc::BedLoadOptions::chromosome)
+      .def_readwrite("regionStart", &asmc::BedLoadOptions::regionStart)
+      .def_readwrite("regionEnd", &asmc::BedLoadOptions::regionEnd);
+  py::class_<asmc::GenotypeExportOptions>(m, "GenotypeExportOptions")
+      .def(py::init<>())
+      .def_readwrite("impute", &asmc::GenotypeExportOptions::impute)
+      .def_readwrite("centre", &asmc::GenotypeExportOptions::centre)
+      .def_readwrite("scale", &asmc::GenotypeExportOptions::scale);
   py::class_<asmc::BedMatrixType>(m, "BedMatrixType")
-      .def_static("createFromBedBimFam", &asmc::BedMatrixType::createFromBedBimFam)
+      .def_static("createFromBedBimFam", &asmc::BedMatrixType::createFromBedBimFam, py::arg("bedFile"),
+                  py::arg("bimFile"), py::arg("famFile"), py::arg("options") = asmc::BedLoadOptions())
+      .def("getStorage", &asmc::BedMatrixType::getStorage)
       .def("getNumIndividuals", &asmc::BedMatrixType::getNumIndividuals)
       .def("getNumSites", &asmc::BedMatrixType::getNumSites)
       .def("getPhysicalPositions", &asmc::BedMatrixType::getPhysicalPositions)
       .def("getGeneticPositions", &asmc::BedMatrixType::getGeneticPositions)
       .def("getSiteNames", &asmc::BedMatrixType::getSiteNames)
+      .def("getSiteName", &asmc::BedMatrixType::getSiteName)
+      .def("getChrIds", &asmc::BedMatrixType::getChrIds)
+      .def("getIndividualIds", &asmc::BedMatrixType::getIndividualIds)
       .def("getData", &asmc::BedMatrixType::getData)
       .def("getDataAsFloat", &asmc::BedMatrixType::getDataAsFloat)
+      .def("exportData",
+           py::overload_cast<Eigen::Ref<asmc::mat_float_t>, const asmc::GenotypeExportOptions&, unsigned long>(
+               &asmc::BedMatrixType::exportData, py::const_),
+           py::arg("out").noconvert(), py::arg("options") = asmc::GenotypeExportOptions(), py::arg("numThreads") = 1ul)
+      .def("exportData",
+           py::overload_cast<Eigen::Ref<asmc::mat_dbl_t>, const asmc::GenotypeExportOptions&, unsigned long>(
+               &asmc::BedMatrixType::exportData, py::const_),
+           py::arg("out").noconvert(), py::arg("options") = asmc::GenotypeExportOptions(), py::arg("numThreads") = 1ul)
+      .def("exportData",
+           py::overload_cast<Eigen::Ref<asmc::mat_int8_t>, const asmc::GenotypeExportOptions&, unsigned long>(
+               &asmc::BedMatrixType::exportData, py::const_),
+           py::arg("out").noconvert(), py::arg("options") = asmc::GenotypeExportOptions(), py::arg("numThreads") = 1ul)
+      .def("exportSites",
+           py::overload_cast<unsigned long, Eigen::Ref<asmc::mat_float_t>, const asmc::GenotypeExportOptions&,
+                             unsigned long>(&asmc::BedMatrixType::exportSites, py::const_),
+           py::arg("firstSite"), py::arg("out").noconvert(), py::arg("options") = asmc::GenotypeExportOptions(),
+           py::arg("numThreads") = 1ul)
+      .def("exportSites",
+           py::overload_cast<unsigned long, Eigen::Ref<asmc::mat_dbl_t>, const asmc::GenotypeExportOptions&,
+                             unsigned long>(&asmc::BedMatrixType::exportSites, py::const_),
+           py::arg("firstSite"), py::arg("out").noconvert(), py::arg("options") = asmc::GenotypeExportOptions(),
+           py::arg("numThreads") = 1ul)
       .def("getSite", &asmc::BedMatrixType::getSite)
-      .def("getIndividual", &asmc::BedMatrixType::getIndividual)
+      .def("getIndividual", py::overload_cast<unsigned long>(&asmc::BedMatrixType::getIndividual, py::const_))
+      .def("getIndividual",
+           py::overload_cast<unsigned long, Eigen::Ref<asmc::rvec_uint8_t>>(&asmc::BedMatrixType::getIndividual,
+                                                                              py::const_),
+           py::arg("individualId"), py::arg("out").noconvert())
+      .def("cacheIndividualMajor", &asmc::BedMatrixType::cacheIndividualMajor, py::arg("numThreads") = 1ul)
+      .def("hasIndividualMajorCache", &asmc::BedMatrixType::hasIndividualMajorCache)
       .def("getMissingCount", &asmc::BedMatrixType::getMissingCount)
       .def("getMissingCounts", &asmc::BedMatrixType::getMissingCounts)
+      .def("getHeterozygousCount", &asmc::BedMatrixType::getHeterozygousCount)
+      .def("getHeterozygousCounts", &asmc::BedMatrixType::getHeterozygousCounts)
+      .def("hasSiteStatistics", &asmc::BedMatrixType::hasSiteStatistics)
       .def("getMissingFrequency", &asmc::BedMatrixType::getMissingFrequency)
       .def("getMissingFrequencies", &asmc::BedMatrixType::getMissingFrequencies)
       .def("getMinorAlleleCount", &asmc::BedMatrixType::getMinorAlleleCount)
@@ -57,6 +118,72 @@ PYBIND11_MODULE(asmc_data_module, m) {
       .def("getDerivedAlleleFrequency", &asmc::BedMatrixType::getDerivedAlleleFrequency)
       .def("getMinorAlleleFrequencies", &asmc::BedMatrixType::getMinorAlleleFrequencies)
       .def("getDerivedAlleleFrequencies", &asmc::BedMatrixType::getDerivedAlleleFrequencies)
-      .def("writeFrequencies", &asmc::BedMatrixType::writeFrequencies);
+      .def("writeFrequencies", &asmc::BedMatrixType::writeFrequencies, py::arg("frqFile"), py::arg("numThreads") = 1ul)
+      .def("writeBedBimFam", &asmc::BedMatrixType::writeBedBimFam, py::arg("bedFile"), py::arg("bimFile"),
+           py::arg("famFile"), py::arg("numThreads") = 1ul);
 
-}
\ No newline at end of file
+  py::class_<asmc::GeneticRelationshipMatrix>(m, "GeneticRelationshipMatrix")
+      .def_static("createFromBedMatrix", &asmc::GeneticRelationshipMatrix::createFromBedMatrix, py::arg("bedMatrix"),
+                  py::arg("blockSize") = asmc::GeneticRelationshipMatrix::defaultBlockSize, py::arg("numThreads") = 1ul)
+      .def("getNumIndividuals", &asmc::GeneticRelationshipMatrix::getNumIndividuals)
+      .def("getNumSites", &asmc::GeneticRelationshipMatrix::getNumSites)
+      .def("getMatrix", &asmc::GeneticRelationshipMatrix::getMatrix)
+      .def("writeBinary", &asmc::GeneticRelationshipMatrix::writeBinary);
+
+  py::enum_<asmc::LdWindowUnit>(m, "LdWindowUnit")
+      .value("Sites", asmc::LdWindowUnit::Sites)
+      .value("BasePairs", asmc::LdWindowUnit::BasePairs)
+      .value("Centimorgans", asmc::LdWindowUnit::Centimorgans);
+  py::class_<asmc::LdOptions>(m, "LdOptions")
+      .def(py::init<>())
+      .def_readwrite("windowUnit", &asmc::LdOptions::windowUnit)
+      .def_readwrite("windowSize", &asmc::LdOptions::windowSize)
+      .def_readwrite("minR2", &asmc::LdOptions::minR2)
+      .def_readwrite("numThreads", &asmc::LdOptions::numThreads);
+  py::class_<asmc::LdMatrix>(m, "LdMatrix")
+      .def_static("createFromBedMatrix", &asmc::LdMatrix::createFromBedMatrix, py::arg("bedMatrix"),
+                  py::arg("options") = asmc::LdOptions())
+      .def_static("createFromHapsMatrix", &asmc::LdMatrix::createFromHapsMatrix, py::arg("hapsMatrix"),
+                  py::arg("options") = asmc::LdOptions())
+      .def("getNumSites", &asmc::LdMatrix::getNumSites)
+      .def("getNumPairs", &asmc::LdMatrix::getNumPairs)
+      .def("getRowOffsets", &asmc::LdMatrix::getRowOffsets)
+      .def("getColumnIds", &asmc::LdMatrix::getColumnIds)
+      .def("getR2Values", &asmc::LdMatrix::getR2Values)
+      .def("getDPrimeValues", &asmc::LdMatrix::getDPrimeValues)
+      .def("hasPair", &asmc::LdMatrix::hasPair)
+      .def("getR2", &asmc::LdMatrix::getR2)
+      .def("getDPrime", &asmc::LdMatrix::getDPrime);
+
+  py::class_<asmc::BedBlockReader>(m, "BedBlockReader")
+      .def(py::init<std::string_view, std::string_view, std::string_view, unsigned long, bool>(), py::arg("bedFile"),
+           py::arg("bimFile"), py::arg("famFile"), py::arg("blockSize"), py::arg("prefetch") = true)
+      .def("nextBlock", &asmc::BedBlockReader::nextBlock)
+      .def("reset", &asmc::BedBlockReader::reset)
+      .def("getBlock", &asmc::BedBlockReader::getBlock, py::return_value_policy::reference_internal)
+      .def("getBlockStart", &asmc::BedBlockReader::getBlockStart)
+      .def("getBlockSize", &asmc::BedBlockReader::getBlockSize)
+      .def("getMaxBlockSize", &asmc::BedBlockReader::getMaxBlockSize)
+      .def("getNumSites", &asmc::BedBlockReader::getNumSites)
+      .def("getNumIndividuals", &asmc::BedBlockReader::getNumIndividuals)
+      .def("getBlockSiteNames",
+           [](const asmc::BedBlockReader& reader) { return reader.getBlockBim().getSnpIds().toVector(); })
+      .def("getBlockPhysicalPositions",
+           [](const asmc::BedBlockReader& reader) { return reader.getBlockBim().getPhysicalPositions(); });
+
+  py::class_<asmc::HapsBlockReader>(m, "HapsBlockReader")
+      .def(py::init<std::string_view, std::string_view, std::string_view, unsigned long>(), py::arg("hapsFile"),
+           py::arg("samplesFile"), py::arg("mapFile"), py::arg("blockSize"))
+      .def("nextBlock", &asmc::HapsBlockReader::nextBlock)
+      .def("reset", &asmc::HapsBlockReader::reset)
+      .def("getBlockData", &asmc::HapsBlockReader::getBlockData)
+      .def("getAlleleCount", &asmc::HapsBlockReader::getAlleleCount)
+      .def("getBlockGeneticPositions", &asmc::HapsBlockReader::getBlockGeneticPositions)
+      .def("getBlockPhysicalPositions", &asmc::HapsBlockReader::getBlockPhysicalPositions)
+      .def("getBlockStart", &asmc::HapsBlockReader::getBlockStart)
+      .def("getBlockSize", &asmc::HapsBlockReader::getBlockSize)
+      .def("getMaxBlockSize", &asmc::HapsBlockReader::getMaxBlockSize)
+      .def("getNumSites", &asmc::HapsBlockReader::getNumSites)
+      .def("getNumIndividuals", &asmc::HapsBlockReader::getNumIndividuals)
+      .def("getNumHaps", &asmc::HapsBlockReader::getNumHaps);
+}
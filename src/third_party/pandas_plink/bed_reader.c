@@ -4,21 +4,153 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #define MIN(a, b) ((a > b) ? b : a)
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BED_READER_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+/* Decoded value of a 2-bit .bed code: 00 -> 0, 01 -> 3 (missing), 10 -> 1, 11 -> 2 */
+#define BED_GENO(code) ((code) == 0 ? 0 : (code) == 1 ? 3 : (code) == 2 ? 1 : 2)
+#define BED_LUT_ENTRY(b)                                                                                               \
+  { BED_GENO((b)&3), BED_GENO(((b) >> 2) & 3), BED_GENO(((b) >> 4) & 3), BED_GENO(((b) >> 6) & 3) }
+#define BED_LUT_4(b) BED_LUT_ENTRY(b), BED_LUT_ENTRY(b + 1), BED_LUT_ENTRY(b + 2), BED_LUT_ENTRY(b + 3)
+#define BED_LUT_16(b) BED_LUT_4(b), BED_LUT_4(b + 4), BED_LUT_4(b + 8), BED_LUT_4(b + 12)
+#define BED_LUT_64(b) BED_LUT_16(b), BED_LUT_16(b + 16), BED_LUT_16(b + 32), BED_LUT_16(b + 48)
+
+/* The four decoded genotypes packed in each possible byte, lowest genotype first */
+static const uint8_t bed_lut[256][4] = {BED_LUT_64(0), BED_LUT_64(64), BED_LUT_64(128), BED_LUT_64(192)};
+
+/*
+ * Decode nbytes whole bytes (4 * nbytes genotypes) through the lookup table. Inlined so that callers passing a
+ * constant stride get a specialised loop: with stride 1 each byte becomes a single 4-byte copy.
+ */
+static inline void decode_bytes_lut(const uint8_t* in, uint64_t nbytes, uint8_t* out, uint64_t stride) {
+  uint64_t i;
+  if (stride == 1) {
+    for (i = 0; i < nbytes; ++i) {
+      memcpy(out + 4 * i, bed_lut[in[i]], 4);
+    }
+  } else {
+    for (i = 0; i < nbytes; ++i) {
+      const uint8_t* g = bed_lut[in[i]];
+      out[(4 * i) * stride] = g[0];
+      out[(4 * i + 1) * stride] = g[1];
+      out[(4 * i + 2) * stride] = g[2];
+      out[(4 * i + 3) * stride] = g[3];
+    }
+  }
+}
+
+#ifdef BED_READER_X86_DISPATCH
+
+/* Decode 16 bytes at a time: split each byte into its four codes, map them with pshufb, and interleave */
+__attribute__((target("ssse3"))) static uint64_t decode_bytes_ssse3(const uint8_t* in, uint64_t nbytes,
+                                                                    uint8_t* out) {
+  const __m128i lut = _mm_setr_epi8(0, 3, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask = _mm_set1_epi8(3);
+  uint64_t i;
+  for (i = 0; i + 16 <= nbytes; i += 16) {
+    const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+    const __m128i a0 = _mm_shuffle_epi8(lut, _mm_and_si128(x, mask));
+    const __m128i a1 = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 2), mask));
+    const __m128i a2 = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+    const __m128i a3 = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 6), mask));
+    const __m128i t01lo = _mm_unpacklo_epi8(a0, a1);
+    const __m128i t01hi = _mm_unpackhi_epi8(a0, a1);
+    const __m128i t23lo = _mm_unpacklo_epi8(a2, a3);
+    const __m128i t23hi = _mm_unpackhi_epi8(a2, a3);
+    _mm_storeu_si128((__m128i*)(out + 4 * i), _mm_unpacklo_epi16(t01lo, t23lo));
+    _mm_storeu_si128((__m128i*)(out + 4 * i + 16), _mm_unpackhi_epi16(t01lo, t23lo));
+    _mm_storeu_si128((__m128i*)(out + 4 * i + 32), _mm_unpacklo_epi16(t01hi, t23hi));
+    _mm_storeu_si128((__m128i*)(out + 4 * i + 48), _mm_unpackhi_epi16(t01hi, t23hi));
+  }
+  return i;
+}
+
+/* As decode_bytes_ssse3 with 32 bytes at a time; the unpacks work within 128-bit lanes, so lanes are reordered */
+__attribute__((target("avx2"))) static uint64_t decode_bytes_avx2(const uint8_t* in, uint64_t nbytes, uint8_t* out) {
+  const __m256i lut = _mm256_setr_epi8(0, 3, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 1, 2, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0);
+  const __m256i mask = _mm256_set1_epi8(3);
+  uint64_t i;
+  for (i = 0; i + 32 <= nbytes; i += 32) {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+    const __m256i a0 = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+    const __m256i a1 = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 2), mask));
+    const __m256i a2 = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+    const __m256i a3 = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 6), mask));
+    const __m256i t01lo = _mm256_unpacklo_epi8(a0, a1);
+    const __m256i t01hi = _mm256_unpackhi_epi8(a0, a1);
+    const __m256i t23lo = _mm256_unpacklo_epi8(a2, a3);
+    const __m256i t23hi = _mm256_unpackhi_epi8(a2, a3);
+    const __m256i r0 = _mm256_unpacklo_epi16(t01lo, t23lo);
+    const __m256i r1 = _mm256_unpackhi_epi16(t01lo, t23lo);
+    const __m256i r2 = _mm256_unpacklo_epi16(t01hi, t23hi);
+    const __m256i r3 = _mm256_unpackhi_epi16(t01hi, t23hi);
+    _mm256_storeu_si256((__m256i*)(out + 4 * i), _mm256_permute2x128_si256(r0, r1, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 4 * i + 32), _mm256_permute2x128_si256(r2, r3, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 4 * i + 64), _mm256_permute2x128_si256(r0, r1, 0x31));
+    _mm256_storeu_si256((__m256i*)(out + 4 * i + 96), _mm256_permute2x128_si256(r2, r3, 0x31));
+  }
+  return i;
+}
+
+#endif
+
+/* Decode whole bytes into contiguous output, using the widest instruction set supported by the running CPU */
+static void decode_bytes_contiguous(const uint8_t* in, uint64_t nbytes, uint8_t* out) {
+  uint64_t done = 0;
+#ifdef BED_READER_X86_DISPATCH
+  if (__builtin_cpu_supports("avx2")) {
+    done = decode_bytes_avx2(in, nbytes, out);
+  } else if (__builtin_cpu_supports("ssse3")) {
+    done = decode_bytes_ssse3(in, nbytes, out);
+  }
+#endif
+  decode_bytes_lut(in + done, nbytes - done, out + 4 * done, 1);
+}
+
+void decode_bed_row(const uint8_t* row, uint64_t col_start, uint64_t col_end, uint8_t* out, uint64_t stride) {
+  uint64_t c = col_start;
+  uint64_t nbytes;
+
+  // Genotypes before the first byte boundary
+  for (; c % 4 != 0 && c < col_end; ++c) {
+    out[(c - col_start) * stride] = bed_lut[row[c / 4]][c % 4];
+  }
+
+  // Whole bytes
+  nbytes = (col_end - c) / 4;
+  if (stride == 1) {
+    decode_bytes_contiguous(row + c / 4, nbytes, out + (c - col_start));
+  } else {
+    decode_bytes_lut(row + c / 4, nbytes, out + (c - col_start) * stride, stride);
+  }
+  c += 4 * nbytes;
+
+  // Genotypes in a final partial byte
+  for (; c < col_end; ++c) {
+    out[(c - col_start) * stride] = bed_lut[row[c / 4]][c % 4];
+  }
+}
+
 int read_bed_chunk(char* filepath, uint64_t nrows, uint64_t ncols, uint64_t row_start, uint64_t col_start,
                    uint64_t row_end, uint64_t col_end, uint8_t* out, uint64_t* strides) {
-  char b, b0, b1, p0, p1;
   uint64_t r;
-  uint64_t c, ce;
   uint64_t row_chunk;
   uint64_t row_size;
   FILE* f;
-  char* buff;
+  uint8_t* buff;
+  uint8_t header[3];
+
+  (void)nrows;
 
   // in bytes
-  row_chunk = (col_end - col_start + 3) / 4;
+  row_chunk = (col_end + 3) / 4 - col_start / 4;
   // in bytes
   row_size = (ncols + 3) / 4;
 
@@ -28,7 +160,14 @@ int read_bed_chunk(char* filepath, uint64_t nrows, uint64_t ncols, uint64_t row_
     return -1;
   }
 
-  buff = malloc(row_chunk * sizeof(char));
+  // Only SNP-major files, with magic bytes 0x6c 0x1b 0x01, can be read row by row
+  if (fread(header, sizeof(header), 1, f) != 1 || header[0] != 0x6c || header[1] != 0x1b || header[2] != 0x01) {
+    fprintf(stderr, "Error reading %s: not a SNP-major .bed file.\n", filepath);
+    fclose(f);
+    return -1;
+  }
+
+  buff = malloc(row_chunk * sizeof(uint8_t));
   if (buff == NULL) {
     fprintf(stderr, "Not enough memory.\n");
     fclose(f);
@@ -55,22 +194,8 @@ int read_bed_chunk(char* filepath, uint64_t nrows, uint64_t ncols, uint64_t row_
       }
     }
 
-    for (c = col_start; c < col_end;) {
-      b = buff[(c - col_start) / 4];
-
-      b0 = b & 0x55;
-      b1 = (b & 0xAA) >> 1;
-
-      p0 = b0 ^ b1;
-      p1 = (b0 | b1) & b0;
-      p1 <<= 1;
-      p0 |= p1;
-      ce = MIN(c + 4, col_end);
-      for (; c < ce; ++c) {
-        out[(r - row_start) * strides[0] + (c - col_start) * strides[1]] = p0 & 3;
-        p0 >>= 2;
-      }
-    }
+    decode_bed_row(buff, col_start % 4, col_start % 4 + (col_end - col_start), out + (r - row_start) * strides[0],
+                   strides[1]);
     ++r;
   }
 
@@ -1,6 +1,14 @@
 #ifndef DATA_MODULE_3RD_PARTY_PANDAS_PLINK_DATA_READER_H
 #define DATA_MODULE_3RD_PARTY_PANDAS_PLINK_DATA_READER_H
 
+#include <stdint.h>
+
+/**
+ * Decode genotypes [col_start, col_end) from one SNP-major row of packed .bed data, where row points to the first
+ * byte of the row. Decoded values are 0, 1, 2, or 3 for missing, and are written to out[(c - col_start) * stride].
+ */
+void decode_bed_row(const uint8_t* row, uint64_t col_start, uint64_t col_end, uint8_t* out, uint64_t stride);
+
 int read_bed_chunk(char* filepath, uint64_t nrows, uint64_t ncols, uint64_t row_start, uint64_t col_start,
                    uint64_t row_end, uint64_t col_end, uint8_t* out, uint64_t* strides);
 
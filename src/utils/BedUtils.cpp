@@ -0,0 +1,187 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedUtils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <exception>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+namespace {
+
+/** Mask selecting the low bit of each 2-bit genotype code in a 64-bit word */
+constexpr uint64_t lowBitsMask = 0x5555555555555555ull;
+
+void accumulateBedWord(uint64_t word, BedSiteCounts& counts) {
+  const uint64_t lo = word & lowBitsMask;
+  const uint64_t hi = (word >> 1u) & lowBitsMask;
+  counts.numMissing += popcount64(lo & ~hi);
+  counts.numHeterozygous += popcount64(hi & ~lo);
+  counts.numHomozygousSecond += popcount64(lo & hi);
+}
+
+/** Map from a decoded genotype value to its 2-bit code in a .bed file, the inverse of bedCodeToGenotype */
+constexpr std::array<unsigned, 4> genotypeToBedCode = {0u, 2u, 3u, 1u};
+
+} // namespace
+
+bool hasHardwarePopcount() {
+#if defined(__POPCNT__)
+  return true;
+#elif defined(DATA_MODULE_POPCNT_DISPATCH)
+  static const bool supported = __builtin_cpu_supports("popcnt");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+BedSiteCounts countBedRow(const uint8_t* row, unsigned long numIndividuals) {
+  constexpr unsigned long genotypesPerWord = 4ul * sizeof(uint64_t);
+
+  return withHardwarePopcount([row, numIndividuals] {
+    BedSiteCounts counts;
+    const unsigned long numFullWords = numIndividuals / genotypesPerWord;
+    for (unsigned long i = 0ul; i < numFullWords; ++i) {
+      uint64_t word = 0ull;
+      std::memcpy(&word, row + i * sizeof(uint64_t), sizeof(uint64_t));
+      accumulateBedWord(word, counts);
+    }
+
+    // Code 00 is not counted, so zero-filling and masking the final partial word leaves the counts unchanged
+    if (const unsigned long remainder = numIndividuals % genotypesPerWord; remainder != 0ul) {
+      uint64_t word = 0ull;
+      std::memcpy(&word, row + numFullWords * sizeof(uint64_t), (remainder + 3ul) / 4ul);
+      accumulateBedWord(word & ((1ull << (2ul * remainder)) - 1ull), counts);
+    }
+
+    return counts;
+  });
+}
+
+void encodeBedRow(const uint8_t* genotypes, unsigned long numIndividuals, uint8_t* out) {
+  // Accumulate any bits above the two lowest, so that invalid values are detected without a branch per genotype
+  unsigned invalidBits = 0u;
+  auto code = [&invalidBits, genotypes](unsigned long i) {
+    invalidBits |= genotypes[i] & ~3u;
+    return genotypeToBedCode[genotypes[i] & 3u];
+  };
+
+  unsigned long i = 0ul;
+  for (; i + 4ul <= numIndividuals; i += 4ul) {
+    const unsigned byte = code(i) | (code(i + 1ul) << 2u) | (code(i + 2ul) << 4u) | (code(i + 3ul) << 6u);
+    out[i / 4ul] = static_cast<uint8_t>(byte);
+  }
+  if (i < numIndividuals) {
+    unsigned byte = 0u;
+    for (unsigned long j = i; j < numIndividuals; ++j) {
+      byte |= code(j) << (2ul * (j - i));
+    }
+    out[i / 4ul] = static_cast<uint8_t>(byte);
+  }
+
+  if (invalidBits != 0u) {
+    const auto* invalid = std::find_if(genotypes, genotypes + numIndividuals, [](uint8_t g) { return g > 3u; });
+    throw std::runtime_error(fmt::format("Genotype values must be 0, 1, 2, or 3 for missing data, but found {}",
+                                         static_cast<unsigned>(*invalid)));
+  }
+}
+
+void subsetBedRow(const uint8_t* row, const std::vector<unsigned long>& individualIds, uint8_t* out) {
+  const auto numIndividuals = static_cast<unsigned long>(individualIds.size());
+
+  // Assemble each output byte from four codes, so that every output byte is written exactly once
+  unsigned long i = 0ul;
+  for (; i + 4ul <= numIndividuals; i += 4ul) {
+    out[i / 4ul] = static_cast<uint8_t>(getBedCode(row, individualIds[i]) |
+                                        (getBedCode(row, individualIds[i + 1ul]) << 2u) |
+                                        (getBedCode(row, individualIds[i + 2ul]) << 4u) |
+                                        (getBedCode(row, individualIds[i + 3ul]) << 6u));
+  }
+  if (i < numIndividuals) {
+    unsigned byte = 0u;
+    for (unsigned long j = i; j < numIndividuals; ++j) {
+      byte |= getBedCode(row, individualIds[j]) << (2ul * (j - i));
+    }
+    out[i / 4ul] = static_cast<uint8_t>(byte);
+  }
+}
+
+BedLayout validateBedFile(const fs::path& bedFile, const uint8_t* header, std::size_t fileSize,
+                          unsigned long numSites, unsigned long numIndividuals) {
+  const bool isBed = fileSize >= bedMagicBytes.size() && header[0] == bedMagicBytes[0] && header[1] == bedMagicBytes[1];
+  if (!isBed || (header[2] != bedMagicBytes[2] && header[2] != bedIndividualMajorModeByte)) {
+    throw std::runtime_error(fmt::format("Expected .bed file {} to start with the magic bytes of a SNP-major or "
+                                         "individual-major .bed file",
+                                         bedFile.string()));
+  }
+
+  const BedLayout layout = header[2] == bedMagicBytes[2] ? BedLayout::SnpMajor : BedLayout::IndividualMajor;
+  const std::size_t expectedSize = layout == BedLayout::SnpMajor
+                                       ? bedMagicBytes.size() + numSites * ((numIndividuals + 3ul) / 4ul)
+                                       : bedMagicBytes.size() + numIndividuals * ((numSites + 3ul) / 4ul);
+  if (fileSize != expectedSize) {
+    throw std::runtime_error(fmt::format("Expected .bed file {} to contain {} bytes for {} sites and {} individuals, "
+                                         "but found {}",
+                                         bedFile.string(), expectedSize, numSites, numIndividuals, fileSize));
+  }
+  return layout;
+}
+
+void transposeBedTile(std::array<uint64_t, 32>& tile) {
+  // Masks selecting the first half of each group of 2 * width codes, for width 16, 8, 4, 2, 1
+  constexpr std::array<uint64_t, 5> masks = {0x00000000ffffffffull, 0x0000ffff0000ffffull, 0x00ff00ff00ff00ffull,
+                                             0x0f0f0f0f0f0f0f0full, 0x3333333333333333ull};
+
+  unsigned long width = 16ul;
+  for (const uint64_t mask : masks) {
+    // Swap the top-right and bottom-left sub-blocks of each 2 * width square on the diagonal
+    for (unsigned long i = 0ul; i < tile.size(); ++i) {
+      if ((i & width) == 0ul) {
+        const uint64_t swapped = ((tile[i] >> (2ul * width)) ^ tile[i + width]) & mask;
+        tile[i] ^= swapped << (2ul * width);
+        tile[i + width] ^= swapped;
+      }
+    }
+    width /= 2ul;
+  }
+}
+
+void transposeIndividualMajorBed(const uint8_t* genotypes, unsigned long bytesPerIndividual,
+                                 unsigned long numIndividuals, unsigned long firstSite, unsigned long numSites,
+                                 uint8_t* out, unsigned long outBytesPerSite) {
+  constexpr unsigned long tileSize = 32ul;
+  constexpr auto bytesPerWord = static_cast<unsigned long>(sizeof(uint64_t));
+  assert(firstSite % tileSize == 0ul);
+  assert(outBytesPerSite >= bytesPerWord * ((numIndividuals + tileSize - 1ul) / tileSize));
+
+  std::array<uint64_t, tileSize> tile = {};
+  for (unsigned long firstIndividual = 0ul; firstIndividual < numIndividuals; firstIndividual += tileSize) {
+    const unsigned long tileIndividuals = std::min(tileSize, numIndividuals - firstIndividual);
+
+    for (unsigned long siteInBlock = 0ul; siteInBlock < numSites; siteInBlock += tileSize) {
+      const unsigned long tileSites = std::min(tileSize, numSites - siteInBlock);
+      const unsigned long byteOffset = (firstSite + siteInBlock) / 4ul;
+      const unsigned long bytesToCopy = std::min(bytesPerWord, bytesPerIndividual - byteOffset);
+
+      // Genotypes are packed little-endian, so code j of a 64-bit word is held in bits 2j and 2j+1
+      tile.fill(0ull);
+      for (unsigned long i = 0ul; i < tileIndividuals; ++i) {
+        std::memcpy(&tile[i], genotypes + (firstIndividual + i) * bytesPerIndividual + byteOffset, bytesToCopy);
+      }
+
+      transposeBedTile(tile);
+
+      for (unsigned long j = 0ul; j < tileSites; ++j) {
+        std::memcpy(out + (siteInBlock + j) * outBytesPerSite + firstIndividual / 4ul, &tile[j], bytesPerWord);
+      }
+    }
+  }
+}
+
+} // namespace asmc
@@ -0,0 +1,195 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_BED_UTILS_HPP
+#define DATA_MODULE_BED_UTILS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/** The three magic bytes at the start of a SNP-major .bed file */
+constexpr std::array<uint8_t, 3> bedMagicBytes = {0x6c, 0x1b, 0x01};
+
+/** The third magic byte of an individual-major .bed file, which replaces the final byte of bedMagicBytes */
+constexpr uint8_t bedIndividualMajorModeByte = 0x00;
+
+/**
+ * The order in which genotypes are stored in a .bed file, given by its third magic byte.
+ */
+enum class BedLayout {
+  /** One row per site, holding the genotypes of every individual (mode byte 0x01) */
+  SnpMajor,
+  /** One row per individual, holding the genotypes at every site (mode byte 0x00), as written by old PLINK versions */
+  IndividualMajor,
+};
+
+/** Map from the 2-bit code in a .bed file to the decoded genotype value, with 3 representing missing data */
+constexpr std::array<uint8_t, 4> bedCodeToGenotype = {0, 3, 1, 2};
+
+/**
+ * Get the 2-bit code of a single genotype from a row of packed bytes in SNP-major .bed layout.
+ *
+ * @param row pointer to the packed bytes of a site
+ * @param individualId the individual ID
+ * @return the 2-bit code, from 0 to 3
+ */
+inline unsigned getBedCode(const uint8_t* row, unsigned long individualId) {
+  return static_cast<unsigned>(row[individualId / 4ul] >> (2ul * (individualId % 4ul))) & 3u;
+}
+
+/**
+ * Counts of each non-reference genotype class at a single site. Individuals homozygous for the first allele are the
+ * remainder, and are not counted explicitly.
+ */
+struct BedSiteCounts {
+  /** The number of missing genotypes, code 01 */
+  unsigned long numMissing = 0ul;
+
+  /** The number of heterozygous genotypes, code 10 */
+  unsigned long numHeterozygous = 0ul;
+
+  /** The number of genotypes homozygous for the second allele, code 11 */
+  unsigned long numHomozygousSecond = 0ul;
+
+  /**
+   * @return the number of copies of the second allele among non-missing genotypes
+   */
+  [[nodiscard]] unsigned long getAlleleCount() const {
+    return numHeterozygous + 2ul * numHomozygousSecond;
+  }
+};
+
+/**
+ * Count the set bits in a 64-bit word.
+ *
+ * @param word the word
+ * @return the number of set bits
+ */
+inline unsigned long popcount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned long>(__builtin_popcountll(word));
+#else
+  word = word - ((word >> 1u) & 0x5555555555555555ull);
+  word = (word & 0x3333333333333333ull) + ((word >> 2u) & 0x3333333333333333ull);
+  word = (word + (word >> 4u)) & 0x0f0f0f0f0f0f0f0full;
+  return static_cast<unsigned long>((word * 0x0101010101010101ull) >> 56u);
+#endif
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__POPCNT__)
+#define DATA_MODULE_POPCNT_DISPATCH
+#endif
+
+/**
+ * @return whether the running CPU has the popcnt instruction, which is checked once
+ */
+bool hasHardwarePopcount();
+
+#ifdef DATA_MODULE_POPCNT_DISPATCH
+/**
+ * Call fn with everything it calls inlined and compiled for the popcnt instruction, so that each popcount64 in it is a
+ * single instruction rather than a call into libgcc. Only call this if hasHardwarePopcount() is true.
+ */
+template <typename Fn> __attribute__((target("popcnt"), flatten)) decltype(auto) callWithPopcnt(Fn& fn) {
+  return fn();
+}
+#endif
+
+/**
+ * Call a bit-counting kernel, using the hardware popcnt instruction if the running CPU has one and the build does not
+ * already assume it. Without -mpopcnt, GCC compiles popcount64 to a call for each word, so kernels that count bits in
+ * a loop should be wrapped in this, as the .bed decoder dispatches to SSSE3 and AVX2.
+ *
+ * @param fn the kernel, taking no arguments
+ * @return the result of the kernel
+ */
+template <typename Fn> decltype(auto) withHardwarePopcount(Fn&& fn) {
+#ifdef DATA_MODULE_POPCNT_DISPATCH
+  if (hasHardwarePopcount()) {
+    return callWithPopcnt(fn);
+  }
+#endif
+  return fn();
+}
+
+/**
+ * Count the missing, heterozygous and homozygous-second-allele genotypes in a row of packed bytes in SNP-major .bed
+ * layout, without decoding it. The row is processed 32 genotypes at a time by splitting each 64-bit word into its low
+ * and high bits and counting each 2-bit code with a single popcount. Bits beyond the last individual are ignored.
+ *
+ * @param row pointer to (numIndividuals + 3) / 4 packed bytes
+ * @param numIndividuals the number of genotypes in the row
+ * @return the genotype counts
+ */
+BedSiteCounts countBedRow(const uint8_t* row, unsigned long numIndividuals);
+
+/**
+ * Pack decoded genotypes into a row of bytes in SNP-major .bed layout. This is the inverse of decoding: values 0, 1 and
+ * 2 count copies of the second allele, and 3 is missing data. Bits beyond the last genotype are cleared. A
+ * std::runtime_error will be thrown if any value is greater than 3.
+ *
+ * @param genotypes pointer to numIndividuals decoded genotypes
+ * @param numIndividuals the number of genotypes to pack
+ * @param out pointer to (numIndividuals + 3) / 4 bytes to receive the packed row
+ */
+void encodeBedRow(const uint8_t* genotypes, unsigned long numIndividuals, uint8_t* out);
+
+/**
+ * Copy a subset of the genotypes in a row of packed bytes in SNP-major .bed layout into a new packed row, in the given
+ * order. Any bits beyond the last genotype copied are cleared.
+ *
+ * @param row pointer to the packed bytes of a site
+ * @param individualIds the indices in row of the genotypes to copy
+ * @param out pointer to at least (individualIds.size() + 3) / 4 bytes to receive the packed subset
+ */
+void subsetBedRow(const uint8_t* row, const std::vector<unsigned long>& individualIds, uint8_t* out);
+
+/**
+ * Check that a .bed file starts with the PLINK magic bytes and that its size matches the number of sites and
+ * individuals in the .bim and .fam files. A std::runtime_error will be thrown if it does not.
+ *
+ * @param bedFile path to the .bed file, used in error messages
+ * @param header the first three bytes of the .bed file
+ * @param fileSize the size of the .bed file in bytes
+ * @param numSites the number of sites in the .bim file
+ * @param numIndividuals the number of individuals in the .fam file
+ * @return the layout given by the third magic byte
+ */
+BedLayout validateBedFile(const fs::path& bedFile, const uint8_t* header, std::size_t fileSize,
+                          unsigned long numSites, unsigned long numIndividuals);
+
+/**
+ * Transpose a 32 x 32 tile of 2-bit genotype codes in place. On entry, code j of word i is held in bits 2j and 2j+1;
+ * on exit, that code is held in bits 2i and 2i+1 of word j. The transpose takes five rounds of masked swaps between
+ * words, halving the size of the swapped sub-blocks each round.
+ *
+ * @param tile the 32 words of the tile
+ */
+void transposeBedTile(std::array<uint64_t, 32>& tile);
+
+/**
+ * Convert a block of sites from an individual-major .bed file into SNP-major rows. The block is transposed in tiles of
+ * 32 individuals by 32 sites, so that each tile is held in registers and each individual's row is read sequentially.
+ *
+ * @param genotypes pointer to the first individual's row, just after the magic bytes
+ * @param bytesPerIndividual the number of bytes in each individual's row, (#sites + 3) / 4
+ * @param numIndividuals the number of individuals in the file
+ * @param firstSite the first site in the block, which must be a multiple of 32
+ * @param numSites the number of sites in the block
+ * @param out pointer to numSites rows of outBytesPerSite bytes, to receive the SNP-major rows
+ * @param outBytesPerSite the stride between output rows, which must be at least 8 * ((numIndividuals + 31) / 32)
+ */
+void transposeIndividualMajorBed(const uint8_t* genotypes, unsigned long bytesPerIndividual,
+                                 unsigned long numIndividuals, unsigned long firstSite, unsigned long numSites,
+                                 uint8_t* out, unsigned long outBytesPerSite);
+
+} // namespace asmc
+
+#endif // DATA_MODULE_BED_UTILS_HPP
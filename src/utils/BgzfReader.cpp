@@ -0,0 +1,192 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BgzfReader.hpp"
+
+#include "ThreadUtils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <utility>
+
+#include <fmt/core.h>
+#include <zlib.h>
+
+namespace asmc {
+
+namespace {
+
+/** The size of the fixed part of a gzip header, up to and including XLEN */
+constexpr std::size_t gzipHeaderSize = 12ul;
+
+/** The size of a gzip trailer: the CRC32 and the decompressed size */
+constexpr std::size_t gzipTrailerSize = 8ul;
+
+uint32_t readLittleEndian32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8u |
+         static_cast<uint32_t>(data[2]) << 16u | static_cast<uint32_t>(data[3]) << 24u;
+}
+
+std::size_t readLittleEndian16(const uint8_t* data) {
+  return static_cast<std::size_t>(data[0]) | static_cast<std::size_t>(data[1]) << 8u;
+}
+
+/**
+ * Parse the header of a BGZF block.
+ *
+ * @param data pointer to the start of the block
+ * @param available the number of bytes from data to the end of the file
+ * @param headerSize set to the size of the header, which is followed by the compressed data
+ * @return the total size of the block including its header and trailer, or 0 if data does not start with a complete
+ * BGZF header
+ */
+std::size_t parseBgzfHeader(const uint8_t* data, std::size_t available, std::size_t& headerSize) {
+  // The gzip magic bytes, the deflate method, and the FEXTRA flag
+  if (available < gzipHeaderSize || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8u || (data[3] & 4u) == 0u) {
+    return 0ul;
+  }
+  headerSize = gzipHeaderSize + readLittleEndian16(data + 10);
+  if (headerSize > available) {
+    return 0ul;
+  }
+
+  // The extra field holds subfields, one of which is "BC" with a 2-byte payload: the block size minus one
+  std::size_t blockSize = 0ul;
+  for (std::size_t pos = gzipHeaderSize; pos + 4ul <= headerSize;) {
+    const std::size_t subfieldSize = readLittleEndian16(data + pos + 2);
+    if (data[pos] == 'B' && data[pos + 1ul] == 'C' && subfieldSize == 2ul && pos + 6ul <= headerSize) {
+      blockSize = readLittleEndian16(data + pos + 4) + 1ul;
+    }
+    pos += 4ul + subfieldSize;
+  }
+  return blockSize >= headerSize + gzipTrailerSize ? blockSize : 0ul;
+}
+
+} // namespace
+
+bool isBgzfFile(const fs::path& filePath) {
+  std::ifstream file(filePath, std::ios::binary);
+  std::vector<uint8_t> header(gzipHeaderSize);
+  file.read(reinterpret_cast<char*>(header.data()), static_cast<std::streamsize>(header.size()));
+  if (file.gcount() != static_cast<std::streamsize>(gzipHeaderSize)) {
+    return false;
+  }
+
+  // Read the extra field, if there is one, which is where the block size is recorded
+  if ((header[3] & 4u) != 0u) {
+    header.resize(gzipHeaderSize + readLittleEndian16(header.data() + 10));
+    file.read(reinterpret_cast<char*>(header.data() + gzipHeaderSize),
+              static_cast<std::streamsize>(header.size() - gzipHeaderSize));
+  }
+  std::size_t headerSize = 0ul;
+  return parseBgzfHeader(header.data(), gzipHeaderSize + static_cast<std::size_t>(file.gcount()), headerSize) > 0ul;
+}
+
+BgzfReader::BgzfReader(const fs::path& filePath, unsigned long numThreads)
+    : mFilePath{filePath}, mFile{filePath}, mNumThreads{numThreads} {
+
+  const uint8_t* data = mFile.data();
+  const std::size_t fileSize = mFile.size();
+  mBlocks.reserve(fileSize / (1ul << 14) + 1ul);
+
+  for (std::size_t offset = 0ul; offset < fileSize;) {
+    std::size_t headerSize = 0ul;
+    const std::size_t blockSize = parseBgzfHeader(data + offset, fileSize - offset, headerSize);
+    if (blockSize == 0ul || blockSize > fileSize - offset) {
+      throw std::runtime_error(fmt::format("Expected {} to be a BGZF file, but found an invalid block at byte {}",
+                                           mFilePath.string(), offset));
+    }
+    const uint8_t* trailer = data + offset + blockSize - gzipTrailerSize;
+    const Block block = {offset + headerSize, blockSize - headerSize - gzipTrailerSize, mDecompressedSize,
+                         readLittleEndian32(trailer + 4), readLittleEndian32(trailer)};
+    mBlocks.push_back(block);
+    mDecompressedSize += block.size;
+    offset += blockSize;
+  }
+}
+
+std::size_t BgzfReader::getNumBlocks() const {
+  return mBlocks.size();
+}
+
+std::size_t BgzfReader::getDecompressedSize() const {
+  return mDecompressedSize;
+}
+
+void BgzfReader::inflateBlocks(std::size_t firstBlock, std::size_t lastBlock, char* out) const {
+  if (firstBlock >= lastBlock) {
+    return;
+  }
+  const std::size_t outStart = mBlocks[firstBlock].decompressedOffset;
+
+  const auto begin = static_cast<unsigned long>(firstBlock);
+  const auto end = static_cast<unsigned long>(lastBlock);
+  parallelFor(begin, end, mNumThreads, [&](unsigned long first, unsigned long last) {
+    // Each thread reuses one raw inflate stream for all of its blocks
+    z_stream stream{};
+    if (inflateInit2(&stream, -15) != Z_OK) {
+      throw std::runtime_error("Could not initialise zlib for decompression");
+    }
+    for (unsigned long blockId = first; blockId < last; ++blockId) {
+      const Block& block = mBlocks[blockId];
+      auto* blockOut = reinterpret_cast<Bytef*>(out + (block.decompressedOffset - outStart));
+      inflateReset(&stream);
+      stream.next_in = const_cast<Bytef*>(mFile.data() + block.dataOffset);
+      stream.avail_in = static_cast<uInt>(block.compressedSize);
+      // zlib rejects a null output pointer even when there is nothing to write, as for the end-of-file block
+      Bytef emptyOut = 0u;
+      stream.next_out = block.size == 0ul ? &emptyOut : blockOut;
+      stream.avail_out = static_cast<uInt>(block.size);
+
+      const int status = inflate(&stream, Z_FINISH);
+      const bool valid = status == Z_STREAM_END && stream.total_out == block.size &&
+                         crc32(0ul, blockOut, static_cast<uInt>(block.size)) == block.crc;
+      if (!valid) {
+        inflateEnd(&stream);
+        throw std::runtime_error(fmt::format("Could not decompress {}: the BGZF block at byte {} is corrupt",
+                                             mFilePath.string(), block.dataOffset));
+      }
+    }
+    inflateEnd(&stream);
+  });
+}
+
+void BgzfReader::startNextBatch() {
+  const std::size_t firstBlock = mNextBlock;
+  std::size_t numBytes = 0ul;
+  while (mNextBlock < mBlocks.size() && numBytes < batchSize) {
+    numBytes += mBlocks[mNextBlock++].size;
+  }
+  if (firstBlock == mNextBlock) {
+    return;
+  }
+  mPendingBatch.resize(numBytes);
+  mPending = std::async(std::launch::async, [this, firstBlock, lastBlock = mNextBlock] {
+    inflateBlocks(firstBlock, lastBlock, mPendingBatch.data());
+  });
+}
+
+std::size_t BgzfReader::read(char* out, std::size_t numBytes) {
+  // The first batch is only started on the first read, so the reader can be used for inflateBlocks alone
+  if (mNextBlock == 0ul) {
+    startNextBatch();
+  }
+  while (mBatchPos == mBatch.size()) {
+    if (!mPending.valid()) {
+      return 0ul;
+    }
+    mPending.get();
+    std::swap(mBatch, mPendingBatch);
+    mBatchPos = 0ul;
+    startNextBatch();
+  }
+
+  const std::size_t numRead = std::min(numBytes, mBatch.size() - mBatchPos);
+  std::memcpy(out, mBatch.data() + mBatchPos, numRead);
+  mBatchPos += numRead;
+  return numRead;
+}
+
+} // namespace asmc
@@ -0,0 +1,132 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_BGZF_READER_HPP
+#define DATA_MODULE_BGZF_READER_HPP
+
+#include "MemoryMappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * Check whether a file is in the BGZF format written by bgzip: a series of gzip members of at most 64KiB, each of
+ * which records its own compressed size in a "BC" extra field. BGZF files are valid gzip files, but their members can
+ * be located without decompressing anything, and so can be inflated independently.
+ *
+ * @param filePath path to the file
+ * @return whether the file starts with a BGZF block
+ */
+bool isBgzfFile(const fs::path& filePath);
+
+/**
+ * Decompresses a BGZF file by inflating its blocks in parallel. The whole file is mapped into memory and its block
+ * boundaries are found up front. Blocks are then inflated in batches of consecutive blocks, shared between threads,
+ * and the next batch is inflated in the background while the current one is read. Each block's CRC and size are
+ * checked.
+ *
+ * Instances are neither copyable nor movable.
+ */
+class BgzfReader {
+
+private:
+  /** The location of one block's compressed data, and what it decompresses to */
+  struct Block {
+    std::size_t dataOffset;
+    std::size_t compressedSize;
+    std::size_t decompressedOffset;
+    std::size_t size;
+    uint32_t crc;
+  };
+
+  /** Path to the file, used in error messages */
+  fs::path mFilePath;
+
+  /** The compressed file */
+  MemoryMappedFile mFile;
+
+  /** Every block in the file, in order */
+  std::vector<Block> mBlocks;
+
+  /** The total decompressed size of the file, in bytes */
+  std::size_t mDecompressedSize = 0ul;
+
+  /** The number of threads to inflate blocks with */
+  unsigned long mNumThreads = 1ul;
+
+  /** The decompressed batch being read, of which mBatch[mBatchPos, mBatch.size()) has not been returned */
+  std::vector<char> mBatch;
+  std::size_t mBatchPos = 0ul;
+
+  /** The first block not yet in mBatch or the pending batch */
+  std::size_t mNextBlock = 0ul;
+
+  /**
+   * The batch being inflated in the background. These are declared last, so that the background work has finished
+   * before any other member is destroyed.
+   */
+  std::vector<char> mPendingBatch;
+  std::future<void> mPending;
+
+  /**
+   * Start inflating the next batch of blocks into mPendingBatch on a background thread, if any blocks remain.
+   */
+  void startNextBatch();
+
+public:
+  /** The decompressed size, in bytes, above which a batch of blocks is complete */
+  static constexpr std::size_t batchSize = 1ul << 24;
+
+  /**
+   * Open a BGZF file and find its blocks. A std::runtime_error will be thrown if the file cannot be opened, or if any
+   * part of it is not a BGZF block.
+   *
+   * @param filePath path to the file
+   * @param numThreads the number of threads to inflate blocks with, where 0 means one per hardware thread
+   */
+  explicit BgzfReader(const fs::path& filePath, unsigned long numThreads = 1ul);
+
+  BgzfReader(const BgzfReader&) = delete;
+  BgzfReader& operator=(const BgzfReader&) = delete;
+  ~BgzfReader() = default;
+
+  /**
+   * @return the number of blocks in the file
+   */
+  [[nodiscard]] std::size_t getNumBlocks() const;
+
+  /**
+   * @return the total decompressed size of the file, in bytes
+   */
+  [[nodiscard]] std::size_t getDecompressedSize() const;
+
+  /**
+   * Inflate a range of blocks into a buffer, sharing the blocks between threads. A std::runtime_error will be thrown if
+   * any block is corrupt.
+   *
+   * @param firstBlock the first block to inflate
+   * @param lastBlock one past the last block to inflate
+   * @param out the buffer to receive the decompressed blocks one after another, which must be large enough
+   */
+  void inflateBlocks(std::size_t firstBlock, std::size_t lastBlock, char* out) const;
+
+  /**
+   * Read the next part of the decompressed file. A std::runtime_error will be thrown if a block is corrupt.
+   *
+   * @param out the buffer to receive the decompressed bytes
+   * @param numBytes the maximum number of bytes to read
+   * @return the number of bytes read, which is 0 only at the end of the file
+   */
+  std::size_t read(char* out, std::size_t numBytes);
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_BGZF_READER_HPP
@@ -0,0 +1,53 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BufferedFileWriter.hpp"
+
+#include <exception>
+
+namespace asmc {
+
+BufferedFileWriter::BufferedFileWriter(std::string_view filePath) : mFilePath{filePath} {
+  mFile = std::fopen(mFilePath.string().c_str(), "wb");
+  if (mFile == nullptr) {
+    throw std::runtime_error(fmt::format("Could not open {} for writing", mFilePath.string()));
+  }
+}
+
+BufferedFileWriter::~BufferedFileWriter() {
+  if (mFile != nullptr) {
+    std::fclose(mFile);
+  }
+}
+
+fmt::memory_buffer& BufferedFileWriter::buffer() {
+  return mBuffer;
+}
+
+void BufferedFileWriter::flushIfFull() {
+  if (mBuffer.size() > flushThreshold) {
+    write(nullptr, 0ul);
+  }
+}
+
+void BufferedFileWriter::write(const void* data, std::size_t numBytes) {
+  if (mFile == nullptr) {
+    throw std::runtime_error(fmt::format("Cannot write to {} after it has been closed", mFilePath.string()));
+  }
+  if ((mBuffer.size() > 0ul && std::fwrite(mBuffer.data(), 1ul, mBuffer.size(), mFile) != mBuffer.size()) ||
+      (numBytes > 0ul && std::fwrite(data, 1ul, numBytes, mFile) != numBytes)) {
+    throw std::runtime_error(fmt::format("Error writing to {}", mFilePath.string()));
+  }
+  mBuffer.clear();
+}
+
+void BufferedFileWriter::close() {
+  write(nullptr, 0ul);
+  const int result = std::fclose(mFile);
+  mFile = nullptr;
+  if (result != 0) {
+    throw std::runtime_error(fmt::format("Error writing to {}", mFilePath.string()));
+  }
+}
+
+} // namespace asmc
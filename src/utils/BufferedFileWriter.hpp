@@ -0,0 +1,78 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_BUFFERED_FILE_WRITER_HPP
+#define DATA_MODULE_BUFFERED_FILE_WRITER_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+#include <fmt/format.h>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * A file opened for binary writing, with an in-memory buffer that is written to the file in large blocks. Text can be
+ * formatted directly into the buffer with fmt::format_to(std::back_inserter(writer.buffer()), ...).
+ *
+ * Instances are neither copyable nor movable. Call close() to write any buffered data and check for errors; the
+ * destructor closes the file without reporting errors.
+ */
+class BufferedFileWriter {
+
+private:
+  /** Path to the file, used in error messages */
+  fs::path mFilePath;
+
+  /** The open file, or nullptr once closed */
+  std::FILE* mFile = nullptr;
+
+  /** Data not yet written to the file */
+  fmt::memory_buffer mBuffer;
+
+public:
+  /** The buffer size above which flushIfFull() writes the buffer to the file */
+  static constexpr std::size_t flushThreshold = 1ul << 22;
+
+  /**
+   * Open a file for writing, replacing any existing file. A std::runtime_error will be thrown if it cannot be opened.
+   *
+   * @param filePath path to the file
+   */
+  explicit BufferedFileWriter(std::string_view filePath);
+
+  BufferedFileWriter(const BufferedFileWriter&) = delete;
+  BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+  ~BufferedFileWriter();
+
+  /**
+   * @return the buffer of data waiting to be written
+   */
+  fmt::memory_buffer& buffer();
+
+  /**
+   * Write the buffer to the file if it holds more than flushThreshold bytes.
+   */
+  void flushIfFull();
+
+  /**
+   * Write the buffer and then the given bytes to the file, without copying the bytes into the buffer.
+   *
+   * @param data pointer to the bytes to write
+   * @param numBytes the number of bytes to write
+   */
+  void write(const void* data, std::size_t numBytes);
+
+  /**
+   * Write any buffered data and close the file. A std::runtime_error will be thrown if any write failed.
+   */
+  void close();
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_BUFFERED_FILE_WRITER_HPP
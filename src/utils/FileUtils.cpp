@@ -2,11 +2,20 @@
 // See accompanying LICENSE and COPYING for copyright notice and full details.
 
 #include "FileUtils.hpp"
+#include "BgzfReader.hpp"
+#include "LineReader.hpp"
+#include "MemoryMappedFile.hpp"
 #include "StringUtils.hpp"
 
+#include <algorithm>
 #include <array>
+#include <exception>
+#include <fstream>
+#include <limits>
 #include <string>
+#include <system_error>
 
+#include <fmt/core.h>
 #include <zlib.h>
 
 namespace asmc {
@@ -29,19 +38,107 @@ std::string readNextLineFromGzip(gzFile& gzFileHandle) {
 }
 
 unsigned long countLinesInFile(const fs::path& filePath) {
-  auto gzFile = gzopen(filePath.string().c_str(), "r");
+  LineReader reader(filePath);
 
   unsigned long numLines = 0ul;
-  while (!gzeof(gzFile)) {
-    std::string line = readNextLineFromGzip(gzFile);
+  std::string_view line;
+  while (reader.nextLine(line)) {
     if (!line.empty()) {
       numLines++;
     }
   }
 
+  return numLines;
+}
+
+bool isGzipFile(const fs::path& filePath) {
+  std::array<unsigned char, 2> magic = {};
+  std::ifstream file(filePath, std::ios::binary);
+  file.read(reinterpret_cast<char*>(magic.data()), static_cast<std::streamsize>(magic.size()));
+  return file.gcount() == static_cast<std::streamsize>(magic.size()) && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+std::vector<char> readDecompressedFile(const fs::path& filePath, unsigned long numThreads) {
+  if (isBgzfFile(filePath)) {
+    const BgzfReader reader(filePath, numThreads);
+    std::vector<char> contents(reader.getDecompressedSize());
+    reader.inflateBlocks(0ul, reader.getNumBlocks(), contents.data());
+    return contents;
+  }
+
+  auto gzFile = gzopen(filePath.string().c_str(), "rb");
+  if (gzFile == Z_NULL) {
+    throw std::runtime_error(fmt::format("Could not open {} for reading", filePath.string()));
+  }
+  gzbuffer(gzFile, 1u << 20u);
+
+  // Start from the compressed size, and grow geometrically as the decompressed data fills the buffer
+  std::error_code ec;
+  const auto fileSize = fs::file_size(filePath, ec);
+  std::vector<char> contents(std::max<std::size_t>(ec ? 0ul : static_cast<std::size_t>(fileSize), 1ul << 16u));
+  std::size_t numRead = 0ul;
+  while (true) {
+    if (numRead == contents.size()) {
+      contents.resize(2ul * contents.size());
+    }
+    const auto request = static_cast<unsigned>(std::min<std::size_t>(contents.size() - numRead, 1ul << 30u));
+    const int bytes = gzread(gzFile, contents.data() + numRead, request);
+    if (bytes < 0) {
+      gzclose(gzFile);
+      throw std::runtime_error(fmt::format("Could not decompress {}", filePath.string()));
+    }
+    if (bytes == 0) {
+      break;
+    }
+    numRead += static_cast<std::size_t>(bytes);
+  }
+
   gzclose(gzFile);
+  contents.resize(numRead);
+  return contents;
+}
 
-  return numLines;
+void withFileContents(const fs::path& filePath, const std::function<void(std::string_view)>& fn,
+                      unsigned long numThreads) {
+  if (isGzipFile(filePath)) {
+    const std::vector<char> contents = readDecompressedFile(filePath, numThreads);
+    fn({contents.data(), contents.size()});
+  } else {
+    const MemoryMappedFile mapped(filePath);
+    fn({reinterpret_cast<const char*>(mapped.data()), mapped.size()});
+  }
+}
+
+void compressGzipMember(const void* data, std::size_t numBytes, std::vector<char>& out, int level) {
+  z_stream stream{};
+  // Adding 16 to the window bits asks zlib for a gzip header and trailer rather than a zlib wrapper
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Could not initialise zlib for compression");
+  }
+
+  out.resize(deflateBound(&stream, static_cast<uLong>(numBytes)));
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+
+  // zlib counts input in uInt, so feed very large blocks in pieces
+  const auto* next = static_cast<const Bytef*>(data);
+  std::size_t remaining = numBytes;
+  int status = Z_OK;
+  do {
+    const auto piece = static_cast<uInt>(std::min<std::size_t>(remaining, std::numeric_limits<uInt>::max()));
+    stream.next_in = const_cast<Bytef*>(next);
+    stream.avail_in = piece;
+    next += piece;
+    remaining -= piece;
+    status = deflate(&stream, remaining == 0ul ? Z_FINISH : Z_NO_FLUSH);
+  } while (remaining > 0ul && status == Z_OK);
+
+  const auto compressedSize = static_cast<std::size_t>(stream.total_out);
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END) {
+    throw std::runtime_error("Could not compress data with zlib");
+  }
+  out.resize(compressedSize);
 }
 
 } // namespace asmc
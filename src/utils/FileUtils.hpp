@@ -4,9 +4,12 @@
 #ifndef DATA_MODULE_FILE_UTILS_HPP
 #define DATA_MODULE_FILE_UTILS_HPP
 
+#include <cstddef>
 #include <filesystem>
+#include <functional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <zlib.h>
 
@@ -30,6 +33,49 @@ std::string readNextLineFromGzip(gzFile& gzFileHandle);
  */
 unsigned long countLinesInFile(const fs::path& filePath);
 
+/**
+ * Check whether a file starts with the gzip magic bytes.
+ *
+ * @param filePath path to the file
+ * @return whether the file is gzip compressed
+ */
+bool isGzipFile(const fs::path& filePath);
+
+/**
+ * Read the whole of a file that may or may not be gzipped into memory, decompressing it if necessary. The blocks of a
+ * BGZF file are inflated in parallel. A std::runtime_error will be thrown if the file cannot be opened or
+ * decompressed.
+ *
+ * @param filePath path to the file
+ * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+ * @return the contents of the file
+ */
+std::vector<char> readDecompressedFile(const fs::path& filePath, unsigned long numThreads = 1ul);
+
+/**
+ * Pass the whole text of a file that may or may not be gzipped to a function. An uncompressed file is mapped into
+ * memory rather than copied, and a gzipped file is decompressed into memory first.
+ *
+ * @param filePath path to the file
+ * @param fn the function to call with the text, which must not keep a reference to it after returning
+ * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+ */
+void withFileContents(const fs::path& filePath, const std::function<void(std::string_view)>& fn,
+                      unsigned long numThreads = 1ul);
+
+/**
+ * Compress a block of data into a complete gzip member, replacing the contents of out. A gzip file may hold several
+ * members one after another, so separate parts of a file can be compressed independently, for example on different
+ * threads, and written in order. A std::runtime_error will be thrown if zlib reports an error.
+ *
+ * @param data pointer to the bytes to compress
+ * @param numBytes the number of bytes to compress
+ * @param out the vector to receive the compressed gzip member
+ * @param level the zlib compression level, from 0 to 9
+ */
+void compressGzipMember(const void* data, std::size_t numBytes, std::vector<char>& out,
+                        int level = Z_DEFAULT_COMPRESSION);
+
 } // namespace asmc
 
 #endif // DATA_MODULE_FILE_UTILS_HPP
@@ -0,0 +1,177 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "HapsUtils.hpp"
+#include "LineReader.hpp"
+#include "StringUtils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <string>
+
+#include <fmt/core.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DATA_MODULE_HAPS_SSE2
+#endif
+
+namespace asmc {
+
+namespace {
+
+constexpr unsigned long hapsPerWord = 64ul;
+
+#ifdef DATA_MODULE_HAPS_SSE2
+/**
+ * Check and pack 8 alleles from 16 bytes of the form "a a a a a a a a ", where each a is '0' or '1'.
+ *
+ * @param chunk pointer to the 16 bytes
+ * @param bits set to the 8 alleles, with the first allele in the lowest bit
+ * @return whether the bytes have the expected form
+ */
+inline bool packSixteenBytes(const char* chunk, unsigned& bits) {
+  // XOR with "0 0 0 ..." leaves 0 or 1 in each allele byte and 0 in each separator byte of a well formed chunk
+  const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk));
+  const __m128i diff = _mm_xor_si128(bytes, _mm_set1_epi16(0x2030));
+
+  // Every bit must be clear except the lowest bit of each allele byte: 0xFFFE, read little-endian, is -2
+  const __m128i invalid = _mm_and_si128(diff, _mm_set1_epi16(-2));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xFFFF) {
+    return false;
+  }
+
+  // One mask bit per byte, of which only the even (allele) bits can be set, gathered into the low 8 bits
+  auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_set1_epi8(1))));
+  mask = (mask | (mask >> 1u)) & 0x3333u;
+  mask = (mask | (mask >> 2u)) & 0x0F0Fu;
+  bits = (mask | (mask >> 4u)) & 0x00FFu;
+  return true;
+}
+#endif
+
+} // namespace
+
+bool packHapsRow(std::string_view line, unsigned long numHaps, uint64_t* words) {
+  std::fill_n(words, (numHaps + hapsPerWord - 1ul) / hapsPerWord, 0ull);
+  if (numHaps == 0ul) {
+    return false;
+  }
+
+  // Skip the metadata fields, which may hold anything other than a space
+  std::size_t start = 0ul;
+  for (unsigned long field = 0ul; field < hapsMetadataFields; ++field) {
+    const std::size_t space = line.find(' ', start);
+    if (space == std::string_view::npos) {
+      return false;
+    }
+    start = space + 1ul;
+  }
+
+  // The alleles and the single spaces between them
+  const std::string_view alleles = line.substr(start);
+  if (alleles.size() != 2ul * numHaps - 1ul) {
+    return false;
+  }
+  const char* data = alleles.data();
+
+  unsigned long hapId = 0ul;
+#ifdef DATA_MODULE_HAPS_SSE2
+  // Each chunk ends with a separator, so the final allele is left to the scalar loop
+  for (; 2ul * (hapId + 8ul) <= alleles.size(); hapId += 8ul) {
+    unsigned bits = 0u;
+    if (!packSixteenBytes(data + 2ul * hapId, bits)) {
+      return false;
+    }
+    words[hapId / hapsPerWord] |= static_cast<uint64_t>(bits) << (hapId % hapsPerWord);
+  }
+#endif
+
+  for (; hapId < numHaps; ++hapId) {
+    const char allele = data[2ul * hapId];
+    if ((allele != '0' && allele != '1') || (hapId + 1ul < numHaps && data[2ul * hapId + 1ul] != ' ')) {
+      return false;
+    }
+    words[hapId / hapsPerWord] |= static_cast<uint64_t>(allele == '1') << (hapId % hapsPerWord);
+  }
+  return true;
+}
+
+void validateHapsRow(const std::vector<std::string_view>& row, unsigned long numIndividuals) {
+
+  // Check that the row contains the correct number of elements
+  const unsigned long expectedNumCols = 2ul * numIndividuals + hapsMetadataFields;
+  if (row.size() != expectedNumCols) {
+    throw std::runtime_error(fmt::format("Expected row to contain to contain 2x{}+5={} entries, but found {}",
+                                         numIndividuals, expectedNumCols, row.size()));
+  }
+
+  // Check that the 2N boolean values are either 0 or 1
+  for (unsigned long col = hapsMetadataFields; col < expectedNumCols; ++col) {
+    if (!(row[col] == "0" || row[col] == "1"))
+      throw std::runtime_error(
+          fmt::format("Expected row to contain to boolean data, but column {} was \"{}\"", 1ul + col, row[col]));
+  }
+}
+
+void parseHapsRow(std::string_view line, unsigned long numIndividuals, uint64_t* words) {
+  const unsigned long numHaps = 2ul * numIndividuals;
+  if (packHapsRow(line, numHaps, words)) {
+    return;
+  }
+
+  std::vector<std::string_view> row;
+  if (!line.empty()) {
+    splitIntoViews(line, ' ', row);
+  }
+  validateHapsRow(row, numIndividuals);
+
+  std::fill_n(words, (numHaps + hapsPerWord - 1ul) / hapsPerWord, 0ull);
+  for (unsigned long hapId = 0ul; hapId < numHaps; ++hapId) {
+    const uint64_t allele = row[hapsMetadataFields + hapId].front() == '1' ? 1ull : 0ull;
+    words[hapId / hapsPerWord] |= allele << (hapId % hapsPerWord);
+  }
+}
+
+bool parseHapsMapRow(std::string_view line, double& geneticPosition, unsigned long& physicalPosition) {
+  std::vector<std::string> fields = splitTextByDelimiter(line, "\t");
+  if (fields.empty()) {
+    return false;
+  }
+  assert(fields.size() == 4ul);
+  geneticPosition = std::stod(fields.at(2));
+  physicalPosition = std::stoul(fields.at(3));
+  return true;
+}
+
+unsigned long readHapsSamplesFile(const fs::path& samplesFile) {
+
+  LineReader reader(samplesFile);
+  std::string_view text;
+
+  // Process first two lines that contain header information
+  std::vector<std::string> line1 = splitTextByDelimiter(reader.nextLine(text) ? text : std::string_view(), " ");
+  if (line1.size() < 3 || line1.at(0) != "ID_1" || line1.at(1) != "ID_2" || line1.at(2) != "missing") {
+    throw std::runtime_error(
+        fmt::format("Expected fist row of .samples file {} to start \"ID_1 ID_2 missing\"", samplesFile.string()));
+  }
+
+  std::vector<std::string> line2 = splitTextByDelimiter(reader.nextLine(text) ? text : std::string_view(), " ");
+  if (line2.size() < 3 || line2.at(0) != "0" || line2.at(1) != "0" || line2.at(2) != "0") {
+    throw std::runtime_error(
+        fmt::format("Expected second row of .samples file {} to start \"0 0 0\"", samplesFile.string()));
+  }
+
+  // Read the individuals information
+  unsigned long numIndividuals = 0;
+  while (reader.nextLine(text)) {
+    if (!text.empty()) {
+      numIndividuals++;
+    }
+  }
+  return numIndividuals;
+}
+
+} // namespace asmc
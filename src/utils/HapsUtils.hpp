@@ -0,0 +1,78 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_HAPS_UTILS_HPP
+#define DATA_MODULE_HAPS_UTILS_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/** The number of metadata fields at the start of each row of a .haps file, before the alleles */
+constexpr unsigned long hapsMetadataFields = 5ul;
+
+/**
+ * Pack the alleles of one row of a .haps file into bits, one per haplotype and 64 per word, without splitting the row
+ * into fields. The five metadata fields are skipped, and the remainder of the row is checked and packed 8 alleles at a
+ * time with SSE2 compares where available, or one allele at a time otherwise.
+ *
+ * Only a well formed row is accepted: five metadata fields, then exactly numHaps alleles that are each "0" or "1", all
+ * separated by single spaces. A row that is not accepted may still be packed partially, and the caller should split
+ * it into fields to report what is wrong with it.
+ *
+ * @param line the row, without its newline or trailing whitespace
+ * @param numHaps the number of haplotypes
+ * @param words the (numHaps + 63) / 64 words to receive the alleles, with bit h % 64 of word h / 64 set if haplotype h
+ * carries allele 1. Padding bits are cleared
+ * @return whether the row is well formed
+ */
+bool packHapsRow(std::string_view line, unsigned long numHaps, uint64_t* words);
+
+/**
+ * Validate the fields of a row of a .hap[s][.gz] file. A std::runtime_error will be thrown unless:
+ *  1. it contains exactly 5 + 2N columns, where N is the number of individuals
+ *  2. it contains only boolean values in the haps columns
+ *
+ * @param row the fields of the row
+ * @param numIndividuals the number of individuals
+ */
+void validateHapsRow(const std::vector<std::string_view>& row, unsigned long numIndividuals);
+
+/**
+ * Validate a row of a .hap[s][.gz] file and pack its alleles into bits, as packHapsRow. A row that packHapsRow does not
+ * accept is split into fields and passed to validateHapsRow, which throws a std::runtime_error describing the problem.
+ *
+ * @param line the row, without its newline or trailing whitespace
+ * @param numIndividuals the number of individuals
+ * @param words the (2N + 63) / 64 words to receive the alleles
+ */
+void parseHapsRow(std::string_view line, unsigned long numIndividuals, uint64_t* words);
+
+/**
+ * Parse a row of the .map file that accompanies a .hap[s][.gz] file, which holds a chromosome, site ID, genetic
+ * position in centimorgans, and physical position, separated by tabs.
+ *
+ * @param line the row
+ * @param geneticPosition set to the genetic position
+ * @param physicalPosition set to the physical position
+ * @return whether the row holds a site, or false if it is empty
+ */
+bool parseHapsMapRow(std::string_view line, double& geneticPosition, unsigned long& physicalPosition);
+
+/**
+ * Read a .sample[s] file, checking its two header rows. A std::runtime_error will be thrown if either header row is
+ * not as expected.
+ *
+ * @param samplesFile path to the .sample[s] file
+ * @return the number of individuals: the number of non-empty rows after the header
+ */
+unsigned long readHapsSamplesFile(const fs::path& samplesFile);
+
+} // namespace asmc
+
+#endif // DATA_MODULE_HAPS_UTILS_HPP
@@ -0,0 +1,137 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "LineReader.hpp"
+#include "StringUtils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <limits>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+LineReader::LineReader(const fs::path& filePath, std::size_t bufferSize, unsigned long numThreads)
+    : mFilePath{filePath}, mBuffer(std::max<std::size_t>(bufferSize, 1ul)) {
+  if (isBgzfFile(mFilePath)) {
+    mBgzf = std::make_unique<BgzfReader>(mFilePath, numThreads);
+    return;
+  }
+  mFile = gzopen(mFilePath.string().c_str(), "rb");
+  if (mFile == Z_NULL) {
+    throw std::runtime_error(fmt::format("Could not open {} for reading", mFilePath.string()));
+  }
+  gzbuffer(mFile, 1u << 20u);
+}
+
+LineReader::~LineReader() {
+  if (mFile != Z_NULL) {
+    gzclose(mFile);
+  }
+}
+
+void LineReader::fill() {
+  if (mStart > 0ul) {
+    std::memmove(mBuffer.data(), mBuffer.data() + mStart, mEnd - mStart);
+    mEnd -= mStart;
+    mStart = 0ul;
+  }
+  if (mEnd == mBuffer.size()) {
+    mBuffer.resize(2ul * mBuffer.size());
+  }
+
+  if (mBgzf) {
+    const std::size_t bytes = mBgzf->read(mBuffer.data() + mEnd, mBuffer.size() - mEnd);
+    mEnd += bytes;
+    mEndOfFile = bytes == 0ul;
+    return;
+  }
+
+  const auto request =
+      static_cast<unsigned>(std::min<std::size_t>(mBuffer.size() - mEnd, std::numeric_limits<int>::max()));
+  const int bytes = gzread(mFile, mBuffer.data() + mEnd, request);
+  if (bytes < 0) {
+    throw std::runtime_error(fmt::format("Could not decompress {}", mFilePath.string()));
+  }
+  mEnd += static_cast<std::size_t>(bytes);
+  mEndOfFile = bytes == 0;
+}
+
+bool LineReader::nextLine(std::string_view& line) {
+  std::size_t searchFrom = mStart;
+  while (true) {
+    const auto* newline =
+        static_cast<const char*>(std::memchr(mBuffer.data() + searchFrom, '\n', mEnd - searchFrom));
+    if (newline != nullptr) {
+      const auto lineEnd = static_cast<std::size_t>(newline - mBuffer.data());
+      line = std::string_view(mBuffer.data() + mStart, lineEnd - mStart);
+      mStart = lineEnd + 1ul;
+      break;
+    }
+    if (mEndOfFile) {
+      if (mStart == mEnd) {
+        return false;
+      }
+      line = std::string_view(mBuffer.data() + mStart, mEnd - mStart);
+      mStart = mEnd;
+      break;
+    }
+    // The unread text moves to the front of the buffer, and there is no newline in what has been searched already
+    const std::size_t searched = mEnd - mStart;
+    fill();
+    searchFrom = mStart + searched;
+  }
+
+  while (!line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r')) {
+    line.remove_suffix(1ul);
+  }
+  ++mLineNumber;
+  return true;
+}
+
+bool LineReader::nextLines(std::string_view& lines) {
+  while (true) {
+    while (!mEndOfFile && mEnd - mStart < mBuffer.size()) {
+      fill();
+    }
+
+    const std::string_view unread(mBuffer.data() + mStart, mEnd - mStart);
+    const std::size_t lastNewline = unread.rfind('\n');
+    if (lastNewline == std::string_view::npos && !mEndOfFile) {
+      // A single line fills the buffer, which grows when it is full
+      fill();
+      continue;
+    }
+    if (unread.empty()) {
+      return false;
+    }
+
+    lines = unread.substr(0ul, mEndOfFile ? unread.size() : lastNewline + 1ul);
+    mStart += lines.size();
+    mLineNumber += static_cast<unsigned long>(countLines(lines));
+    return true;
+  }
+}
+
+bool LineReader::nextLines(std::vector<char>& storage, std::string_view& lines) {
+  if (!nextLines(lines)) {
+    return false;
+  }
+
+  // Swapping keeps the data pointer of each vector, so the view now points into storage
+  const std::size_t bufferSize = mBuffer.size();
+  storage.swap(mBuffer);
+  mBuffer.resize(bufferSize);
+  std::memcpy(mBuffer.data(), storage.data() + mStart, mEnd - mStart);
+  mEnd -= mStart;
+  mStart = 0ul;
+  return true;
+}
+
+unsigned long LineReader::getLineNumber() const {
+  return mLineNumber;
+}
+
+} // namespace asmc
@@ -0,0 +1,113 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_LINE_READER_HPP
+#define DATA_MODULE_LINE_READER_HPP
+
+#include "BgzfReader.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * Reads the lines of a file that may or may not be gzipped, one at a time, in a single streaming pass. The file is
+ * decompressed in large blocks into a buffer, and lines are returned as views into the buffer, so reading a line does
+ * not allocate. A line longer than the buffer grows it. BGZF files are decompressed by a BgzfReader, which inflates
+ * blocks in parallel, and any other file is decompressed sequentially by zlib.
+ *
+ * Instances are neither copyable nor movable.
+ */
+class LineReader {
+
+private:
+  /** Path to the file, used in error messages */
+  fs::path mFilePath;
+
+  /** Handle to the open file, if it is not a BGZF file */
+  gzFile mFile = nullptr;
+
+  /** Reader for the open file, if it is a BGZF file */
+  std::unique_ptr<BgzfReader> mBgzf;
+
+  /** Decompressed text, of which [mStart, mEnd) has not yet been returned */
+  std::vector<char> mBuffer;
+  std::size_t mStart = 0ul;
+  std::size_t mEnd = 0ul;
+
+  /** Whether the whole file has been read into the buffer */
+  bool mEndOfFile = false;
+
+  /** The number of lines returned so far */
+  unsigned long mLineNumber = 0ul;
+
+  /**
+   * Move the unread text to the front of the buffer, growing the buffer if it is full, and read more of the file after
+   * it. A std::runtime_error will be thrown if the file cannot be decompressed.
+   */
+  void fill();
+
+public:
+  /** The default size of the buffer, in bytes */
+  static constexpr std::size_t defaultBufferSize = 1ul << 22;
+
+  /**
+   * Open a file for reading. A std::runtime_error will be thrown if it cannot be opened.
+   *
+   * @param filePath path to the file
+   * @param bufferSize the initial size of the buffer, in bytes
+   * @param numThreads the number of threads to decompress a BGZF file with, where 0 means one per hardware thread
+   */
+  explicit LineReader(const fs::path& filePath, std::size_t bufferSize = defaultBufferSize,
+                      unsigned long numThreads = 1ul);
+
+  LineReader(const LineReader&) = delete;
+  LineReader& operator=(const LineReader&) = delete;
+  ~LineReader();
+
+  /**
+   * Read the next line, without its newline or trailing whitespace. The view is valid until the next call.
+   *
+   * @param line the view to receive the line
+   * @return whether a line was read, or false at the end of the file
+   */
+  bool nextLine(std::string_view& line);
+
+  /**
+   * Read as many whole lines as the buffer holds, in one piece, including their newlines and any trailing whitespace.
+   * The buffer is filled first, so each piece is about the size of the buffer unless a single line is longer. The view
+   * is valid until the next call.
+   *
+   * @param lines the view to receive the lines
+   * @return whether any lines were read, or false at the end of the file
+   */
+  bool nextLines(std::string_view& lines);
+
+  /**
+   * Read whole lines as nextLines(std::string_view&), but hand the reader's buffer over to the caller rather than
+   * returning a view into it, so that the lines stay valid after later calls without being copied. The buffer is
+   * swapped with storage, whose old memory becomes the reader's buffer, and only an unread partial line is copied.
+   *
+   * @param storage the vector to receive the buffer holding the lines
+   * @param lines the view to receive the lines, which points into storage
+   * @return whether any lines were read, or false at the end of the file
+   */
+  bool nextLines(std::vector<char>& storage, std::string_view& lines);
+
+  /**
+   * @return the number of lines read so far, which is the 1-based line number of the last line read
+   */
+  [[nodiscard]] unsigned long getLineNumber() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_LINE_READER_HPP
@@ -0,0 +1,144 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "MemoryMappedFile.hpp"
+
+#include <exception>
+#include <utility>
+
+#include <fmt/core.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace asmc {
+
+#ifdef _WIN32
+
+MemoryMappedFile::MemoryMappedFile(const fs::path& filePath) {
+  HANDLE file = CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error(fmt::format("Could not open {} for memory mapping", filePath.string()));
+  }
+  mFileHandle = file;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    unmap();
+    throw std::runtime_error(fmt::format("Could not determine the size of {}", filePath.string()));
+  }
+  mSize = static_cast<std::size_t>(fileSize.QuadPart);
+  if (mSize == 0ul) {
+    return;
+  }
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    unmap();
+    throw std::runtime_error(fmt::format("Could not memory map {}", filePath.string()));
+  }
+  mMappingHandle = mapping;
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    unmap();
+    throw std::runtime_error(fmt::format("Could not memory map {}", filePath.string()));
+  }
+  mData = static_cast<const uint8_t*>(view);
+}
+
+void MemoryMappedFile::unmap() noexcept {
+  if (mData != nullptr) {
+    UnmapViewOfFile(mData);
+  }
+  if (mMappingHandle != nullptr) {
+    CloseHandle(mMappingHandle);
+  }
+  if (mFileHandle != nullptr) {
+    CloseHandle(mFileHandle);
+  }
+  mData = nullptr;
+  mMappingHandle = nullptr;
+  mFileHandle = nullptr;
+  mSize = 0ul;
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const fs::path& filePath) {
+  const int fd = ::open(filePath.string().c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Could not open {} for memory mapping", filePath.string()));
+  }
+
+  struct stat fileStat {};
+  if (::fstat(fd, &fileStat) != 0) {
+    ::close(fd);
+    throw std::runtime_error(fmt::format("Could not determine the size of {}", filePath.string()));
+  }
+  mSize = static_cast<std::size_t>(fileStat.st_size);
+
+  // mmap of length zero is an error, so an empty file is represented by a null mapping
+  if (mSize > 0ul) {
+    void* mapping = ::mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error(fmt::format("Could not memory map {}", filePath.string()));
+    }
+    mData = static_cast<const uint8_t*>(mapping);
+  }
+
+  // The mapping remains valid after the file descriptor is closed
+  ::close(fd);
+}
+
+void MemoryMappedFile::unmap() noexcept {
+  if (mData != nullptr) {
+    ::munmap(const_cast<uint8_t*>(mData), mSize);
+  }
+  mData = nullptr;
+  mSize = 0ul;
+}
+
+#endif
+
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& other) noexcept {
+  if (this != &other) {
+    unmap();
+    std::swap(mData, other.mData);
+    std::swap(mSize, other.mSize);
+#ifdef _WIN32
+    std::swap(mFileHandle, other.mFileHandle);
+    std::swap(mMappingHandle, other.mMappingHandle);
+#endif
+  }
+  return *this;
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  unmap();
+}
+
+const uint8_t* MemoryMappedFile::data() const {
+  return mData;
+}
+
+std::size_t MemoryMappedFile::size() const {
+  return mSize;
+}
+
+} // namespace asmc
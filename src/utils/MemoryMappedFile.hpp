@@ -0,0 +1,66 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_MEMORY_MAPPED_FILE_HPP
+#define DATA_MODULE_MEMORY_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * A read-only view of a file mapped into memory. The mapping is shared with the operating system's page cache, so
+ * several processes mapping the same file do not each hold a private copy of it.
+ *
+ * Instances are move-only: the mapping is released when the owning instance is destroyed.
+ */
+class MemoryMappedFile {
+
+private:
+  /** Pointer to the first byte of the mapping, or nullptr if the file is empty */
+  const uint8_t* mData = nullptr;
+
+  /** The size of the mapping, in bytes */
+  std::size_t mSize = 0ul;
+
+#ifdef _WIN32
+  /** Windows handles for the file and the file mapping object */
+  void* mFileHandle = nullptr;
+  void* mMappingHandle = nullptr;
+#endif
+
+  /** Release the mapping, if any */
+  void unmap() noexcept;
+
+public:
+  /**
+   * Map a file into memory for reading. A std::runtime_error will be thrown if the file cannot be opened or mapped.
+   *
+   * @param filePath path to the file to map
+   */
+  explicit MemoryMappedFile(const fs::path& filePath);
+
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+  MemoryMappedFile(MemoryMappedFile&& other) noexcept;
+  MemoryMappedFile& operator=(MemoryMappedFile&& other) noexcept;
+  ~MemoryMappedFile();
+
+  /**
+   * @return pointer to the first byte of the mapped file
+   */
+  [[nodiscard]] const uint8_t* data() const;
+
+  /**
+   * @return the size of the mapped file, in bytes
+   */
+  [[nodiscard]] std::size_t size() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_MEMORY_MAPPED_FILE_HPP
@@ -0,0 +1,203 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "MetadataCache.hpp"
+
+#include "BufferedFileWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <system_error>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+namespace {
+
+/** The fixed-size header at the start of every sidecar */
+struct MetadataCacheHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  std::array<char, 16> kind;
+  uint32_t reserved;
+  uint64_t sourceSize;
+  int64_t sourceModified;
+  uint64_t payloadSize;
+  uint64_t checksum;
+};
+
+constexpr std::array<char, 8> metadataCacheMagic = {'D', 'M', 'C', 'A', 'C', 'H', 'E', '\0'};
+
+/**
+ * A fast, non-cryptographic 64-bit checksum, mixing in eight bytes at a time.
+ *
+ * @param data pointer to the bytes
+ * @param numBytes the number of bytes
+ * @return the checksum
+ */
+uint64_t checksum(const char* data, std::size_t numBytes) {
+  uint64_t hash = 0x9e3779b97f4a7c15ull ^ static_cast<uint64_t>(numBytes);
+  auto mix = [&hash](uint64_t word) {
+    hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32u;
+  };
+
+  std::size_t i = 0ul;
+  for (; i + 8ul <= numBytes; i += 8ul) {
+    uint64_t word = 0ull;
+    std::memcpy(&word, data + i, 8ul);
+    mix(word);
+  }
+  if (i < numBytes) {
+    uint64_t tail = 0ull;
+    std::memcpy(&tail, data + i, numBytes - i);
+    mix(tail);
+  }
+  return hash;
+}
+
+/**
+ * Fill in the fields of a header describing the source file, returning false if the source file cannot be examined.
+ */
+bool describeSource(const fs::path& sourceFile, MetadataCacheHeader& header) {
+  std::error_code ec;
+  const auto size = fs::file_size(sourceFile, ec);
+  if (ec) {
+    return false;
+  }
+  const auto modified = fs::last_write_time(sourceFile, ec);
+  if (ec) {
+    return false;
+  }
+  header.sourceSize = static_cast<uint64_t>(size);
+  header.sourceModified = static_cast<int64_t>(modified.time_since_epoch().count());
+  return true;
+}
+
+/**
+ * Copy a kind tag into the fixed-size field of a header, padding with zeros.
+ */
+std::array<char, 16> kindField(std::string_view kind) {
+  std::array<char, 16> field = {};
+  std::copy_n(kind.begin(), std::min(kind.size(), field.size() - 1ul), field.begin());
+  return field;
+}
+
+} // namespace
+
+fs::path metadataCachePath(const fs::path& sourceFile) {
+  return fs::path(sourceFile.string() + ".dmcache");
+}
+
+MetadataCacheWriter::MetadataCacheWriter(std::string_view kind) : mKind{kind} {
+}
+
+void MetadataCacheWriter::append(const void* data, std::size_t numBytes) {
+  const auto* bytes = static_cast<const char*>(data);
+  mPayload.insert(mPayload.end(), bytes, bytes + numBytes);
+}
+
+void MetadataCacheWriter::writeStrings(const StringColumn& strings) {
+  writeVector(strings.getOffsets());
+  writeVector(strings.getChars());
+}
+
+void MetadataCacheWriter::writeStrings(const std::vector<std::string>& strings) {
+  StringColumn column;
+  std::size_t numChars = 0ul;
+  for (const std::string& s : strings) {
+    numChars += s.size();
+  }
+  column.reserve(strings.size(), numChars);
+  for (const std::string& s : strings) {
+    column.push_back(s);
+  }
+  writeStrings(column);
+}
+
+bool MetadataCacheWriter::save(const fs::path& sourceFile) const {
+  MetadataCacheHeader header{};
+  header.magic = metadataCacheMagic;
+  header.version = metadataCacheVersion;
+  header.kind = kindField(mKind);
+  header.payloadSize = static_cast<uint64_t>(mPayload.size());
+  header.checksum = checksum(mPayload.data(), mPayload.size());
+  if (!describeSource(sourceFile, header)) {
+    return false;
+  }
+
+  const fs::path cachePath = metadataCachePath(sourceFile);
+  const fs::path tempPath = fs::path(fmt::format("{}.{:x}.tmp", cachePath.string(), std::random_device{}()));
+  try {
+    BufferedFileWriter writer(tempPath.string());
+    writer.write(&header, sizeof(header));
+    writer.write(mPayload.data(), mPayload.size());
+    writer.close();
+    fs::rename(tempPath, cachePath);
+  } catch (const std::exception&) {
+    std::error_code ec;
+    fs::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+MetadataCacheReader::MetadataCacheReader(MemoryMappedFile file, std::size_t payloadStart)
+    : mFile{std::move(file)}, mPosition{payloadStart} {
+}
+
+std::optional<MetadataCacheReader> MetadataCacheReader::open(const fs::path& sourceFile, std::string_view kind) {
+  const fs::path cachePath = metadataCachePath(sourceFile);
+  MetadataCacheHeader source{};
+  std::error_code ec;
+  if (!fs::is_regular_file(cachePath, ec) || !describeSource(sourceFile, source)) {
+    return std::nullopt;
+  }
+
+  try {
+    MemoryMappedFile file(cachePath);
+    MetadataCacheHeader header{};
+    if (file.size() < sizeof(header)) {
+      return std::nullopt;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    const char* payload = reinterpret_cast<const char*>(file.data()) + sizeof(header);
+    if (header.magic != metadataCacheMagic || header.version != metadataCacheVersion ||
+        header.kind != kindField(kind) || header.sourceSize != source.sourceSize ||
+        header.sourceModified != source.sourceModified || header.payloadSize != file.size() - sizeof(header) ||
+        header.checksum != checksum(payload, file.size() - sizeof(header))) {
+      return std::nullopt;
+    }
+    return MetadataCacheReader(std::move(file), sizeof(header));
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+void MetadataCacheReader::require(std::size_t numElements, std::size_t elementSize) const {
+  if (numElements > (mFile.size() - mPosition) / elementSize) {
+    throw std::runtime_error("Metadata cache ends before all of its values were read");
+  }
+}
+
+void MetadataCacheReader::read(void* out, std::size_t numBytes) {
+  require(numBytes, 1ul);
+  if (numBytes > 0ul) {
+    std::memcpy(out, mFile.data() + mPosition, numBytes);
+  }
+  mPosition += numBytes;
+}
+
+StringColumn MetadataCacheReader::readStrings() {
+  std::vector<std::size_t> offsets = readVector<std::size_t>();
+  std::vector<char> chars = readVector<char>();
+  return StringColumn(std::move(chars), std::move(offsets));
+}
+
+} // namespace asmc
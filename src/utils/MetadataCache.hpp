@@ -0,0 +1,152 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_METADATA_CACHE_HPP
+#define DATA_MODULE_METADATA_CACHE_HPP
+
+#include "MemoryMappedFile.hpp"
+#include "StringColumn.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/** The version of the sidecar format. Sidecars written with a different version are ignored */
+constexpr uint32_t metadataCacheVersion = 1u;
+
+/**
+ * @param sourceFile path to a text input file
+ * @return path to the binary sidecar caching the parsed contents of the file
+ */
+fs::path metadataCachePath(const fs::path& sourceFile);
+
+/**
+ * Builds the binary sidecar for a parsed text file. Values are appended to a payload in the order they will be read
+ * back by MetadataCacheReader, and save() writes the payload after a header recording the format version, the kind of
+ * file, the size and modification time of the source file, and a checksum of the payload.
+ *
+ * Sidecars hold the machine's native byte order and type sizes: they are a local cache, not an interchange format.
+ */
+class MetadataCacheWriter {
+
+private:
+  /** A short tag naming the kind of file cached, such as "bim" */
+  std::string mKind;
+
+  /** The serialised values */
+  std::vector<char> mPayload;
+
+  /**
+   * Append raw bytes to the payload.
+   *
+   * @param data pointer to the bytes
+   * @param numBytes the number of bytes
+   */
+  void append(const void* data, std::size_t numBytes);
+
+public:
+  /**
+   * @param kind a short tag naming the kind of file cached, of at most 15 characters
+   */
+  explicit MetadataCacheWriter(std::string_view kind);
+
+  template <typename T> void writeValue(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be cached");
+    append(&value, sizeof(T));
+  }
+
+  template <typename T> void writeVector(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of trivially copyable values can be cached");
+    writeValue(static_cast<uint64_t>(values.size()));
+    append(values.data(), values.size() * sizeof(T));
+  }
+
+  void writeStrings(const StringColumn& strings);
+  void writeStrings(const std::vector<std::string>& strings);
+
+  /**
+   * Write the sidecar for a source file, replacing any existing sidecar. The sidecar is written to a temporary file
+   * and renamed into place, so that concurrent readers never see a partial sidecar. Failing to write the sidecar, for
+   * example in a read-only directory, is not an error.
+   *
+   * @param sourceFile path to the text file that was parsed
+   * @return whether the sidecar was written
+   */
+  bool save(const fs::path& sourceFile) const;
+};
+
+/**
+ * Reads values back from a binary sidecar written by MetadataCacheWriter, in the order they were written. The sidecar
+ * is mapped into memory.
+ */
+class MetadataCacheReader {
+
+private:
+  /** The mapped sidecar */
+  MemoryMappedFile mFile;
+
+  /** The offset of the next value to read */
+  std::size_t mPosition;
+
+  MetadataCacheReader(MemoryMappedFile file, std::size_t payloadStart);
+
+  /**
+   * Check that the sidecar holds enough bytes for a number of elements after the current position, throwing a
+   * std::runtime_error if it does not.
+   *
+   * @param numElements the number of elements
+   * @param elementSize the size of each element, in bytes
+   */
+  void require(std::size_t numElements, std::size_t elementSize) const;
+
+  /**
+   * Copy the next bytes out of the sidecar. A std::runtime_error will be thrown if there are too few bytes left.
+   *
+   * @param out pointer to receive the bytes
+   * @param numBytes the number of bytes
+   */
+  void read(void* out, std::size_t numBytes);
+
+public:
+  /**
+   * Open the sidecar of a source file, if there is a valid one. A sidecar is only valid if it has the current format
+   * version, the same kind, a matching payload checksum, and records the current size and modification time of the
+   * source file.
+   *
+   * @param sourceFile path to the text file
+   * @param kind the kind of file expected, as passed to MetadataCacheWriter
+   * @return a reader positioned at the first value, or an empty optional if there is no valid sidecar
+   */
+  static std::optional<MetadataCacheReader> open(const fs::path& sourceFile, std::string_view kind);
+
+  template <typename T> T readValue() {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be cached");
+    T value{};
+    read(&value, sizeof(T));
+    return value;
+  }
+
+  template <typename T> std::vector<T> readVector() {
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of trivially copyable values can be cached");
+    const auto size = static_cast<std::size_t>(readValue<uint64_t>());
+    require(size, sizeof(T));
+    std::vector<T> values(size);
+    read(values.data(), size * sizeof(T));
+    return values;
+  }
+
+  StringColumn readStrings();
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_METADATA_CACHE_HPP
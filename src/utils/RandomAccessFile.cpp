@@ -0,0 +1,151 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "RandomAccessFile.hpp"
+
+#include <cerrno>
+#include <exception>
+#include <utility>
+
+#include <fmt/core.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace asmc {
+
+#ifdef _WIN32
+
+RandomAccessFile::RandomAccessFile(const fs::path& filePath) : mFilePath{filePath} {
+  HANDLE file = CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error(fmt::format("Could not open {} for reading", filePath.string()));
+  }
+  mHandle = file;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    close();
+    throw std::runtime_error(fmt::format("Could not determine the size of {}", filePath.string()));
+  }
+  mSize = static_cast<std::size_t>(fileSize.QuadPart);
+}
+
+void RandomAccessFile::close() noexcept {
+  if (mHandle != nullptr) {
+    CloseHandle(mHandle);
+  }
+  mHandle = nullptr;
+}
+
+void RandomAccessFile::readAt(std::size_t offset, void* buffer, std::size_t numBytes) const {
+  if (offset + numBytes > mSize) {
+    throw std::runtime_error(fmt::format("Cannot read {} bytes at offset {} from {}, which contains {} bytes",
+                                         numBytes, offset, mFilePath.string(), mSize));
+  }
+
+  auto* dest = static_cast<char*>(buffer);
+  while (numBytes > 0ul) {
+    const auto chunk = static_cast<DWORD>(numBytes < (1ul << 30) ? numBytes : (1ul << 30));
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFull);
+    overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+    DWORD bytesRead = 0;
+    if (!ReadFile(mHandle, dest, chunk, &bytesRead, &overlapped) || bytesRead == 0) {
+      throw std::runtime_error(fmt::format("Error reading {} at offset {}", mFilePath.string(), offset));
+    }
+    dest += bytesRead;
+    offset += bytesRead;
+    numBytes -= bytesRead;
+  }
+}
+
+#else
+
+RandomAccessFile::RandomAccessFile(const fs::path& filePath) : mFilePath{filePath} {
+  mFd = ::open(filePath.string().c_str(), O_RDONLY);
+  if (mFd < 0) {
+    throw std::runtime_error(fmt::format("Could not open {} for reading", filePath.string()));
+  }
+
+  struct stat fileStat {};
+  if (::fstat(mFd, &fileStat) != 0) {
+    close();
+    throw std::runtime_error(fmt::format("Could not determine the size of {}", filePath.string()));
+  }
+  mSize = static_cast<std::size_t>(fileStat.st_size);
+}
+
+void RandomAccessFile::close() noexcept {
+  if (mFd >= 0) {
+    ::close(mFd);
+  }
+  mFd = -1;
+}
+
+void RandomAccessFile::readAt(std::size_t offset, void* buffer, std::size_t numBytes) const {
+  if (offset + numBytes > mSize) {
+    throw std::runtime_error(fmt::format("Cannot read {} bytes at offset {} from {}, which contains {} bytes",
+                                         numBytes, offset, mFilePath.string(), mSize));
+  }
+
+  // pread may return fewer bytes than requested, so keep reading until the request is satisfied
+  auto* dest = static_cast<char*>(buffer);
+  while (numBytes > 0ul) {
+    const ssize_t bytesRead = ::pread(mFd, dest, numBytes, static_cast<off_t>(offset));
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead <= 0) {
+      throw std::runtime_error(fmt::format("Error reading {} at offset {}", mFilePath.string(), offset));
+    }
+    dest += bytesRead;
+    offset += static_cast<std::size_t>(bytesRead);
+    numBytes -= static_cast<std::size_t>(bytesRead);
+  }
+}
+
+#endif
+
+void RandomAccessFile::adviseSequential() const {
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+  ::posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+RandomAccessFile::RandomAccessFile(RandomAccessFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+RandomAccessFile& RandomAccessFile::operator=(RandomAccessFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    std::swap(mFilePath, other.mFilePath);
+    std::swap(mSize, other.mSize);
+#ifdef _WIN32
+    std::swap(mHandle, other.mHandle);
+#else
+    std::swap(mFd, other.mFd);
+#endif
+  }
+  return *this;
+}
+
+RandomAccessFile::~RandomAccessFile() {
+  close();
+}
+
+std::size_t RandomAccessFile::size() const {
+  return mSize;
+}
+
+} // namespace asmc
@@ -0,0 +1,79 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_RANDOM_ACCESS_FILE_HPP
+#define DATA_MODULE_RANDOM_ACCESS_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace asmc {
+
+namespace fs = std::filesystem;
+
+/**
+ * A read-only file supporting positioned reads. Reads do not share a file offset, so a single instance may be read
+ * from concurrently by several threads.
+ *
+ * Instances are move-only: the file is closed when the owning instance is destroyed.
+ */
+class RandomAccessFile {
+
+private:
+  /** Path to the file, used in error messages */
+  fs::path mFilePath;
+
+  /** The size of the file, in bytes */
+  std::size_t mSize = 0ul;
+
+#ifdef _WIN32
+  /** Windows handle for the file */
+  void* mHandle = nullptr;
+#else
+  /** POSIX file descriptor */
+  int mFd = -1;
+#endif
+
+  /** Close the file, if open */
+  void close() noexcept;
+
+public:
+  /**
+   * Open a file for reading. A std::runtime_error will be thrown if the file cannot be opened.
+   *
+   * @param filePath path to the file
+   */
+  explicit RandomAccessFile(const fs::path& filePath);
+
+  RandomAccessFile(const RandomAccessFile&) = delete;
+  RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+  RandomAccessFile(RandomAccessFile&& other) noexcept;
+  RandomAccessFile& operator=(RandomAccessFile&& other) noexcept;
+  ~RandomAccessFile();
+
+  /**
+   * Read exactly numBytes bytes starting at a given offset. A std::runtime_error will be thrown if the read fails or
+   * would extend beyond the end of the file.
+   *
+   * @param offset offset from the start of the file, in bytes
+   * @param buffer destination for the bytes read
+   * @param numBytes number of bytes to read
+   */
+  void readAt(std::size_t offset, void* buffer, std::size_t numBytes) const;
+
+  /**
+   * Advise the operating system that the file will be read sequentially, so that it can read ahead more aggressively.
+   * This is a hint only, and does nothing on platforms without posix_fadvise.
+   */
+  void adviseSequential() const;
+
+  /**
+   * @return the size of the file, in bytes
+   */
+  [[nodiscard]] std::size_t size() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_RANDOM_ACCESS_FILE_HPP
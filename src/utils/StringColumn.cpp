@@ -0,0 +1,80 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "StringColumn.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace asmc {
+
+StringColumn::StringColumn(std::vector<char> chars, std::vector<std::size_t> offsets)
+    : mChars{std::move(chars)}, mOffsets{std::move(offsets)} {
+  if (mOffsets.empty() || mOffsets.front() != 0ul || mOffsets.back() != mChars.size() ||
+      !std::is_sorted(mOffsets.begin(), mOffsets.end())) {
+    throw std::runtime_error("String column offsets must increase from zero to the number of characters");
+  }
+}
+
+void StringColumn::reserve(std::size_t numStrings, std::size_t numChars) {
+  mOffsets.reserve(numStrings + 1ul);
+  mChars.reserve(numChars);
+}
+
+void StringColumn::push_back(std::string_view s) {
+  mChars.insert(mChars.end(), s.begin(), s.end());
+  mOffsets.emplace_back(mChars.size());
+}
+
+std::size_t StringColumn::size() const {
+  return mOffsets.size() - 1ul;
+}
+
+bool StringColumn::empty() const {
+  return size() == 0ul;
+}
+
+std::size_t StringColumn::numChars() const {
+  return mChars.size();
+}
+
+std::string_view StringColumn::operator[](std::size_t i) const {
+  return {mChars.data() + mOffsets[i], mOffsets[i + 1ul] - mOffsets[i]};
+}
+
+std::string_view StringColumn::at(std::size_t i) const {
+  if (i >= size()) {
+    throw std::out_of_range(fmt::format("String {} requested from a column of {} strings", i, size()));
+  }
+  return (*this)[i];
+}
+
+std::string_view StringColumn::front() const {
+  return at(0ul);
+}
+
+std::string_view StringColumn::back() const {
+  return at(size() - 1ul);
+}
+
+const std::vector<char>& StringColumn::getChars() const {
+  return mChars;
+}
+
+const std::vector<std::size_t>& StringColumn::getOffsets() const {
+  return mOffsets;
+}
+
+std::vector<std::string> StringColumn::toVector() const {
+  std::vector<std::string> strings;
+  strings.reserve(size());
+  for (std::size_t i = 0ul; i < size(); ++i) {
+    strings.emplace_back((*this)[i]);
+  }
+  return strings;
+}
+
+} // namespace asmc
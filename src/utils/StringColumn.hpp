@@ -0,0 +1,93 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_STRING_COLUMN_HPP
+#define DATA_MODULE_STRING_COLUMN_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace asmc {
+
+/**
+ * A column of strings held back to back in a single character arena, with the start of each string recorded as an
+ * offset into the arena. Compared with a std::vector<std::string>, this makes one allocation for the characters rather
+ * than one per long string, and keeps the strings contiguous in memory.
+ *
+ * Strings are accessed as std::string_view, which remain valid until the column is next modified.
+ */
+class StringColumn {
+
+private:
+  /** The characters of every string, concatenated */
+  std::vector<char> mChars;
+
+  /** String i occupies [mOffsets[i], mOffsets[i + 1]) in mChars */
+  std::vector<std::size_t> mOffsets = {0ul};
+
+public:
+  StringColumn() = default;
+
+  /**
+   * Create a column from an arena and its offsets, as returned by getChars() and getOffsets(). A std::runtime_error
+   * will be thrown if the offsets do not start at zero, decrease, or end at the size of the arena.
+   *
+   * @param chars the characters of every string, concatenated
+   * @param offsets the start of each string in chars, followed by the size of chars
+   */
+  StringColumn(std::vector<char> chars, std::vector<std::size_t> offsets);
+
+  /**
+   * Reserve space for a number of strings with a total length, so that appending them does not reallocate.
+   *
+   * @param numStrings the number of strings
+   * @param numChars the total number of characters in the strings
+   */
+  void reserve(std::size_t numStrings, std::size_t numChars);
+
+  /**
+   * Append a string to the end of the column.
+   *
+   * @param s the string to append
+   */
+  void push_back(std::string_view s);
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] bool empty() const;
+
+  /**
+   * @return the total number of characters in the strings
+   */
+  [[nodiscard]] std::size_t numChars() const;
+
+  /**
+   * @param i the index of a string, which is not bounds-checked
+   * @return a view of the string
+   */
+  [[nodiscard]] std::string_view operator[](std::size_t i) const;
+
+  /**
+   * Get a string, throwing a std::out_of_range if the index is not less than size().
+   *
+   * @param i the index of a string
+   * @return a view of the string
+   */
+  [[nodiscard]] std::string_view at(std::size_t i) const;
+
+  [[nodiscard]] std::string_view front() const;
+  [[nodiscard]] std::string_view back() const;
+
+  [[nodiscard]] const std::vector<char>& getChars() const;
+  [[nodiscard]] const std::vector<std::size_t>& getOffsets() const;
+
+  /**
+   * @return a copy of the strings as a vector
+   */
+  [[nodiscard]] std::vector<std::string> toVector() const;
+};
+
+} // namespace asmc
+
+#endif // DATA_MODULE_STRING_COLUMN_HPP
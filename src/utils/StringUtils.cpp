@@ -3,6 +3,8 @@
 
 #include "StringUtils.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <exception>
 #include <string>
 #include <string_view>
@@ -19,6 +21,40 @@ std::vector<std::string> splitTextByDelimiter(std::string_view text, std::string
   return text | ranges::views::split(del) | ranges::to<std::vector<std::string>>();
 }
 
+void splitIntoViews(std::string_view line, char del, std::vector<std::string_view>& fields) {
+  fields.clear();
+  for (std::size_t fieldStart = 0ul; fieldStart <= line.size();) {
+    const std::size_t fieldEnd = std::min(line.find(del, fieldStart), line.size());
+    fields.emplace_back(line.substr(fieldStart, fieldEnd - fieldStart));
+    fieldStart = fieldEnd + 1ul;
+  }
+}
+
+std::size_t countLines(std::string_view text) {
+  std::size_t numLines = 0ul;
+  const char* next = text.data();
+  const char* end = text.data() + text.size();
+  while (next < end) {
+    const auto* newline = static_cast<const char*>(std::memchr(next, '\n', static_cast<std::size_t>(end - next)));
+    if (newline == nullptr) {
+      return numLines + 1ul;
+    }
+    ++numLines;
+    next = newline + 1;
+  }
+  return numLines;
+}
+
+std::string_view popLine(std::string_view& text) {
+  const std::size_t lineEnd = std::min(text.find('\n'), text.size());
+  std::string_view line = text.substr(0ul, lineEnd);
+  text.remove_prefix(std::min(lineEnd + 1ul, text.size()));
+  while (!line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r')) {
+    line.remove_suffix(1ul);
+  }
+  return line;
+}
+
 std::string stripBack(std::string s) {
   while (!s.empty() && (s.back() == '\n' || s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
     s.pop_back();
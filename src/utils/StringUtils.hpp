@@ -4,6 +4,7 @@
 #ifndef DATA_MODULE_STRING_UTILS_HPP
 #define DATA_MODULE_STRING_UTILS_HPP
 
+#include <cstddef>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -19,6 +20,31 @@ namespace asmc {
  */
 std::vector<std::string> splitTextByDelimiter(std::string_view text, std::string_view del);
 
+/**
+ * Split a line into fields at a delimiter, as views into the line rather than copies.
+ *
+ * @param line the line to split
+ * @param del the delimiter to split by
+ * @param fields the vector to receive the fields, whose previous contents are discarded
+ */
+void splitIntoViews(std::string_view line, char del, std::vector<std::string_view>& fields);
+
+/**
+ * Count the lines in a block of text: the number of newline characters, plus one if the text does not end in a newline.
+ *
+ * @param text the text
+ * @return the number of lines
+ */
+std::size_t countLines(std::string_view text);
+
+/**
+ * Remove the first line from a block of text, and return it without its newline or trailing whitespace.
+ *
+ * @param text the text, which is advanced past the first line
+ * @return the first line, with whitespace stripped from the back
+ */
+std::string_view popLine(std::string_view& text);
+
 /**
  * Remove whitespace characters '\n', ' ', '\t', '\r' from the end of a string
  *
@@ -0,0 +1,94 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#ifndef DATA_MODULE_THREAD_UTILS_HPP
+#define DATA_MODULE_THREAD_UTILS_HPP
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace asmc {
+
+/**
+ * Resolve a requested number of threads, where 0 means one thread per hardware thread.
+ *
+ * @param numThreads the requested number of threads
+ * @return the number of threads to use, which is at least 1
+ */
+inline unsigned long resolveNumThreads(unsigned long numThreads) {
+  if (numThreads == 0ul) {
+    numThreads = static_cast<unsigned long>(std::thread::hardware_concurrency());
+  }
+  return std::max(numThreads, 1ul);
+}
+
+/**
+ * Split the range [begin, end) into at most numThreads contiguous chunks of near-equal size, and call func(first,
+ * last) on each chunk from its own thread. The calling thread processes the first chunk. If any call throws, the
+ * exception from the earliest chunk in the range is rethrown once every thread has finished, so the error reported
+ * does not depend on thread timing. If a thread cannot be started, the threads already started are joined and the
+ * std::system_error is rethrown.
+ *
+ * @tparam Function callable with signature void(unsigned long first, unsigned long last)
+ * @param begin the start of the range
+ * @param end one past the end of the range
+ * @param numThreads the number of threads to use, where 0 means one thread per hardware thread
+ * @param func the function to call on each chunk
+ */
+template <typename Function>
+void parallelFor(unsigned long begin, unsigned long end, unsigned long numThreads, Function&& func) {
+  if (end <= begin) {
+    return;
+  }
+
+  const unsigned long numChunks = std::min(resolveNumThreads(numThreads), end - begin);
+  const unsigned long chunkSize = (end - begin) / numChunks;
+  const unsigned long remainder = (end - begin) % numChunks;
+
+  // Each chunk records its own exception, so no lock is needed
+  std::vector<std::exception_ptr> exceptions(numChunks);
+  auto runChunk = [&func, &exceptions](unsigned long chunk, unsigned long first, unsigned long last) {
+    try {
+      func(first, last);
+    } catch (...) {
+      exceptions[chunk] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(numChunks - 1ul);
+  auto joinAll = [&threads] {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+
+  const unsigned long firstChunkEnd = begin + chunkSize + (remainder > 0ul ? 1ul : 0ul);
+  unsigned long first = firstChunkEnd;
+  try {
+    for (unsigned long chunk = 1ul; chunk < numChunks; ++chunk) {
+      const unsigned long last = first + chunkSize + (chunk < remainder ? 1ul : 0ul);
+      threads.emplace_back(runChunk, chunk, first, last);
+      first = last;
+    }
+  } catch (...) {
+    // Destroying a joinable std::thread calls std::terminate, so wait for the threads already started
+    joinAll();
+    throw;
+  }
+
+  runChunk(0ul, begin, firstChunkEnd);
+  joinAll();
+
+  for (const auto& exception : exceptions) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+}
+
+} // namespace asmc
+
+#endif // DATA_MODULE_THREAD_UTILS_HPP
@@ -0,0 +1,115 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedBlockReader.hpp"
+#include "BedMatrixType.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <utility>
+
+namespace asmc {
+
+TEST_CASE("BedBlockReader: test exceptions", "[BedBlockReader]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+  std::string truncatedBedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/truncated.bed";
+
+  CHECK_THROWS_WITH(BedBlockReader(bedFile, bimFile, famFile, 0ul), Catch::Contains("must be at least 1"));
+  CHECK_THROWS_WITH(BedBlockReader(truncatedBedFile, bimFile, famFile, 10ul), Catch::Contains("bytes for"));
+
+  std::string individualMajorBedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/individual_major.bed";
+  CHECK_THROWS_WITH(BedBlockReader(individualMajorBedFile, bimFile, famFile, 10ul),
+                    Catch::Contains("requires a SNP-major .bed file"));
+}
+
+TEST_CASE("BedBlockReader: blocks match the full matrix", "[BedBlockReader]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto full = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  const mat_uint8_t& data = full.getData();
+
+  for (unsigned long blockSize : {1ul, 7ul, 100ul, 1000ul}) {
+    for (bool prefetch : {false, true}) {
+      BedBlockReader reader(bedFile, bimFile, famFile, blockSize, prefetch);
+      CHECK(reader.getNumSites() == 100ul);
+      CHECK(reader.getNumIndividuals() == 50ul);
+      CHECK(reader.getBlockSize() == 0ul);
+
+      // Read the file twice to check reset()
+      for (int pass = 0; pass < 2; ++pass) {
+        unsigned long numSitesRead = 0ul;
+        unsigned long numBlocks = 0ul;
+        rvec_ul_t missingCounts = rvec_ul_t::Zero(100l);
+
+        while (reader.nextBlock()) {
+          const auto block = reader.getBlock();
+          const auto start = static_cast<index_t>(reader.getBlockStart());
+          const auto size = static_cast<index_t>(reader.getBlockSize());
+
+          CHECK(reader.getBlockStart() == numSitesRead);
+          CHECK(block.rows() == 50l);
+          CHECK(block.cols() == size);
+          CHECK(block == data.middleCols(start, size));
+
+          const BimFile& blockBim = reader.getBlockBim();
+          CHECK(&blockBim == &reader.getBlockBim());
+          REQUIRE(blockBim.getNumSites() == reader.getBlockSize());
+          CHECK(blockBim.getSnpIds().front() == full.getSiteName(reader.getBlockStart()));
+          CHECK(blockBim.getPhysicalPositions().back() ==
+                full.getPhysicalPositions().at(reader.getBlockStart() + reader.getBlockSize() - 1ul));
+
+          missingCounts.segment(start, size) = (block.array() == 3).colwise().count().cast<unsigned long>();
+          numSitesRead += reader.getBlockSize();
+          ++numBlocks;
+        }
+
+        CHECK(numSitesRead == 100ul);
+        CHECK(numBlocks == (100ul + blockSize - 1ul) / blockSize);
+        CHECK(missingCounts == full.getMissingCounts());
+        CHECK_FALSE(reader.nextBlock());
+        CHECK(reader.getBlockBim().getNumSites() == 0ul);
+        reader.reset();
+      }
+    }
+  }
+}
+
+TEST_CASE("BedBlockReader: reset and move while prefetching", "[BedBlockReader]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto full = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+
+  BedBlockReader reader(bedFile, bimFile, famFile, 10ul);
+  REQUIRE(reader.nextBlock());
+
+  // Reset while the second block is being prefetched, then read from the start again
+  reader.reset();
+  REQUIRE(reader.nextBlock());
+  CHECK(reader.getBlockStart() == 0ul);
+  CHECK(reader.getBlock() == full.getData().leftCols(10l));
+
+  // A moved-to reader continues from the same position, using the block prefetched by the moved-from reader
+  BedBlockReader moved(std::move(reader));
+  REQUIRE(moved.nextBlock());
+  CHECK(moved.getBlockStart() == 10ul);
+  CHECK(moved.getBlock() == full.getData().middleCols(10l, 10l));
+
+  BedBlockReader assigned(bedFile, bimFile, famFile, 3ul);
+  REQUIRE(assigned.nextBlock());
+  assigned = std::move(moved);
+  REQUIRE(assigned.nextBlock());
+  CHECK(assigned.getBlockStart() == 20ul);
+  CHECK(assigned.getBlock() == full.getData().middleCols(20l, 10l));
+}
+
+} // namespace asmc
@@ -2,11 +2,19 @@
 // See accompanying LICENSE and COPYING for copyright notice and full details.
 
 #include "BedMatrixType.hpp"
+#include "BedWriter.hpp"
+#include "utils/FileUtils.hpp"
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <string>
+#include <vector>
 
 #include <fmt/core.h>
 #include <fmt/ostream.h>
@@ -45,6 +53,7 @@ TEST_CASE("BedMatrixType: test (small) real example", "[BedMatrixType]") {
     const auto& siteNames = bedMatrix.getSiteNames();
     CHECK(siteNames.size() == 100ul);
     CHECK(siteNames.at(67ul) == "null_67");
+    CHECK(bedMatrix.getSiteName(67ul) == "null_67");
   }
 
   // Test getting data as float
@@ -155,4 +164,472 @@ TEST_CASE("BedMatrixType: test (small) real example", "[BedMatrixType]") {
   }
 }
 
+TEST_CASE("BedMatrixType: memory-mapped and packed storage", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto decoded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  CHECK(decoded.getStorage() == BedStorage::Decoded);
+
+  for (auto storage : {BedStorage::MemoryMapped, BedStorage::Packed}) {
+    BedLoadOptions options;
+    options.storage = storage;
+    const auto other = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+
+    CHECK(other.getStorage() == storage);
+    CHECK(other.getNumIndividuals() == decoded.getNumIndividuals());
+    CHECK(other.getNumSites() == decoded.getNumSites());
+    CHECK_THROWS_WITH(other.getData(), Catch::Contains("only available for a BedMatrixType loaded with"));
+
+    const mat_uint8_t& data = decoded.getData();
+    for (unsigned long i = 0ul; i < decoded.getNumSites(); ++i) {
+      CHECK(other.getSite(i) == data.col(static_cast<index_t>(i)));
+    }
+    for (unsigned long i = 0ul; i < decoded.getNumIndividuals(); ++i) {
+      CHECK(other.getIndividual(i) == data.row(static_cast<index_t>(i)));
+    }
+
+    const mat_float_t decodedFloat = decoded.getDataAsFloat();
+    const mat_float_t otherFloat = other.getDataAsFloat();
+    CHECK(decodedFloat.array().isNaN().matrix() == otherFloat.array().isNaN().matrix());
+    CHECK(decodedFloat.array().isNaN().select(0.f, decodedFloat).matrix() ==
+          otherFloat.array().isNaN().select(0.f, otherFloat).matrix());
+
+    CHECK(other.getMissingCounts() == decoded.getMissingCounts());
+    CHECK(other.getDerivedAlleleCounts() == decoded.getDerivedAlleleCounts());
+    CHECK(other.getMinorAlleleCounts() == decoded.getMinorAlleleCounts());
+    CHECK(other.getMinorAlleleFrequencies() == decoded.getMinorAlleleFrequencies());
+    for (unsigned long i = 0ul; i < decoded.getNumSites(); ++i) {
+      CHECK(other.getMissingCount(i) == decoded.getMissingCount(i));
+      CHECK(other.getDerivedAlleleCount(i) == decoded.getDerivedAlleleCount(i));
+      CHECK(other.getMinorAlleleFrequency(i) == decoded.getMinorAlleleFrequency(i));
+    }
+  }
+}
+
+TEST_CASE("BedMatrixType: multi-threaded loading", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto singleThreaded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+
+  for (unsigned long numThreads : {0ul, 3ul, 200ul}) {
+    BedLoadOptions options;
+    options.numThreads = numThreads;
+    const auto decoded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    CHECK(decoded.getData() == singleThreaded.getData());
+    CHECK(decoded.getMissingCounts() == singleThreaded.getMissingCounts());
+
+    options.storage = BedStorage::Packed;
+    const auto packed = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    for (unsigned long i = 0ul; i < packed.getNumSites(); ++i) {
+      CHECK(packed.getSite(i) == singleThreaded.getSite(i));
+    }
+  }
+}
+
+TEST_CASE("BedMatrixType: truncated .bed file", "[BedMatrixType]") {
+
+  // The .bed file does not match the size implied by the .bim and .fam files
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/truncated.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  for (auto storage : {BedStorage::Decoded, BedStorage::MemoryMapped, BedStorage::Packed}) {
+    BedLoadOptions options;
+    options.storage = storage;
+    CHECK_THROWS_WITH(BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options),
+                      Catch::Contains("bytes for"));
+  }
+}
+
+TEST_CASE("BedMatrixType: subsetting at load time", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto full = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  const mat_uint8_t& data = full.getData();
+
+  SECTION("Sites by ID and region") {
+    // null_i has physical position i + 1; the filters intersect, so null_5 and null_50 fall outside the region
+    for (auto storage : {BedStorage::Decoded, BedStorage::MemoryMapped, BedStorage::Packed}) {
+      BedLoadOptions options;
+      options.storage = storage;
+      options.extractSiteIds = {"null_50", "null_12", "null_5", "null_13", "null_15", "not_a_site"};
+      options.chromosome = "1";
+      options.regionStart = 10ul;
+      options.regionEnd = 20ul;
+      const auto subset = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+
+      REQUIRE(subset.getNumSites() == 3ul);
+      CHECK(subset.getNumIndividuals() == 50ul);
+      CHECK(subset.getSiteNames() == std::vector<std::string>{"null_12", "null_13", "null_15"});
+      CHECK(subset.getPhysicalPositions() == std::vector<unsigned long>{13ul, 14ul, 16ul});
+      CHECK(subset.getChrIds() == std::vector<std::string>{"1", "1", "1"});
+
+      const std::vector<unsigned long> fileSiteIds = {12ul, 13ul, 15ul};
+      for (unsigned long i = 0ul; i < fileSiteIds.size(); ++i) {
+        CHECK(subset.getSite(i) == data.col(static_cast<index_t>(fileSiteIds.at(i))));
+        CHECK(subset.getMissingCount(i) == full.getMissingCount(fileSiteIds.at(i)));
+        CHECK(subset.getDerivedAlleleCount(i) == full.getDerivedAlleleCount(fileSiteIds.at(i)));
+      }
+    }
+  }
+
+  SECTION("Individuals by ID") {
+    for (auto storage : {BedStorage::Decoded, BedStorage::Packed}) {
+      for (unsigned long numThreads : {1ul, 4ul}) {
+        BedLoadOptions options;
+        options.storage = storage;
+        options.numThreads = numThreads;
+        options.keepIndividualIds = {"per49", "per3", "per10", "per22", "per41", "nobody"};
+        const auto subset = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+
+        // Individuals keep their order in the .fam file
+        const std::vector<unsigned long> fileIndividualIds = {3ul, 10ul, 22ul, 41ul, 49ul};
+        REQUIRE(subset.getNumIndividuals() == 5ul);
+        CHECK(subset.getNumSites() == 100ul);
+        CHECK(subset.getIndividualIds() == std::vector<std::string>{"per3", "per10", "per22", "per41", "per49"});
+
+        for (unsigned long i = 0ul; i < fileIndividualIds.size(); ++i) {
+          CHECK(subset.getIndividual(i) == data.row(static_cast<index_t>(fileIndividualIds.at(i))));
+        }
+        for (unsigned long siteId = 0ul; siteId < subset.getNumSites(); ++siteId) {
+          const cvec_uint8_t site = subset.getSite(siteId);
+          unsigned long missing = 0ul;
+          for (unsigned long i = 0ul; i < fileIndividualIds.size(); ++i) {
+            const uint8_t expected =
+                data(static_cast<index_t>(fileIndividualIds.at(i)), static_cast<index_t>(siteId));
+            CHECK(site(static_cast<index_t>(i)) == expected);
+            missing += expected == 3u ? 1ul : 0ul;
+          }
+          CHECK(subset.getMissingCount(siteId) == missing);
+        }
+      }
+    }
+
+    BedLoadOptions options;
+    options.storage = BedStorage::MemoryMapped;
+    options.keepIndividualIds = {"per3"};
+    CHECK_THROWS_WITH(BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options),
+                      Catch::Contains("use BedStorage::Packed instead"));
+  }
+
+  SECTION("No matching sites") {
+    BedLoadOptions options;
+    options.chromosome = "22";
+    const auto subset = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    CHECK(subset.getNumSites() == 0ul);
+    CHECK(subset.getNumIndividuals() == 50ul);
+  }
+}
+
+TEST_CASE("BedMatrixType: cached site statistics", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto decoded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  CHECK(decoded.hasSiteStatistics());
+
+  const mat_uint8_t& data = decoded.getData();
+  const rvec_ul_t expectedHets = (data.array() == static_cast<uint8_t>(1)).colwise().count().cast<unsigned long>();
+  CHECK(decoded.getHeterozygousCounts() == expectedHets);
+
+  for (auto storage : {BedStorage::MemoryMapped, BedStorage::Packed}) {
+    for (bool cacheSiteStatistics : {false, true}) {
+      BedLoadOptions options;
+      options.storage = storage;
+      options.cacheSiteStatistics = cacheSiteStatistics;
+      options.numThreads = 3ul;
+      const auto other = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+
+      CHECK(other.hasSiteStatistics() == cacheSiteStatistics);
+      CHECK(other.getMissingCounts() == decoded.getMissingCounts());
+      CHECK(other.getDerivedAlleleCounts() == decoded.getDerivedAlleleCounts());
+      CHECK(other.getHeterozygousCounts() == expectedHets);
+      CHECK(other.getMinorAlleleFrequencies() == decoded.getMinorAlleleFrequencies());
+      for (unsigned long i = 0ul; i < other.getNumSites(); ++i) {
+        CHECK(other.getHeterozygousCount(i) == expectedHets(static_cast<index_t>(i)));
+        CHECK(other.getMissingCount(i) == decoded.getMissingCount(i));
+      }
+    }
+  }
+}
+
+TEST_CASE("BedMatrixType: individual-major .bed file", "[BedMatrixType]") {
+
+  // The same genotypes as real_example.bed, stored one individual per row with mode byte 0x00
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/individual_major.bed";
+  std::string snpMajorBedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto snpMajor = BedMatrixType::createFromBedBimFam(snpMajorBedFile, bimFile, famFile);
+
+  for (unsigned long numThreads : {1ul, 3ul}) {
+    BedLoadOptions options;
+    options.numThreads = numThreads;
+    const auto decoded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    CHECK(decoded.getData() == snpMajor.getData());
+    CHECK(decoded.getMissingCounts() == snpMajor.getMissingCounts());
+    CHECK(decoded.getDerivedAlleleCounts() == snpMajor.getDerivedAlleleCounts());
+
+    options.storage = BedStorage::Packed;
+    options.keepIndividualIds = {"per2", "per41"};
+    options.extractSiteIds = {"null_0", "null_23", "null_99"};
+    const auto packed = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    REQUIRE(packed.getNumSites() == 3ul);
+    REQUIRE(packed.getNumIndividuals() == 2ul);
+    for (unsigned long i = 0ul; i < 3ul; ++i) {
+      const index_t fileSiteId = std::array<index_t, 3>{0l, 23l, 99l}[i];
+      CHECK(packed.getSite(i)(0) == snpMajor.getData()(2l, fileSiteId));
+      CHECK(packed.getSite(i)(1) == snpMajor.getData()(41l, fileSiteId));
+    }
+  }
+
+  BedLoadOptions options;
+  options.storage = BedStorage::MemoryMapped;
+  CHECK_THROWS_WITH(BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options),
+                    Catch::Contains("use BedStorage::Packed instead"));
+}
+
+TEST_CASE("BedMatrixType: invalid .bed header", "[BedMatrixType]") {
+
+  // A .bim file has neither the magic bytes nor the mode byte of a .bed file
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  for (auto storage : {BedStorage::Decoded, BedStorage::MemoryMapped, BedStorage::Packed}) {
+    BedLoadOptions options;
+    options.storage = storage;
+    CHECK_THROWS_WITH(BedMatrixType::createFromBedBimFam(bimFile, bimFile, famFile, options),
+                      Catch::Contains("to start with the magic bytes of a SNP-major or individual-major .bed file"));
+  }
+}
+
+TEST_CASE("BedMatrixType: export into caller-provided matrices", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto decoded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  const mat_dbl_t raw = decoded.getData().cast<double>();
+  const auto missing = (decoded.getData().array() == static_cast<uint8_t>(3)).eval();
+
+  // Reference standardisation computed column by column
+  mat_dbl_t expected(raw.rows(), raw.cols());
+  for (index_t j = 0; j < raw.cols(); ++j) {
+    const double mean = missing.col(j).select(0.0, raw.col(j)).sum() / static_cast<double>((!missing.col(j)).count());
+    // Monomorphic sites are left unscaled
+    const double variance = mean * (1.0 - 0.5 * mean);
+    const double sd = variance > 0.0 ? std::sqrt(variance) : 1.0;
+    expected.col(j) = (missing.col(j).select(mean, raw.col(j)).array() - mean) / sd;
+  }
+
+  for (auto storage : {BedStorage::Decoded, BedStorage::Packed}) {
+    BedLoadOptions loadOptions;
+    loadOptions.storage = storage;
+    const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, loadOptions);
+
+    // Without options, missing data is NaN and other genotypes are unchanged
+    mat_dbl_t out(50l, 100l);
+    bedMatrix.exportData(out);
+    CHECK(out.array().isNaN().matrix() == missing.matrix());
+    CHECK(missing.select(0.0, out).matrix() == missing.select(0.0, raw).matrix());
+
+    // Imputed, centred and scaled in a single pass, into a block of a larger matrix
+    mat_float_t larger = mat_float_t::Constant(60l, 110l, -100.f);
+    GenotypeExportOptions options;
+    options.impute = true;
+    options.centre = true;
+    options.scale = true;
+    bedMatrix.exportData(larger.block(5l, 5l, 50l, 100l), options, 3ul);
+    CHECK(larger.block(5l, 5l, 50l, 100l).cast<double>().isApprox(expected, 1e-5));
+    CHECK((larger.leftCols(5l).array() == -100.f).all());
+    CHECK((larger.topRows(5l).array() == -100.f).all());
+
+    // int8 output uses -1 for missing data, or the nearest integer to the mean when imputing
+    mat_int8_t ints(50l, 100l);
+    bedMatrix.exportData(ints);
+    CHECK(ints.cast<double>().matrix() == missing.select(-1.0, raw).matrix());
+    CHECK_THROWS_WITH(bedMatrix.exportData(ints, options), Catch::Contains("cannot be exported as int8"));
+
+    mat_float_t wrongSize(50l, 99l);
+    CHECK_THROWS_WITH(bedMatrix.exportData(wrongSize), Catch::Contains("but got 50 x 99"));
+
+    // A range of sites matches the corresponding columns of the whole matrix
+    mat_dbl_t range(50l, 20l);
+    bedMatrix.exportSites(80ul, range, options, 2ul);
+    CHECK(range.isApprox(expected.rightCols(20l), 1e-12));
+    mat_dbl_t tooLong(50l, 21l);
+    CHECK_THROWS_WITH(bedMatrix.exportSites(80ul, tooLong), Catch::Contains("as there are only 100 sites"));
+  }
+}
+
+TEST_CASE("BedMatrixType: individual-major cache", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const mat_uint8_t expected = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile).getData();
+
+  for (auto storage : {BedStorage::Decoded, BedStorage::MemoryMapped, BedStorage::Packed}) {
+    BedLoadOptions options;
+    options.storage = storage;
+    const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    CHECK(!bedMatrix.hasIndividualMajorCache());
+
+    // The first call without an output vector does not build the cache
+    CHECK(bedMatrix.getIndividual(7ul) == expected.row(7l));
+    CHECK(!bedMatrix.hasIndividualMajorCache());
+
+    rvec_uint8_t individual(100l);
+    bedMatrix.getIndividual(7ul, individual);
+    CHECK(bedMatrix.hasIndividualMajorCache());
+    CHECK(individual == expected.row(7l));
+
+    bool allMatch = true;
+    for (unsigned long i = 0ul; i < 50ul; ++i) {
+      bedMatrix.getIndividual(i, individual);
+      allMatch = allMatch && individual == expected.row(static_cast<index_t>(i)) &&
+                 bedMatrix.getIndividual(i) == expected.row(static_cast<index_t>(i));
+    }
+    CHECK(allMatch);
+
+    // 100 sites take 25 bytes, and the codes padding the row to a whole word are zero
+    const uint8_t* packed = bedMatrix.getPackedIndividual(49ul);
+    CHECK(std::all_of(packed + 25, packed + 32, [](uint8_t byte) { return byte == 0u; }));
+
+    rvec_uint8_t wrongSize(99l);
+    CHECK_THROWS_WITH(bedMatrix.getIndividual(0ul, wrongSize), Catch::Contains("but got 99"));
+  }
+
+  // A subset of individuals is transposed from the compacted sites
+  BedLoadOptions subsetOptions;
+  subsetOptions.storage = BedStorage::Packed;
+  subsetOptions.keepIndividualIds = {"per40", "per3", "per17"};
+  const auto subset = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, subsetOptions);
+  subset.cacheIndividualMajor(2ul);
+  CHECK(subset.getIndividual(0ul) == expected.row(3l));
+  CHECK(subset.getIndividual(1ul) == expected.row(17l));
+  CHECK(subset.getIndividual(2ul) == expected.row(40l));
+}
+
+TEST_CASE("BedMatrixType: individual-major cache spanning several blocks", "[BedMatrixType]") {
+
+  // Enough individuals and sites that the transpose is split into several blocks in each direction
+  const unsigned long numIndividuals = 2100ul;
+  const unsigned long numSites = 601ul;
+  mat_uint8_t genotypes(static_cast<index_t>(numIndividuals), static_cast<index_t>(numSites));
+  for (index_t j = 0; j < genotypes.cols(); ++j) {
+    for (index_t i = 0; i < genotypes.rows(); ++i) {
+      genotypes(i, j) = static_cast<uint8_t>((7 * i + 13 * j + i * j) % 4);
+    }
+  }
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_individual_major";
+  fs::create_directories(outDir);
+  const std::string bedFile = (outDir / "large.bed").string();
+  const std::string bimFile = (outDir / "large.bim").string();
+  const std::string famFile = (outDir / "large.fam").string();
+  writeBedFile(bedFile, genotypes);
+  {
+    std::ofstream bim(bimFile);
+    for (unsigned long j = 0ul; j < numSites; ++j) {
+      bim << "1\tsnp" << j << "\t0\t" << j + 1ul << "\tA\tC\n";
+    }
+    std::ofstream fam(famFile);
+    for (unsigned long i = 0ul; i < numIndividuals; ++i) {
+      fam << "fam" << i << " ind" << i << " 0 0 0 -9\n";
+    }
+  }
+
+  for (auto storage : {BedStorage::Decoded, BedStorage::Packed}) {
+    BedLoadOptions options;
+    options.storage = storage;
+    const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+    bedMatrix.cacheIndividualMajor(3ul);
+
+    bool allMatch = true;
+    rvec_uint8_t individual(static_cast<index_t>(numSites));
+    for (unsigned long i = 0ul; i < numIndividuals; ++i) {
+      bedMatrix.getIndividual(i, individual);
+      allMatch = allMatch && individual == genotypes.row(static_cast<index_t>(i));
+    }
+    CHECK(allMatch);
+  }
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("BedMatrixType: write frequencies", "[BedMatrixType]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_frequencies";
+  fs::create_directories(outDir);
+  const std::string frqFile = (outDir / "out.frq").string();
+  bedMatrix.writeFrequencies(frqFile);
+
+  std::vector<std::string> lines;
+  {
+    std::ifstream frq(frqFile);
+    for (std::string line; std::getline(frq, line);) {
+      lines.push_back(line);
+    }
+  }
+  REQUIRE(lines.size() == 101ul);
+  CHECK(lines.front() == " CHR           SNP   A1   A2          MAF  NCHROBS");
+
+  // The minor allele is reported as A1, using the allele codes from the .bim file
+  bool allMatch = true;
+  for (unsigned long siteId = 0ul; siteId < 100ul; ++siteId) {
+    const unsigned long numObserved = 50ul - bedMatrix.getMissingCount(siteId);
+    const bool secondIsMinor = bedMatrix.getDerivedAlleleCount(siteId) < numObserved;
+    const auto& bim = bedMatrix.getBim();
+    const std::string expected =
+        fmt::format("{:>4}{:>14}{:>5}{:>5}{:>13.4g}{:>9}", "1", fmt::format("null_{}", siteId),
+                    secondIsMinor ? bim.getAllele2()[siteId] : bim.getAllele1()[siteId],
+                    secondIsMinor ? bim.getAllele1()[siteId] : bim.getAllele2()[siteId],
+                    bedMatrix.getMinorAlleleFrequency(siteId), 2ul * numObserved);
+    allMatch = allMatch && lines[siteId + 1ul] == expected;
+  }
+  CHECK(allMatch);
+
+  // Compressed output holds the same text, whatever the number of threads
+  for (unsigned long numThreads : {1ul, 3ul}) {
+    const std::string frqGzFile = (outDir / "out.frq.gz").string();
+    bedMatrix.writeFrequencies(frqGzFile, numThreads);
+    gzFile gz = gzopen(frqGzFile.c_str(), "r");
+    std::vector<std::string> gzLines;
+    while (!gzeof(gz)) {
+      gzLines.push_back(readNextLineFromGzip(gz));
+    }
+    gzclose(gz);
+    if (!gzLines.empty() && gzLines.back().empty()) {
+      gzLines.pop_back();
+    }
+    CHECK(gzLines == lines);
+  }
+
+  CHECK_THROWS_WITH(bedMatrix.writeFrequencies((outDir / "missing_dir" / "out.frq").string()),
+                    Catch::Contains("for writing"));
+
+  fs::remove_all(outDir);
+}
+
 } // namespace asmc
@@ -0,0 +1,77 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedMatrixType.hpp"
+#include "BedWriter.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+namespace {
+
+std::vector<char> readBytes(const fs::path& file) {
+  std::ifstream stream(file, std::ios::binary);
+  return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+TEST_CASE("BedWriter: round trip of a real example", "[BedWriter]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bed_writer";
+  fs::create_directories(outDir);
+  const std::string outBed = (outDir / "out.bed").string();
+  const std::string outBim = (outDir / "out.bim").string();
+  const std::string outFam = (outDir / "out.fam").string();
+
+  // Writing a whole fileset reproduces the input files exactly, from every storage mode
+  for (auto storage : {BedStorage::Decoded, BedStorage::MemoryMapped, BedStorage::Packed}) {
+    for (unsigned long numThreads : {1ul, 4ul}) {
+      BedLoadOptions options;
+      options.storage = storage;
+      const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, options);
+      bedMatrix.writeBedBimFam(outBed, outBim, outFam, numThreads);
+
+      CHECK(readBytes(outBed) == readBytes(bedFile));
+      CHECK(readBytes(outBim) == readBytes(bimFile));
+      CHECK(readBytes(outFam) == readBytes(famFile));
+    }
+  }
+
+  // Writing a block of the decoded matrix with subset metadata gives a fileset that loads as that block
+  const auto full = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  const std::vector<unsigned long> siteIds = {10ul, 11ul, 12ul, 13ul, 14ul};
+  const std::vector<unsigned long> individualIds = {5ul, 6ul, 7ul, 8ul, 9ul, 10ul, 11ul};
+  writeBedBimFam(outBed, outBim, outFam, full.getData().block(5l, 10l, 7l, 5l), full.getBim().subset(siteIds),
+                 full.getFam().subset(individualIds), 2ul);
+
+  const auto subset = BedMatrixType::createFromBedBimFam(outBed, outBim, outFam);
+  CHECK(subset.getData() == full.getData().block(5l, 10l, 7l, 5l));
+  CHECK(subset.getSiteNames() == std::vector<std::string>{"null_10", "null_11", "null_12", "null_13", "null_14"});
+  CHECK(subset.getIndividualIds().front() == "per5");
+
+  // Metadata must match the data
+  CHECK_THROWS_WITH(writeBedBimFam(outBed, outBim, outFam, full.getData(), full.getBim().subset(siteIds),
+                                   full.getFam()),
+                    Catch::Contains("as the metadata describes 50 individuals and 5 sites"));
+
+  // Only genotype values 0 to 3 can be written
+  mat_uint8_t invalid = mat_uint8_t::Zero(3l, 2l);
+  invalid(2l, 1l) = 4u;
+  CHECK_THROWS_WITH(writeBedFile(outBed, invalid), Catch::Contains("but found 4"));
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
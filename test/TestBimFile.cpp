@@ -0,0 +1,139 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BimFile.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/MetadataCache.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("BimFile: test exceptions", "[BimFile]") {
+
+  std::string nonexistentFile = DATA_MODULE_TEST_DIR "/does/not/exist.bim";
+  CHECK_THROWS_WITH(BimFile(nonexistentFile), Catch::StartsWith("Error: .bim file"));
+  CHECK_THROWS_WITH(BimFile(nonexistentFile), Catch::EndsWith("does not exist\n"));
+
+  std::string fiveCols = DATA_MODULE_TEST_DIR "/data/bedbimfam/five_cols.bim";
+  CHECK_THROWS_WITH(BimFile(fiveCols), Catch::Contains("line 2 contains 5 columns, but should contain 6"));
+
+  std::string badPosition = DATA_MODULE_TEST_DIR "/data/bedbimfam/bad_position.bim";
+  CHECK_THROWS_WITH(BimFile(badPosition), Catch::Contains("line 2 should contain a floating point genetic position"));
+}
+
+TEST_CASE("BimFile: test real example", "[BimFile]") {
+
+  BimFile bim(DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim");
+
+  CHECK(bim.getNumSites() == 100ul);
+  CHECK(bim.getChrIds().at(0ul) == "1");
+  CHECK(bim.getSnpIds().at(67ul) == "null_67");
+  CHECK(bim.getGeneticPositions().at(67ul) == 0.0);
+  CHECK(bim.getPhysicalPositions().at(67ul) == 68ul);
+  CHECK(bim.getAllele1().at(67ul) == "D");
+  CHECK(bim.getAllele2().at(67ul) == "d");
+
+  const BimFile subset = bim.subset({99ul, 0ul, 67ul});
+  CHECK(subset.getNumSites() == 3ul);
+  CHECK(subset.getSnpIds().toVector() == std::vector<std::string>{"null_99", "null_0", "null_67"});
+  CHECK(subset.getPhysicalPositions() == std::vector<unsigned long>{100ul, 1ul, 68ul});
+  CHECK(subset.getChrIds() == std::vector<std::string>{"1", "1", "1"});
+  CHECK(subset.getAllele2().toVector() == std::vector<std::string>{"d", "D", "d"});
+}
+
+TEST_CASE("BimFile: chromosome codes and compressed files", "[BimFile]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bim";
+  fs::create_directories(outDir);
+
+  // Chromosomes are coded in order of first appearance, and blank lines and carriage returns are ignored
+  const std::string text = "chr2\trs1\t0.5\t+100\tA\tG\r\n"
+                           "\n"
+                           "chr2\trs2\t1e-2\t200\tACGT\tC\n"
+                           "X\trs3\t-1.25\t300\tT\tTA\n"
+                           "chr2\trs4\t0\t400\tG\tC";
+  const std::string plainFile = (outDir / "plain.bim").string();
+  std::ofstream(plainFile, std::ios::binary) << text;
+
+  std::vector<char> compressed;
+  compressGzipMember(text.data(), text.size(), compressed);
+  const std::string gzFile = (outDir / "compressed.bim.gz").string();
+  std::ofstream(gzFile, std::ios::binary).write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+
+  for (const std::string& file : {plainFile, gzFile}) {
+    const BimFile bim(file);
+    CHECK(bim.getNumSites() == 4ul);
+    CHECK(bim.getChrNames() == std::vector<std::string>{"chr2", "X"});
+    CHECK(bim.getChrCodes() == std::vector<uint16_t>{0u, 0u, 1u, 0u});
+    CHECK(bim.getChrIds() == std::vector<std::string>{"chr2", "chr2", "X", "chr2"});
+    CHECK(bim.getChrId(2ul) == "X");
+    CHECK(bim.getSnpIds().toVector() == std::vector<std::string>{"rs1", "rs2", "rs3", "rs4"});
+    CHECK(bim.getGeneticPositions() == std::vector<double>{0.5, 0.01, -1.25, 0.0});
+    CHECK(bim.getPhysicalPositions() == std::vector<unsigned long>{100ul, 200ul, 300ul, 400ul});
+    CHECK(bim.getAllele1().at(1ul) == "ACGT");
+    CHECK(bim.getAllele2().back() == "C");
+
+    // A subset only keeps the chromosomes of its sites
+    const BimFile subset = bim.subset({2ul});
+    CHECK(subset.getChrNames() == std::vector<std::string>{"X"});
+    CHECK(subset.getChrCodes() == std::vector<uint16_t>{0u});
+  }
+
+  // Trailing characters after a number are rejected
+  const std::string badFile = (outDir / "bad.bim").string();
+  std::ofstream(badFile) << "1\trs1\t0\t100\tA\tG\n1\trs2\t0\t200bp\tA\tG\n";
+  CHECK_THROWS_WITH(BimFile(badFile), Catch::Contains("line 2 should contain a floating point genetic position"));
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("BimFile: metadata cache", "[BimFile]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bim_cache";
+  fs::remove_all(outDir);
+  fs::create_directories(outDir);
+  const fs::path bimFile = outDir / "real_example.bim";
+  fs::copy_file(DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim", bimFile);
+
+  // The first load parses the text and writes the sidecar, which the second load reads instead
+  const BimFile parsed(bimFile.string(), true);
+  REQUIRE(fs::is_regular_file(metadataCachePath(bimFile)));
+  const BimFile cached(bimFile.string(), true);
+  CHECK(cached.getNumSites() == 100ul);
+  CHECK(cached.getChrIds() == parsed.getChrIds());
+  CHECK(cached.getSnpIds().toVector() == parsed.getSnpIds().toVector());
+  CHECK(cached.getGeneticPositions() == parsed.getGeneticPositions());
+  CHECK(cached.getPhysicalPositions() == parsed.getPhysicalPositions());
+  CHECK(cached.getAllele1().toVector() == parsed.getAllele1().toVector());
+  CHECK(cached.getAllele2().toVector() == parsed.getAllele2().toVector());
+
+  // The sidecar is trusted while its file keeps the same size and modification time, so an edit that keeps both is
+  // only seen when the text is parsed
+  {
+    const auto modified = fs::last_write_time(bimFile);
+    std::stringstream text;
+    text << std::ifstream(bimFile).rdbuf();
+    std::string edited = text.str();
+    edited.replace(edited.find("null_67"), 7ul, "edit_67");
+    std::ofstream(bimFile) << edited;
+    fs::last_write_time(bimFile, modified);
+  }
+  CHECK(BimFile(bimFile.string(), true).getSnpIds().at(67ul) == "null_67");
+  CHECK(BimFile(bimFile.string()).getSnpIds().at(67ul) == "edit_67");
+
+  // A sidecar that no longer matches its file is replaced
+  std::ofstream(bimFile, std::ios::app) << "2\textra\t0\t200\tA\tC\n";
+  CHECK(BimFile(bimFile.string(), true).getNumSites() == 101ul);
+  CHECK(BimFile(bimFile.string(), true).getChrNames() == std::vector<std::string>{"1", "2"});
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
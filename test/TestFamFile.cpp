@@ -0,0 +1,126 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "FamFile.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/MetadataCache.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("FamFile: test exceptions", "[FamFile]") {
+
+  std::string nonexistentFile = DATA_MODULE_TEST_DIR "/does/not/exist.fam";
+  CHECK_THROWS_WITH(FamFile(nonexistentFile), Catch::StartsWith("Error: .fam file"));
+  CHECK_THROWS_WITH(FamFile(nonexistentFile), Catch::EndsWith("does not exist\n"));
+
+  // Neither a space nor a tab splits the first line into six columns
+  std::string threeCols = DATA_MODULE_TEST_DIR "/data/plink_map/3_col.map";
+  CHECK_THROWS_WITH(FamFile(threeCols), Catch::Contains("Could not determine delimiter"));
+
+  // The first line contains six tab-separated columns, but the second line contains five
+  std::string fiveCols = DATA_MODULE_TEST_DIR "/data/bedbimfam/five_cols.bim";
+  CHECK_THROWS_WITH(FamFile(fiveCols), Catch::Contains("line 2 contains 5 columns, but should contain 6"));
+}
+
+TEST_CASE("FamFile: test delimiters", "[FamFile]") {
+
+  FamFile spaces(DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam");
+  CHECK(spaces.getDelimiter() == " ");
+  CHECK(spaces.getNumIndividuals() == 50ul);
+  CHECK(spaces.getFamilyIds().at(49ul) == "per49");
+  CHECK(spaces.getIndividualIds().at(49ul) == "per49");
+
+  FamFile tabs(DATA_MODULE_TEST_DIR "/data/bedbimfam/tabs.fam");
+  CHECK(tabs.getDelimiter() == "\t");
+  CHECK(tabs.getFamilyIds().toVector() == std::vector<std::string>{"fam0", "fam1"});
+  CHECK(tabs.getIndividualIds().toVector() == std::vector<std::string>{"per0", "per1"});
+  CHECK(tabs.getPaternalIds().toVector() == std::vector<std::string>{"0", "0"});
+  CHECK(tabs.getMaternalIds().toVector() == std::vector<std::string>{"0", "0"});
+  CHECK(tabs.getSexCodes() == std::vector<uint8_t>{2u, 1u});
+  CHECK(tabs.getPhenotypes().toVector() == std::vector<std::string>{"1", "-9"});
+
+  const FamFile subset = spaces.subset({10ul, 3ul});
+  CHECK(subset.getNumIndividuals() == 2ul);
+  CHECK(subset.getIndividualIds().toVector() == std::vector<std::string>{"per10", "per3"});
+  CHECK(subset.getDelimiter() == " ");
+}
+
+TEST_CASE("FamFile: single pass over compressed and irregular files", "[FamFile]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_fam";
+  fs::create_directories(outDir);
+
+  // Leading blank lines do not prevent the delimiter being found, and unusual sex codes are read as unknown
+  const std::string text = "\n"
+                           "f1\ti1\t0\t0\t1\t-9\r\n"
+                           "f1\ti2\ti1\t0\tF\t2.5\n"
+                           "f2\ti3\t0\t0\t2\t1";
+  std::vector<char> compressed;
+  compressGzipMember(text.data(), text.size(), compressed);
+  const std::string gzFile = (outDir / "compressed.fam.gz").string();
+  std::ofstream(gzFile, std::ios::binary).write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+
+  const FamFile fam(gzFile);
+  CHECK(fam.getDelimiter() == "\t");
+  CHECK(fam.getNumIndividuals() == 3ul);
+  CHECK(fam.getFamilyIds().toVector() == std::vector<std::string>{"f1", "f1", "f2"});
+  CHECK(fam.getIndividualIds().back() == "i3");
+  CHECK(fam.getPaternalIds().at(1ul) == "i1");
+  CHECK(fam.getSexCodes() == std::vector<uint8_t>{1u, 0u, 2u});
+  CHECK(fam.getPhenotypes().toVector() == std::vector<std::string>{"-9", "2.5", "1"});
+
+  // Written files use the detected delimiter
+  const std::string written = (outDir / "written.fam").string();
+  fam.write(written);
+  std::ifstream in(written);
+  std::string line;
+  std::getline(in, line);
+  CHECK(line == "f1\ti1\t0\t0\t1\t-9");
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("FamFile: metadata cache", "[FamFile]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_fam_cache";
+  fs::remove_all(outDir);
+  fs::create_directories(outDir);
+  const fs::path famFile = outDir / "tabs.fam";
+  fs::copy_file(DATA_MODULE_TEST_DIR "/data/bedbimfam/tabs.fam", famFile);
+
+  const FamFile parsed(famFile.string(), true);
+  REQUIRE(fs::is_regular_file(metadataCachePath(famFile)));
+  const FamFile cached(famFile.string(), true);
+  CHECK(cached.getDelimiter() == "\t");
+  CHECK(cached.getFamilyIds().toVector() == parsed.getFamilyIds().toVector());
+  CHECK(cached.getIndividualIds().toVector() == parsed.getIndividualIds().toVector());
+  CHECK(cached.getSexCodes() == parsed.getSexCodes());
+  CHECK(cached.getPhenotypes().toVector() == parsed.getPhenotypes().toVector());
+
+  // The sidecar is trusted while its file keeps the same size and modification time, so an edit that keeps both is
+  // only seen when the text is parsed
+  {
+    const auto modified = fs::last_write_time(famFile);
+    std::stringstream text;
+    text << std::ifstream(famFile).rdbuf();
+    std::string edited = text.str();
+    edited.replace(edited.find("per1"), 4ul, "perX");
+    std::ofstream(famFile) << edited;
+    fs::last_write_time(famFile, modified);
+  }
+  CHECK(FamFile(famFile.string(), true).getIndividualIds().at(1ul) == "per1");
+  CHECK(FamFile(famFile.string()).getIndividualIds().at(1ul) == "perX");
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
@@ -2,10 +2,13 @@
 // See accompanying LICENSE and COPYING for copyright notice and full details.
 
 #include "GeneticMap.hpp"
+#include "utils/MetadataCache.hpp"
 
 #include <catch2/catch.hpp>
 
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -132,4 +135,46 @@ TEST_CASE("GeneticMap: warn on Mbp-cM range", "[GeneticMap]") {
   std::cout.rdbuf(old);
 }
 
+TEST_CASE("GeneticMap: metadata cache", "[GeneticMap]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_genetic_map_cache";
+  fs::remove_all(outDir);
+  fs::create_directories(outDir);
+  const fs::path mapFile = outDir / "4_col_header.map";
+  fs::copy_file(DATA_MODULE_TEST_DIR "/data/genetic_map/4_col_header.map", mapFile);
+
+  // The first load parses the text and writes the sidecar, which the second load reads instead
+  const GeneticMap parsed(mapFile.string(), true);
+  REQUIRE(fs::is_regular_file(metadataCachePath(mapFile)));
+  const GeneticMap cached(mapFile.string(), true);
+  CHECK(cached.getNumSites() == 5ul);
+  CHECK(cached.getNumCols() == parsed.getNumCols());
+  CHECK(cached.hasHeader() == parsed.hasHeader());
+  CHECK(cached.getGeneticPositions() == parsed.getGeneticPositions());
+  CHECK(cached.getPhysicalPositions() == parsed.getPhysicalPositions());
+
+  // The sidecar is trusted while its file keeps the same size and modification time, so an edit that keeps both is
+  // only seen when the text is parsed
+  {
+    const auto modified = fs::last_write_time(mapFile);
+    std::stringstream text;
+    text << std::ifstream(mapFile).rdbuf();
+    std::string edited = text.str();
+    edited.replace(edited.find("0.0877781"), 9ul, "0.0877782");
+    std::ofstream(mapFile) << edited;
+    fs::last_write_time(mapFile, modified);
+  }
+  CHECK(GeneticMap(mapFile.string(), true).getGeneticPositions().at(1ul) == 0.0877781);
+  CHECK(GeneticMap(mapFile.string()).getGeneticPositions().at(1ul) == 0.0877782);
+
+  // A sidecar that no longer matches its file is replaced
+  std::ofstream(mapFile, std::ios::app) << "\n140400\t0.0286994674\t0.0878200\t1.65e-8\n";
+  const GeneticMap extended(mapFile.string(), true);
+  CHECK(extended.getNumSites() == 6ul);
+  CHECK(extended.getPhysicalPositions().back() == 140400ul);
+  CHECK(GeneticMap(mapFile.string(), true).getGeneticPositions() == extended.getGeneticPositions());
+
+  fs::remove_all(outDir);
+}
+
 } // namespace asmc
@@ -0,0 +1,106 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedMatrixType.hpp"
+#include "GeneticRelationshipMatrix.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("GeneticRelationshipMatrix: real example", "[GeneticRelationshipMatrix]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+
+  // Reference matrix computed from the whole standardised genotype matrix, skipping monomorphic sites
+  const mat_dbl_t raw = bedMatrix.getDataAsFloat().cast<double>();
+  mat_dbl_t standardised = mat_dbl_t::Zero(raw.rows(), raw.cols());
+  unsigned long numPolymorphic = 0ul;
+  for (index_t j = 0; j < raw.cols(); ++j) {
+    const auto observed = (!raw.col(j).array().isNaN()).eval();
+    const double mean = observed.select(raw.col(j).array(), 0.0).sum() / static_cast<double>(observed.count());
+    const double variance = mean * (1.0 - 0.5 * mean);
+    if (variance > 0.0) {
+      ++numPolymorphic;
+      standardised.col(j) = (observed.select(raw.col(j).array(), mean) - mean).matrix() / std::sqrt(variance);
+    }
+  }
+  const mat_dbl_t expected = standardised * standardised.transpose() / static_cast<double>(numPolymorphic);
+
+  for (unsigned long blockSize : {1ul, 7ul, 100ul, 1024ul}) {
+    for (unsigned long numThreads : {1ul, 3ul, 64ul}) {
+      const auto grm = GeneticRelationshipMatrix::createFromBedMatrix(bedMatrix, blockSize, numThreads);
+      CHECK(grm.getNumIndividuals() == 50ul);
+      CHECK(grm.getNumSites() == numPolymorphic);
+      CHECK(grm.getMatrix().cast<double>().isApprox(expected, 1e-5));
+      CHECK(grm.getMatrix() == grm.getMatrix().transpose());
+    }
+  }
+
+  // Packed storage gives the same matrix as decoded storage
+  BedLoadOptions packedOptions;
+  packedOptions.storage = BedStorage::Packed;
+  const auto packed = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, packedOptions);
+  CHECK(GeneticRelationshipMatrix::createFromBedMatrix(packed, 16ul, 2ul).getMatrix().cast<double>().isApprox(expected,
+                                                                                                               1e-5));
+
+  CHECK_THROWS_WITH(GeneticRelationshipMatrix::createFromBedMatrix(bedMatrix, 0ul),
+                    Catch::Contains("block size of at least one site"));
+}
+
+TEST_CASE("GeneticRelationshipMatrix: write binary files", "[GeneticRelationshipMatrix]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto grm = GeneticRelationshipMatrix::createFromBedMatrix(
+      BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile), 32ul, 2ul);
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_grm";
+  fs::create_directories(outDir);
+  const std::string prefix = (outDir / "out").string();
+  grm.writeBinary(prefix);
+
+  // The lower triangle, row by row, including the diagonal
+  const unsigned long numEntries = 50ul * 51ul / 2ul;
+  std::vector<float> values(numEntries);
+  std::ifstream grmBin(prefix + ".grm.bin", std::ios::binary);
+  grmBin.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(numEntries * sizeof(float)));
+  CHECK(grmBin.gcount() == static_cast<std::streamsize>(numEntries * sizeof(float)));
+  CHECK(grmBin.peek() == std::char_traits<char>::eof());
+
+  unsigned long entry = 0ul;
+  bool allMatch = true;
+  for (index_t i = 0; i < 50; ++i) {
+    for (index_t j = 0; j <= i; ++j) {
+      allMatch = allMatch && values[entry++] == grm.getMatrix()(i, j);
+    }
+  }
+  CHECK(allMatch);
+
+  std::vector<float> counts(numEntries);
+  std::ifstream grmNBin(prefix + ".grm.N.bin", std::ios::binary);
+  grmNBin.read(reinterpret_cast<char*>(counts.data()), static_cast<std::streamsize>(numEntries * sizeof(float)));
+  CHECK(counts.front() == static_cast<float>(grm.getNumSites()));
+  CHECK(counts.back() == static_cast<float>(grm.getNumSites()));
+
+  std::ifstream grmId(prefix + ".grm.id");
+  std::string line;
+  std::getline(grmId, line);
+  CHECK(line == "per0\tper0");
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
@@ -0,0 +1,89 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "HapsBlockReader.hpp"
+#include "HapsMatrixType.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("HapsBlockReader: test exceptions", "[HapsBlockReader]") {
+
+  std::string hapsFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/test.hap";
+  std::string samplesFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/test.samples";
+  std::string mapFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/test.map";
+
+  CHECK_THROWS_WITH(HapsBlockReader(hapsFile, samplesFile, mapFile, 0ul), Catch::Contains("must be at least 1"));
+  CHECK_THROWS_WITH(HapsBlockReader(DATA_MODULE_TEST_DIR "/does/not/exist.haps", samplesFile, mapFile, 2ul),
+                    Catch::StartsWith("Expected .hap[s][.gz] file, but got "));
+
+  // Invalid rows are reported as they are reached, with the same messages as HapsMatrixType
+  std::string notBoolean = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/not_boolean.hap";
+  HapsBlockReader notBooleanReader(notBoolean, samplesFile, mapFile, 1ul);
+  CHECK_THROWS_WITH(
+      [&notBooleanReader]() {
+        while (notBooleanReader.nextBlock()) {
+        }
+      }(),
+      Catch::Contains("but column 9 was \"invalid\""));
+
+  std::string tooFewRows = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/too_few_rows.hap";
+  HapsBlockReader tooFewReader(tooFewRows, samplesFile, mapFile, 10ul);
+  CHECK_THROWS_WITH(tooFewReader.nextBlock(), Catch::StartsWith("Error on line 3 of"));
+
+  std::string tooManyRows = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/too_many_rows.hap";
+  HapsBlockReader tooManyReader(tooManyRows, samplesFile, mapFile, 10ul);
+  CHECK_THROWS_WITH(tooManyReader.nextBlock(), Catch::Contains("to contain 4 lines, but found 5"));
+}
+
+TEST_CASE("HapsBlockReader: blocks match the full matrix", "[HapsBlockReader]") {
+
+  std::string hapsFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.haps.gz";
+  std::string samplesFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.sample.gz";
+  std::string mapFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.map.gz";
+
+  const auto full = HapsMatrixType::createFromHapsPlusSamples(hapsFile, samplesFile, mapFile);
+  const mat_uint8_t data = full.getData();
+
+  for (unsigned long blockSize : {1ul, 7ul, 102ul, 1000ul}) {
+    HapsBlockReader reader(hapsFile, samplesFile, mapFile, blockSize);
+    CHECK(reader.getNumSites() == 102ul);
+    CHECK(reader.getNumIndividuals() == 50ul);
+    CHECK(reader.getNumHaps() == 100ul);
+    CHECK(reader.getBlockSize() == 0ul);
+
+    // Read the files twice to check reset()
+    for (int pass = 0; pass < 2; ++pass) {
+      unsigned long numSitesRead = 0ul;
+      unsigned long numMismatches = 0ul;
+      while (reader.nextBlock()) {
+        const auto start = static_cast<index_t>(reader.getBlockStart());
+        const auto size = static_cast<index_t>(reader.getBlockSize());
+        CHECK(reader.getBlockStart() == numSitesRead);
+        CHECK(reader.getBlockData() == data.middleRows(start, size));
+        CHECK(reader.getBlockGeneticPositions().size() == reader.getBlockSize());
+
+        for (unsigned long i = 0ul; i < reader.getBlockSize(); ++i) {
+          const unsigned long siteId = numSitesRead + i;
+          const bool matches = reader.getAlleleCount(i) == full.getDerivedAlleleCount(siteId) &&
+                               reader.getPackedSite(i)[0] == full.getPackedData().getSiteWords(siteId)[0] &&
+                               reader.getBlockGeneticPositions()[i] == full.getGeneticPositions()[siteId] &&
+                               reader.getBlockPhysicalPositions()[i] == full.getPhysicalPositions()[siteId];
+          numMismatches += matches ? 0ul : 1ul;
+        }
+        numSitesRead += reader.getBlockSize();
+      }
+      CHECK(numSitesRead == 102ul);
+      CHECK(numMismatches == 0ul);
+      CHECK(reader.getBlockSize() == 0ul);
+      CHECK(reader.getBlockGeneticPositions().empty());
+      reader.reset();
+    }
+  }
+}
+
+} // namespace asmc
@@ -6,10 +6,15 @@
 #include <catch2/catch.hpp>
 
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <string>
+#include <vector>
 
 #include <fmt/core.h>
 #include <fmt/ostream.h>
+#include <fmt/ranges.h>
 
 namespace asmc {
 
@@ -116,6 +121,76 @@ TEST_CASE("HapsMatrixType: test readHapsFile", "[HapsMatrixType]") {
                     Catch::Contains("but column 9 was \"invalid\""));
 }
 
+TEST_CASE("HapsMatrixType: parallel parsing of large files", "[HapsMatrixType]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_haps_parallel";
+  fs::create_directories(outDir);
+
+  // About 20MB of haps, which is read as several chunks of whole lines
+  const unsigned long numIndividuals = 500ul;
+  const unsigned long numSites = 10000ul;
+  std::mt19937 rng(7u);
+  std::bernoulli_distribution coin(0.3);
+
+  {
+    std::ofstream samples(outDir / "large.samples");
+    samples << "ID_1 ID_2 missing\n0 0 0\n";
+    for (unsigned long individualId = 0ul; individualId < numIndividuals; ++individualId) {
+      samples << fmt::format("id{0} id{0} 0\n", individualId);
+    }
+  }
+  std::vector<std::string> lines(numSites);
+  std::vector<unsigned long> expectedCounts(numSites, 0ul);
+  {
+    std::ofstream map(outDir / "large.map");
+    for (unsigned long siteId = 0ul; siteId < numSites; ++siteId) {
+      map << fmt::format("1\tsnp{}\t{}\t{}\n", siteId, 0.001 * static_cast<double>(siteId), 100ul * (siteId + 1ul));
+      lines[siteId] = fmt::format("1 snp{} {} A G", siteId, 100ul * (siteId + 1ul));
+      for (unsigned long hapId = 0ul; hapId < 2ul * numIndividuals; ++hapId) {
+        const bool allele = coin(rng);
+        lines[siteId] += allele ? " 1" : " 0";
+        expectedCounts[siteId] += allele ? 1ul : 0ul;
+      }
+    }
+  }
+  auto writeHaps = [&outDir, &lines](const std::string& name, const std::vector<std::string>& extraLines) {
+    std::ofstream haps(outDir / name);
+    haps << fmt::format("{}\n", fmt::join(lines, "\n"));
+    for (const auto& line : extraLines) {
+      haps << line << '\n';
+    }
+    return (outDir / name).string();
+  };
+
+  const std::string samplesFile = (outDir / "large.samples").string();
+  const std::string mapFile = (outDir / "large.map").string();
+  const std::string goodHaps = writeHaps("good.haps", {"", ""});
+  for (unsigned long numThreads : {1ul, 4ul, 0ul}) {
+    const auto hapsMatrix = HapsMatrixType::createFromHapsPlusSamples(goodHaps, samplesFile, mapFile, numThreads);
+    CHECK(hapsMatrix.getNumSites() == numSites);
+    CHECK(hapsMatrix.getNumHaps() == 2ul * numIndividuals);
+    unsigned long numMismatches = 0ul;
+    for (unsigned long siteId = 0ul; siteId < numSites; ++siteId) {
+      numMismatches += hapsMatrix.getDerivedAlleleCount(siteId) == expectedCounts[siteId] ? 0ul : 1ul;
+    }
+    CHECK(numMismatches == 0ul);
+  }
+
+  // The first error in the file is reported, whichever chunk finishes first
+  const std::string extraHaps = writeHaps("extra.haps", {"", "1 extra 1 A G", "", "1 extra 2 A G"});
+  lines[2999].back() = '2';
+  lines[8999] += " 0";
+  const std::string badHaps = writeHaps("bad.haps", {});
+  for (unsigned long numThreads : {1ul, 4ul}) {
+    CHECK_THROWS_WITH(HapsMatrixType::createFromHapsPlusSamples(badHaps, samplesFile, mapFile, numThreads),
+                      Catch::StartsWith("Error on line 3000 of") && Catch::Contains("column 1005 was \"2\""));
+    CHECK_THROWS_WITH(HapsMatrixType::createFromHapsPlusSamples(extraHaps, samplesFile, mapFile, numThreads),
+                      Catch::Contains("to contain 10000 lines, but found 10002"));
+  }
+
+  fs::remove_all(outDir);
+}
+
 TEST_CASE("HapsMatrixType: test (small) real example", "[HapsMatrixType]") {
 
   std::string hapsFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.haps.gz";
@@ -124,6 +199,7 @@ TEST_CASE("HapsMatrixType: test (small) real example", "[HapsMatrixType]") {
 
   auto hapsMatrix = HapsMatrixType::createFromHapsPlusSamples(hapsFile, samplesFile, mapFile);
   CHECK(hapsMatrix.getData().rows() == static_cast<index_t>(102l));
+
   CHECK(hapsMatrix.getData().cols() == static_cast<index_t>(100l));
   CHECK(hapsMatrix.getNumSites() == 102ul);
   CHECK(hapsMatrix.getNumIndividuals() == 50ul);
@@ -198,6 +274,14 @@ TEST_CASE("HapsMatrixType: test (small) real example", "[HapsMatrixType]") {
       CHECK(derivedAlleleFrequencies(static_cast<index_t>(i)) == Approx(hapsMatrix.getDerivedAlleleFrequency(i)));
     }
   }
+
+  // The number of threads does not change what is loaded
+  for (unsigned long numThreads : {1ul, 4ul}) {
+    const auto threaded = HapsMatrixType::createFromHapsPlusSamples(hapsFile, samplesFile, mapFile, numThreads);
+    CHECK(threaded.getData() == hapsMatrix.getData());
+    CHECK(threaded.getPhysicalPositions() == hapsMatrix.getPhysicalPositions());
+    CHECK(threaded.getGeneticPositions() == hapsMatrix.getGeneticPositions());
+  }
 }
 
 } // namespace asmc
@@ -0,0 +1,199 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "BedMatrixType.hpp"
+#include "HapsMatrixType.hpp"
+#include "LdMatrix.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+
+namespace asmc {
+
+namespace {
+
+/**
+ * Compute r^2 and D' directly from two vectors of values, skipping any sample where either value is missing.
+ */
+std::pair<double, double> directLd(const Eigen::VectorXd& a, const Eigen::VectorXd& b, double ploidy,
+                                   double missing) {
+  double n = 0.0;
+  double sumA = 0.0;
+  double sumB = 0.0;
+  double sumAA = 0.0;
+  double sumBB = 0.0;
+  double sumAB = 0.0;
+  for (index_t i = 0; i < a.size(); ++i) {
+    if (a[i] != missing && b[i] != missing) {
+      n += 1.0;
+      sumA += a[i];
+      sumB += b[i];
+      sumAA += a[i] * a[i];
+      sumBB += b[i] * b[i];
+      sumAB += a[i] * b[i];
+    }
+  }
+  const double cov = sumAB / n - (sumA / n) * (sumB / n);
+  const double varA = sumAA / n - (sumA / n) * (sumA / n);
+  const double varB = sumBB / n - (sumB / n) * (sumB / n);
+  const double pA = sumA / (n * ploidy);
+  const double pB = sumB / (n * ploidy);
+  const double d = cov / ploidy;
+  const double dMax = d < 0.0 ? std::min(pA * pB, (1.0 - pA) * (1.0 - pB)) : std::min(pA * (1.0 - pB), (1.0 - pA) * pB);
+  return {cov * cov / (varA * varB), std::clamp(d / dMax, -1.0, 1.0)};
+}
+
+/**
+ * Check a stored statistic against a directly computed one, where both may be NaN.
+ */
+bool statisticMatches(float stored, double expected) {
+  return std::isnan(expected) ? std::isnan(stored) : std::abs(static_cast<double>(stored) - expected) < 1e-5;
+}
+
+} // namespace
+
+TEST_CASE("LdMatrix: BED genotypes", "[LdMatrix]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  const auto decoded = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile);
+  const Eigen::MatrixXd genotypes = decoded.getData().cast<double>();
+
+  for (auto storage : {BedStorage::Decoded, BedStorage::MemoryMapped, BedStorage::Packed}) {
+    for (unsigned long numThreads : {1ul, 3ul}) {
+      BedLoadOptions loadOptions;
+      loadOptions.storage = storage;
+      const auto bedMatrix = BedMatrixType::createFromBedBimFam(bedFile, bimFile, famFile, loadOptions);
+
+      LdOptions options;
+      options.windowSize = 10.0;
+      options.numThreads = numThreads;
+      const auto ld = LdMatrix::createFromBedMatrix(bedMatrix, options);
+
+      // Each site is paired with the following 10 sites, or as many as remain
+      CHECK(ld.getNumSites() == 100ul);
+      CHECK(ld.getNumPairs() == 90ul * 10ul + 45ul);
+      CHECK(ld.getRowOffsets().size() == 101ul);
+
+      unsigned long numMismatches = 0ul;
+      for (unsigned long a = 0ul; a < 100ul; ++a) {
+        for (unsigned long b = a + 1ul; b <= std::min(a + 10ul, 99ul); ++b) {
+          const auto [r2, dPrime] = directLd(genotypes.col(static_cast<index_t>(a)),
+                                             genotypes.col(static_cast<index_t>(b)), 2.0, 3.0);
+          const bool matches = statisticMatches(ld.getR2(a, b), r2) && statisticMatches(ld.getDPrime(b, a), dPrime);
+          numMismatches += matches ? 0ul : 1ul;
+        }
+      }
+      CHECK(numMismatches == 0ul);
+      CHECK(!ld.hasPair(0ul, 11ul));
+      CHECK(!ld.hasPair(5ul, 5ul));
+      CHECK_THROWS_WITH(ld.getR2(0ul, 11ul), Catch::Contains("LD between sites 0 and 11 is not stored"));
+    }
+  }
+
+  // Sites are 1bp apart, so a window of 10bp holds the same pairs as a window of 10 sites
+  LdOptions bpOptions;
+  bpOptions.windowUnit = LdWindowUnit::BasePairs;
+  bpOptions.windowSize = 10.0;
+  const auto bpLd = LdMatrix::createFromBedMatrix(decoded, bpOptions);
+  LdOptions siteOptions;
+  siteOptions.windowSize = 10.0;
+  CHECK(bpLd.getColumnIds() == LdMatrix::createFromBedMatrix(decoded, siteOptions).getColumnIds());
+
+  // Only pairs above the threshold are kept
+  LdOptions filterOptions;
+  filterOptions.minR2 = 0.2;
+  const auto full = LdMatrix::createFromBedMatrix(decoded);
+  const auto filtered = LdMatrix::createFromBedMatrix(decoded, filterOptions);
+  CHECK(filtered.getNumPairs() > 0ul);
+  CHECK(filtered.getNumPairs() == static_cast<unsigned long>(std::count_if(
+                                      full.getR2Values().begin(), full.getR2Values().end(),
+                                      [](float r2) { return r2 >= 0.2f; })));
+  CHECK(std::all_of(filtered.getR2Values().begin(), filtered.getR2Values().end(), [](float r2) { return r2 >= 0.2f; }));
+
+  LdOptions badOptions;
+  badOptions.windowSize = -1.0;
+  CHECK_THROWS_WITH(LdMatrix::createFromBedMatrix(decoded, badOptions), Catch::Contains("non-negative LD window size"));
+}
+
+TEST_CASE("LdMatrix: windows do not cross chromosomes", "[LdMatrix]") {
+
+  std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string bimFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bim";
+  std::string famFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.fam";
+
+  // Move the second half of the sites to chromosome 2
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_ld";
+  fs::create_directories(outDir);
+  const std::string twoChrBim = (outDir / "two_chr.bim").string();
+  {
+    std::ifstream in(bimFile);
+    std::ofstream out(twoChrBim);
+    std::string line;
+    for (unsigned long siteId = 0ul; std::getline(in, line); ++siteId) {
+      out << (siteId < 50ul ? "1" : "2") << line.substr(line.find('\t')) << '\n';
+    }
+  }
+
+  const auto ld = LdMatrix::createFromBedMatrix(BedMatrixType::createFromBedBimFam(bedFile, twoChrBim, famFile));
+  CHECK(ld.hasPair(40ul, 49ul));
+  CHECK(!ld.hasPair(49ul, 50ul));
+  CHECK(ld.hasPair(50ul, 99ul));
+  CHECK(ld.getNumPairs() == 2ul * (50ul * 49ul / 2ul));
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("LdMatrix: phased haplotypes", "[LdMatrix]") {
+
+  std::string hapsFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.haps.gz";
+  std::string samplesFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.sample.gz";
+  std::string mapFile = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/real_example.map.gz";
+
+  const auto hapsMatrix = HapsMatrixType::createFromHapsPlusSamples(hapsFile, samplesFile, mapFile);
+  const Eigen::MatrixXd haps = hapsMatrix.getData().cast<double>();
+  const unsigned long numSites = hapsMatrix.getNumSites();
+
+  for (auto unit : {LdWindowUnit::Sites, LdWindowUnit::BasePairs, LdWindowUnit::Centimorgans}) {
+    LdOptions options;
+    options.windowUnit = unit;
+    options.windowSize = unit == LdWindowUnit::Sites ? 20.0 : unit == LdWindowUnit::BasePairs ? 20000.0 : 0.02;
+    options.numThreads = 2ul;
+    const auto ld = LdMatrix::createFromHapsMatrix(hapsMatrix, options);
+
+    unsigned long numPairs = 0ul;
+    unsigned long numMismatches = 0ul;
+    for (unsigned long a = 0ul; a < numSites; ++a) {
+      for (unsigned long b = a + 1ul; b < numSites; ++b) {
+        double distance = static_cast<double>(b - a);
+        if (unit == LdWindowUnit::BasePairs) {
+          distance = static_cast<double>(hapsMatrix.getPhysicalPositions()[b] - hapsMatrix.getPhysicalPositions()[a]);
+        } else if (unit == LdWindowUnit::Centimorgans) {
+          distance = hapsMatrix.getGeneticPositions()[b] - hapsMatrix.getGeneticPositions()[a];
+        }
+        if (distance > options.windowSize) {
+          numMismatches += ld.hasPair(a, b) ? 1ul : 0ul;
+          continue;
+        }
+        ++numPairs;
+        const auto [r2, dPrime] = directLd(haps.row(static_cast<index_t>(a)).transpose(),
+                                           haps.row(static_cast<index_t>(b)).transpose(), 1.0, -1.0);
+        const bool matches = statisticMatches(ld.getR2(a, b), r2) && statisticMatches(ld.getDPrime(a, b), dPrime);
+        numMismatches += matches ? 0ul : 1ul;
+      }
+    }
+    CHECK(numPairs > 0ul);
+    CHECK(ld.getNumPairs() == numPairs);
+    CHECK(numMismatches == 0ul);
+  }
+}
+
+} // namespace asmc
@@ -0,0 +1,57 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "PackedGenotypeMatrix.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace asmc {
+
+TEST_CASE("PackedGenotypeMatrix: test construction", "[PackedGenotypeMatrix]") {
+
+  PackedGenotypeMatrix empty;
+  CHECK(empty.getNumIndividuals() == 0ul);
+  CHECK(empty.getNumSites() == 0ul);
+  CHECK(empty.getSizeInBytes() == 0ul);
+
+  // 33 individuals need two 64-bit words per site
+  PackedGenotypeMatrix packed(33ul, 5ul);
+  CHECK(packed.getNumIndividuals() == 33ul);
+  CHECK(packed.getNumSites() == 5ul);
+  CHECK(packed.getWordsPerSite() == 2ul);
+  CHECK(packed.getSizeInBytes() == 5ul * 2ul * 8ul);
+
+  // Sites start on word boundaries
+  CHECK(packed.getSiteWords(1ul) - packed.getSiteWords(0ul) == 2l);
+  for (unsigned long i = 0ul; i < packed.getNumIndividuals(); ++i) {
+    CHECK(packed.getGenotype(i, 4ul) == 0u);
+  }
+}
+
+TEST_CASE("PackedGenotypeMatrix: test setSite", "[PackedGenotypeMatrix]") {
+
+  // 6 individuals: codes 00, 01, 10, 11 in the first byte, then 10, 11 and two padding codes in the second
+  PackedGenotypeMatrix packed(6ul, 2ul);
+  const std::array<uint8_t, 2> row = {0b11100100, 0b11111110};
+  packed.setSite(1ul, row.data());
+
+  CHECK(packed.getGenotype(0ul, 1ul) == 0u);
+  CHECK(packed.getGenotype(1ul, 1ul) == 3u);
+  CHECK(packed.getGenotype(2ul, 1ul) == 1u);
+  CHECK(packed.getGenotype(3ul, 1ul) == 2u);
+  CHECK(packed.getGenotype(4ul, 1ul) == 1u);
+  CHECK(packed.getGenotype(5ul, 1ul) == 2u);
+
+  // Padding bits beyond the last individual are cleared
+  CHECK(packed.getSiteBytes(1ul)[0] == static_cast<uint8_t>(0b11100100));
+  CHECK(packed.getSiteBytes(1ul)[1] == static_cast<uint8_t>(0b00001110));
+  CHECK(packed.getSiteWords(1ul)[0] == 0b0000111011100100ull);
+
+  // Other sites are untouched
+  CHECK(packed.getSiteWords(0ul)[0] == 0ull);
+}
+
+} // namespace asmc
@@ -0,0 +1,61 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "PackedHaplotypeMatrix.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("PackedHaplotypeMatrix: test construction", "[PackedHaplotypeMatrix]") {
+
+  PackedHaplotypeMatrix empty;
+  CHECK(empty.getNumHaps() == 0ul);
+  CHECK(empty.getNumSites() == 0ul);
+  CHECK(empty.getSizeInBytes() == 0ul);
+
+  // 65 haplotypes need two 64-bit words per site
+  PackedHaplotypeMatrix packed(65ul, 3ul);
+  CHECK(packed.getNumHaps() == 65ul);
+  CHECK(packed.getNumSites() == 3ul);
+  CHECK(packed.getWordsPerSite() == 2ul);
+  CHECK(packed.getSizeInBytes() == 3ul * 2ul * 8ul);
+  CHECK(packed.getSiteWords(1ul) - packed.getSiteWords(0ul) == 2l);
+  CHECK(packed.getAlleleCount(2ul) == 0ul);
+}
+
+TEST_CASE("PackedHaplotypeMatrix: test setSite and unpacking", "[PackedHaplotypeMatrix]") {
+
+  // Haplotypes 0, 3 and 64 carry allele 1, and the bits beyond haplotype 65 are padding
+  PackedHaplotypeMatrix packed(66ul, 2ul);
+  const std::array<uint64_t, 2> words = {0b1001ull, 0xF1ull};
+  packed.setSite(1ul, words.data());
+
+  CHECK(packed.getSiteWords(1ul)[0] == 0b1001ull);
+  CHECK(packed.getSiteWords(1ul)[1] == 0b01ull);
+  CHECK(packed.getAlleleCount(1ul) == 3ul);
+  CHECK(packed.getAllele(0ul, 1ul) == 1u);
+  CHECK(packed.getAllele(1ul, 1ul) == 0u);
+  CHECK(packed.getAllele(64ul, 1ul) == 1u);
+  CHECK(packed.getAllele(65ul, 1ul) == 0u);
+  CHECK(packed.getAlleleCount(0ul) == 0ul);
+
+  std::vector<uint8_t> unpacked(66ul, 7u);
+  packed.unpackSite(1ul, unpacked.data());
+  std::vector<uint8_t> expected(66ul, 0u);
+  expected[0] = expected[3] = expected[64] = 1u;
+  CHECK(unpacked == expected);
+
+  // With a stride, alleles are written to every other byte
+  std::vector<uint8_t> strided(132ul, 7u);
+  packed.unpackSite(1ul, strided.data(), 2);
+  CHECK(strided[6] == 1u);
+  CHECK(strided[7] == 7u);
+  CHECK(strided[130] == 0u);
+}
+
+} // namespace asmc
@@ -2,10 +2,13 @@
 // See accompanying LICENSE and COPYING for copyright notice and full details.
 
 #include "PlinkMap.hpp"
+#include "utils/MetadataCache.hpp"
 
 #include <catch2/catch.hpp>
 
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -104,4 +107,39 @@ TEST_CASE("PlinkMap: warn on Mbp-cM range", "[PlinkMap]") {
   std::cout.rdbuf(old);
 }
 
+TEST_CASE("PlinkMap: metadata cache", "[PlinkMap]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_plink_map_cache";
+  fs::remove_all(outDir);
+  fs::create_directories(outDir);
+  const fs::path mapFile = outDir / "4_col.map";
+  fs::copy_file(DATA_MODULE_TEST_DIR "/data/plink_map/4_col.map", mapFile);
+
+  const PlinkMap parsed(mapFile.string(), true);
+  REQUIRE(fs::is_regular_file(metadataCachePath(mapFile)));
+  const PlinkMap cached(mapFile.string(), true);
+  CHECK(cached.getNumSites() == 3ul);
+  CHECK(cached.getNumCols() == 4ul);
+  CHECK(cached.getChrIds() == parsed.getChrIds());
+  CHECK(cached.getSnpIds() == parsed.getSnpIds());
+  CHECK(cached.getGeneticPositions() == parsed.getGeneticPositions());
+  CHECK(cached.getPhysicalPositions() == parsed.getPhysicalPositions());
+
+  // The sidecar is trusted while its file keeps the same size and modification time, so an edit that keeps both is
+  // only seen when the text is parsed
+  {
+    const auto modified = fs::last_write_time(mapFile);
+    std::stringstream text;
+    text << std::ifstream(mapFile).rdbuf();
+    std::string edited = text.str();
+    edited.replace(edited.find("SNP_29993696"), 12ul, "SNP_EDITED00");
+    std::ofstream(mapFile) << edited;
+    fs::last_write_time(mapFile, modified);
+  }
+  CHECK(PlinkMap(mapFile.string(), true).getSnpIds().at(1ul) == "SNP_29993696_97083");
+  CHECK(PlinkMap(mapFile.string()).getSnpIds().at(1ul) == "SNP_EDITED00_97083");
+
+  fs::remove_all(outDir);
+}
+
 } // namespace asmc
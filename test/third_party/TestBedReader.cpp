@@ -0,0 +1,82 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+extern "C" {
+#include "third_party/pandas_plink/bed_reader.h"
+}
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+namespace {
+
+uint8_t referenceDecode(const std::vector<uint8_t>& row, uint64_t col) {
+  const std::array<uint8_t, 4> codeToGenotype = {0, 3, 1, 2};
+  return codeToGenotype[static_cast<unsigned>(row[col / 4ul] >> (2ul * (col % 4ul))) & 3u];
+}
+
+} // namespace
+
+TEST_CASE("third_party/bed_reader: test decode_bed_row", "[third_party/bed_reader]") {
+
+  // Every possible byte value, repeated so that rows are long enough to exercise the vectorised paths
+  std::vector<uint8_t> row(1031ul);
+  for (std::size_t i = 0ul; i < row.size(); ++i) {
+    row[i] = static_cast<uint8_t>((i * 7ul) % 256ul);
+  }
+  const uint64_t numCols = 4ul * row.size() - 3ul;
+
+  SECTION("Contiguous output") {
+    for (uint64_t colStart : {0ul, 1ul, 2ul, 3ul, 4ul, 129ul}) {
+      for (uint64_t colEnd : {colStart, colStart + 1ul, colStart + 5ul, numCols - 2ul, numCols}) {
+        std::vector<uint8_t> out(colEnd - colStart, 255u);
+        decode_bed_row(row.data(), colStart, colEnd, out.data(), 1ul);
+        bool allMatch = true;
+        for (uint64_t c = colStart; c < colEnd; ++c) {
+          allMatch = allMatch && out[c - colStart] == referenceDecode(row, c);
+        }
+        CHECK(allMatch);
+      }
+    }
+  }
+
+  SECTION("Strided output") {
+    const uint64_t stride = 3ul;
+    for (uint64_t colStart : {0ul, 3ul}) {
+      std::vector<uint8_t> out(stride * (numCols - colStart), 255u);
+      decode_bed_row(row.data(), colStart, numCols, out.data(), stride);
+      bool allMatch = true;
+      for (uint64_t c = colStart; c < numCols; ++c) {
+        allMatch = allMatch && out[stride * (c - colStart)] == referenceDecode(row, c);
+        allMatch = allMatch && out[stride * (c - colStart) + 1ul] == 255u;
+      }
+      CHECK(allMatch);
+    }
+  }
+}
+
+TEST_CASE("third_party/bed_reader: test read_bed_chunk", "[third_party/bed_reader]") {
+
+  // 100 sites (rows) of 50 individuals (columns)
+  std::string snpMajor = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  std::string individualMajor = DATA_MODULE_TEST_DIR "/data/bedbimfam/individual_major.bed";
+
+  std::vector<uint8_t> out(100ul * 50ul, 255u);
+  std::array<uint64_t, 2> strides = {50ul, 1ul};
+
+  CHECK(read_bed_chunk(snpMajor.data(), 100ul, 50ul, 0ul, 0ul, 100ul, 50ul, out.data(), strides.data()) == 0);
+  CHECK(out.at(0ul) == 2u);
+  CHECK(out.at(41ul) == 3u);
+  CHECK(out.at(43ul) == 1u);
+
+  // Individual-major files are rejected rather than misread
+  CHECK(read_bed_chunk(individualMajor.data(), 100ul, 50ul, 0ul, 0ul, 100ul, 50ul, out.data(), strides.data()) == -1);
+}
+
+} // namespace asmc
@@ -0,0 +1,190 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/BedUtils.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("BedUtils: getBedCode", "[BedUtils]") {
+
+  // Codes 0, 1, 2, 3 in the first byte, and 3, 2 in the second
+  const std::vector<uint8_t> row = {0b11100100, 0b00001011};
+
+  CHECK(getBedCode(row.data(), 0ul) == 0u);
+  CHECK(getBedCode(row.data(), 1ul) == 1u);
+  CHECK(getBedCode(row.data(), 2ul) == 2u);
+  CHECK(getBedCode(row.data(), 3ul) == 3u);
+  CHECK(getBedCode(row.data(), 4ul) == 3u);
+  CHECK(getBedCode(row.data(), 5ul) == 2u);
+
+  CHECK(bedCodeToGenotype[getBedCode(row.data(), 1ul)] == 3u);
+  CHECK(bedCodeToGenotype[getBedCode(row.data(), 3ul)] == 2u);
+}
+
+TEST_CASE("BedUtils: subsetBedRow", "[BedUtils]") {
+
+  const std::vector<uint8_t> row = {0b11100100, 0b00001011};
+
+  SECTION("Identity subset") {
+    std::vector<uint8_t> out(2ul, 0xff);
+    subsetBedRow(row.data(), {0ul, 1ul, 2ul, 3ul, 4ul, 5ul}, out.data());
+    CHECK(out == row);
+  }
+
+  SECTION("Reordered subset with a partial final byte") {
+    std::vector<uint8_t> out(2ul, 0xff);
+    subsetBedRow(row.data(), {5ul, 4ul, 3ul, 2ul, 1ul}, out.data());
+    CHECK(out.at(0ul) == 0b10111110);
+    CHECK(out.at(1ul) == 0b00000001);
+  }
+
+  SECTION("Empty subset writes nothing") {
+    std::vector<uint8_t> out(1ul, 0xff);
+    subsetBedRow(row.data(), {}, out.data());
+    CHECK(out.at(0ul) == 0xff);
+  }
+}
+
+TEST_CASE("BedUtils: popcount64", "[BedUtils]") {
+  CHECK(popcount64(0ull) == 0ul);
+  CHECK(popcount64(1ull) == 1ul);
+  CHECK(popcount64(0x8000000000000001ull) == 2ul);
+  CHECK(popcount64(0x5555555555555555ull) == 32ul);
+  CHECK(popcount64(~0ull) == 64ul);
+
+  // A kernel counts the same whether or not it runs with the hardware popcnt instruction
+  std::mt19937_64 rng(3u);
+  std::vector<uint64_t> words(100ul);
+  unsigned long expected = 0ul;
+  for (uint64_t& word : words) {
+    word = rng();
+    for (unsigned bit = 0u; bit < 64u; ++bit) {
+      expected += (word >> bit) & 1ull;
+    }
+  }
+  const unsigned long counted = withHardwarePopcount([&words] {
+    unsigned long count = 0ul;
+    for (const uint64_t word : words) {
+      count += popcount64(word);
+    }
+    return count;
+  });
+  CHECK(counted == expected);
+}
+
+TEST_CASE("BedUtils: countBedRow matches decoded counts", "[BedUtils]") {
+
+  std::mt19937 rng(42u);
+  std::uniform_int_distribution<unsigned> byteDist(0u, 255u);
+
+  for (unsigned long numIndividuals : {0ul, 1ul, 3ul, 4ul, 31ul, 32ul, 33ul, 64ul, 100ul, 257ul}) {
+    // Random bytes, including random bits beyond the last individual which must be ignored
+    std::vector<uint8_t> row((numIndividuals + 3ul) / 4ul);
+    for (auto& byte : row) {
+      byte = static_cast<uint8_t>(byteDist(rng));
+    }
+
+    BedSiteCounts expected;
+    for (unsigned long i = 0ul; i < numIndividuals; ++i) {
+      const unsigned code = getBedCode(row.data(), i);
+      expected.numMissing += code == 1u ? 1ul : 0ul;
+      expected.numHeterozygous += code == 2u ? 1ul : 0ul;
+      expected.numHomozygousSecond += code == 3u ? 1ul : 0ul;
+    }
+
+    const BedSiteCounts counts = countBedRow(row.data(), numIndividuals);
+    CHECK(counts.numMissing == expected.numMissing);
+    CHECK(counts.numHeterozygous == expected.numHeterozygous);
+    CHECK(counts.numHomozygousSecond == expected.numHomozygousSecond);
+    CHECK(counts.getAlleleCount() == expected.numHeterozygous + 2ul * expected.numHomozygousSecond);
+  }
+}
+
+TEST_CASE("BedUtils: transposeBedTile", "[BedUtils]") {
+
+  std::mt19937_64 rng(7u);
+  std::array<uint64_t, 32> tile = {};
+  for (auto& word : tile) {
+    word = rng();
+  }
+
+  const std::array<uint64_t, 32> original = tile;
+  transposeBedTile(tile);
+  for (unsigned long i = 0ul; i < 32ul; ++i) {
+    for (unsigned long j = 0ul; j < 32ul; ++j) {
+      CHECK(((tile[j] >> (2ul * i)) & 3ull) == ((original[i] >> (2ul * j)) & 3ull));
+    }
+  }
+
+  transposeBedTile(tile);
+  CHECK(tile == original);
+}
+
+TEST_CASE("BedUtils: transposeIndividualMajorBed", "[BedUtils]") {
+
+  const unsigned long numIndividuals = 70ul;
+  const unsigned long numSites = 301ul;
+  const unsigned long bytesPerIndividual = (numSites + 3ul) / 4ul;
+  const unsigned long outBytesPerSite = 8ul * ((numIndividuals + 31ul) / 32ul);
+
+  std::mt19937 rng(3u);
+  std::uniform_int_distribution<unsigned> byteDist(0u, 255u);
+  std::vector<uint8_t> genotypes(numIndividuals * bytesPerIndividual);
+  for (auto& byte : genotypes) {
+    byte = static_cast<uint8_t>(byteDist(rng));
+  }
+
+  for (unsigned long firstSite : {0ul, 32ul, 256ul}) {
+    const unsigned long blockSites = std::min(256ul, numSites - firstSite);
+    std::vector<uint8_t> out(blockSites * outBytesPerSite);
+    transposeIndividualMajorBed(genotypes.data(), bytesPerIndividual, numIndividuals, firstSite, blockSites,
+                                out.data(), outBytesPerSite);
+
+    bool allMatch = true;
+    for (unsigned long j = 0ul; j < blockSites; ++j) {
+      for (unsigned long i = 0ul; i < numIndividuals; ++i) {
+        allMatch = allMatch && getBedCode(out.data() + j * outBytesPerSite, i) ==
+                                   getBedCode(genotypes.data() + i * bytesPerIndividual, firstSite + j);
+      }
+    }
+    CHECK(allMatch);
+  }
+}
+
+TEST_CASE("BedUtils: encodeBedRow inverts decoding", "[BedUtils]") {
+
+  std::mt19937 rng(11u);
+  std::uniform_int_distribution<unsigned> byteDist(0u, 255u);
+
+  for (unsigned long numIndividuals : {0ul, 1ul, 4ul, 5ul, 50ul}) {
+    std::vector<uint8_t> row((numIndividuals + 3ul) / 4ul);
+    for (auto& byte : row) {
+      byte = static_cast<uint8_t>(byteDist(rng));
+    }
+    if (numIndividuals % 4ul != 0ul) {
+      row.back() = static_cast<uint8_t>(row.back() & ((1u << (2ul * (numIndividuals % 4ul))) - 1u));
+    }
+
+    std::vector<uint8_t> genotypes(numIndividuals);
+    for (unsigned long i = 0ul; i < numIndividuals; ++i) {
+      genotypes[i] = bedCodeToGenotype[getBedCode(row.data(), i)];
+    }
+
+    std::vector<uint8_t> encoded(row.size(), 0xff);
+    encodeBedRow(genotypes.data(), numIndividuals, encoded.data());
+    CHECK(encoded == row);
+  }
+
+  const std::vector<uint8_t> invalid = {0u, 1u, 7u};
+  std::vector<uint8_t> out(1ul);
+  CHECK_THROWS_WITH(encodeBedRow(invalid.data(), 3ul, out.data()), Catch::Contains("but found 7"));
+}
+
+} // namespace asmc
@@ -0,0 +1,220 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "HapsMatrixType.hpp"
+#include "utils/BgzfReader.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/LineReader.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+namespace asmc {
+
+namespace {
+
+/**
+ * Write text to a BGZF file in blocks of at most blockSize decompressed bytes, followed by the empty end-of-file block
+ * that bgzip writes.
+ */
+void writeBgzfFile(const fs::path& filePath, std::string_view text, std::size_t blockSize) {
+  std::ofstream out(filePath, std::ios::binary);
+  auto writeLittleEndian = [&out](unsigned long value, unsigned long numBytes) {
+    for (unsigned long i = 0ul; i < numBytes; ++i) {
+      out.put(static_cast<char>((value >> (8ul * i)) & 0xfful));
+    }
+  };
+
+  auto writeBlock = [&](std::string_view block) {
+    std::vector<Bytef> compressed(compressBound(static_cast<uLong>(block.size())) + 16ul);
+    z_stream stream{};
+    deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data()));
+    stream.avail_in = static_cast<uInt>(block.size());
+    stream.next_out = compressed.data();
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    deflate(&stream, Z_FINISH);
+    const auto compressedSize = static_cast<unsigned long>(stream.total_out);
+    deflateEnd(&stream);
+
+    // gzip header with the FEXTRA flag, and a "BC" (66, 67) subfield holding the total block size minus one
+    for (const int byte : {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 66, 67, 2, 0}) {
+      out.put(static_cast<char>(byte));
+    }
+    writeLittleEndian(compressedSize + 25ul, 2ul);
+    out.write(reinterpret_cast<const char*>(compressed.data()), static_cast<std::streamsize>(compressedSize));
+    writeLittleEndian(crc32(0ul, reinterpret_cast<const Bytef*>(block.data()), static_cast<uInt>(block.size())), 4ul);
+    writeLittleEndian(static_cast<unsigned long>(block.size()), 4ul);
+  };
+
+  for (std::size_t start = 0ul; start < text.size(); start += blockSize) {
+    writeBlock(text.substr(start, blockSize));
+  }
+  writeBlock({});
+}
+
+} // namespace
+
+TEST_CASE("utils/BgzfReader: detect and read BGZF files", "[utils/BgzfReader]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bgzf";
+  fs::create_directories(outDir);
+
+  std::string text;
+  for (unsigned long i = 0ul; i < 5000ul; ++i) {
+    text += "line " + std::to_string(i) + (i % 7ul == 0ul ? " \r\n" : "\n");
+  }
+
+  const fs::path bgzfFile = outDir / "text.txt.gz";
+  writeBgzfFile(bgzfFile, text, 1000ul);
+
+  std::vector<char> compressed;
+  compressGzipMember(text.data(), text.size(), compressed);
+  const fs::path gzFile = outDir / "plain.txt.gz";
+  std::ofstream(gzFile, std::ios::binary).write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+
+  const fs::path plainFile = outDir / "plain.txt";
+  std::ofstream(plainFile, std::ios::binary) << text;
+
+  CHECK(isBgzfFile(bgzfFile));
+  CHECK(!isBgzfFile(gzFile));
+  CHECK(!isBgzfFile(plainFile));
+  CHECK(!isBgzfFile(outDir / "does_not_exist.txt.gz"));
+
+  for (unsigned long numThreads : {1ul, 3ul}) {
+    BgzfReader reader(bgzfFile, numThreads);
+    CHECK(reader.getNumBlocks() == (text.size() + 999ul) / 1000ul + 1ul);
+    CHECK(reader.getDecompressedSize() == text.size());
+
+    // Reads of an awkward size span block boundaries
+    std::string decompressed;
+    std::vector<char> piece(777ul);
+    while (const std::size_t numRead = reader.read(piece.data(), piece.size())) {
+      decompressed.append(piece.data(), numRead);
+    }
+    CHECK(decompressed == text);
+    CHECK(reader.read(piece.data(), piece.size()) == 0ul);
+  }
+
+  // The line-oriented readers give the same result as for the plain and gzipped files
+  for (unsigned long numThreads : {1ul, 3ul}) {
+    const std::vector<char> contents = readDecompressedFile(bgzfFile, numThreads);
+    CHECK(std::string(contents.begin(), contents.end()) == text);
+
+    std::string passed;
+    withFileContents(bgzfFile, [&passed](std::string_view view) { passed = view; }, numThreads);
+    CHECK(passed == text);
+  }
+  CHECK(countLinesInFile(bgzfFile) == 5000ul);
+
+  for (const fs::path& file : {plainFile, gzFile, bgzfFile}) {
+    LineReader reader(file, 100ul, 2ul);
+    std::string_view line;
+    unsigned long numMatching = 0ul;
+    while (reader.nextLine(line)) {
+      numMatching += line == "line " + std::to_string(reader.getLineNumber() - 1ul) ? 1ul : 0ul;
+    }
+    CHECK(numMatching == 5000ul);
+  }
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("utils/BgzfReader: empty files", "[utils/BgzfReader]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bgzf_empty";
+  fs::create_directories(outDir);
+
+  // An empty file compressed by bgzip holds only the 28-byte end-of-file block
+  const fs::path bgzfFile = outDir / "empty.txt.gz";
+  writeBgzfFile(bgzfFile, "", 1000ul);
+  REQUIRE(fs::file_size(bgzfFile) == 28ul);
+  CHECK(isBgzfFile(bgzfFile));
+
+  BgzfReader reader(bgzfFile);
+  CHECK(reader.getNumBlocks() == 1ul);
+  CHECK(reader.getDecompressedSize() == 0ul);
+  std::vector<char> piece(100ul);
+  CHECK(reader.read(piece.data(), piece.size()) == 0ul);
+
+  CHECK(readDecompressedFile(bgzfFile).empty());
+  CHECK(countLinesInFile(bgzfFile) == 0ul);
+  LineReader lineReader(bgzfFile);
+  std::string_view line;
+  CHECK(!lineReader.nextLine(line));
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("utils/BgzfReader: corrupt files", "[utils/BgzfReader]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bgzf_corrupt";
+  fs::create_directories(outDir);
+
+  const std::string text(10000ul, 'a');
+  const fs::path bgzfFile = outDir / "text.txt.gz";
+  writeBgzfFile(bgzfFile, text, 4000ul);
+  std::ifstream in(bgzfFile, std::ios::binary);
+  const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  // A truncated file ends part way through a block
+  const fs::path truncatedFile = outDir / "truncated.txt.gz";
+  std::ofstream(truncatedFile, std::ios::binary) << bytes.substr(0ul, bytes.size() - 3ul);
+  CHECK(isBgzfFile(truncatedFile));
+  CHECK_THROWS_WITH(BgzfReader(truncatedFile), Catch::Contains("to be a BGZF file, but found an invalid block"));
+
+  // Changing the CRC of the first block, which ends 8 bytes before the end of the block
+  std::string corrupt = bytes;
+  const auto firstBlockSize = static_cast<std::size_t>(static_cast<unsigned char>(corrupt[16])) +
+                              256ul * static_cast<unsigned char>(corrupt[17]) + 1ul;
+  corrupt[firstBlockSize - 8ul] = static_cast<char>(corrupt[firstBlockSize - 8ul] ^ 1);
+  const fs::path corruptFile = outDir / "corrupt.txt.gz";
+  std::ofstream(corruptFile, std::ios::binary) << corrupt;
+
+  CHECK_THROWS_WITH(readDecompressedFile(corruptFile), Catch::Contains("BGZF block at byte 18 is corrupt"));
+  BgzfReader reader(corruptFile, 2ul);
+  std::vector<char> piece(100ul);
+  CHECK_THROWS_WITH(reader.read(piece.data(), piece.size()), Catch::Contains("is corrupt"));
+
+  fs::remove_all(outDir);
+}
+
+TEST_CASE("utils/BgzfReader: BGZF haps, sample and map files", "[utils/BgzfReader]") {
+
+  const std::string dataDir = DATA_MODULE_TEST_DIR "/data/haps_plus_samples/";
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_bgzf_haps";
+  fs::create_directories(outDir);
+
+  for (const std::string name : {"real_example.haps.gz", "real_example.sample.gz", "real_example.map.gz"}) {
+    const std::vector<char> contents = readDecompressedFile(dataDir + name);
+    writeBgzfFile(outDir / name, std::string_view(contents.data(), contents.size()), 2000ul);
+    CHECK(isBgzfFile(outDir / name));
+  }
+
+  const auto expected = HapsMatrixType::createFromHapsPlusSamples(
+      dataDir + "real_example.haps.gz", dataDir + "real_example.sample.gz", dataDir + "real_example.map.gz");
+  const std::string outPrefix = (outDir / "real_example").string();
+  for (unsigned long numThreads : {1ul, 4ul}) {
+    const auto bgzf = HapsMatrixType::createFromHapsPlusSamples(outPrefix + ".haps.gz", outPrefix + ".sample.gz",
+                                                                outPrefix + ".map.gz", numThreads);
+
+    CHECK(bgzf.getNumIndividuals() == expected.getNumIndividuals());
+    CHECK(bgzf.getPhysicalPositions() == expected.getPhysicalPositions());
+    CHECK(bgzf.getGeneticPositions() == expected.getGeneticPositions());
+    CHECK(bgzf.getData() == expected.getData());
+  }
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
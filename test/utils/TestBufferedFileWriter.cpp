@@ -0,0 +1,40 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/BufferedFileWriter.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace asmc {
+
+TEST_CASE("utils/BufferedFileWriter: write text and bytes", "[utils/BufferedFileWriter]") {
+
+  const fs::path outFile = fs::temp_directory_path() / "data_module_test_buffered_file_writer.txt";
+
+  {
+    BufferedFileWriter writer(outFile.string());
+    fmt::format_to(std::back_inserter(writer.buffer()), "{} {}\n", "abc", 12);
+    writer.flushIfFull();
+    writer.write("xyz", 3ul);
+    fmt::format_to(std::back_inserter(writer.buffer()), "{:.2f}", 1.5);
+    writer.close();
+    CHECK_THROWS_WITH(writer.write("a", 1ul), Catch::Contains("after it has been closed"));
+  }
+
+  std::ifstream stream(outFile);
+  const std::string contents{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+  CHECK(contents == "abc 12\nxyz1.50");
+
+  stream.close();
+  fs::remove(outFile);
+
+  CHECK_THROWS_WITH(BufferedFileWriter(DATA_MODULE_TEST_DIR "/does/not/exist.txt"),
+                    Catch::StartsWith("Could not open"));
+}
+
+} // namespace asmc
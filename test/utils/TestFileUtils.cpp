@@ -6,6 +6,7 @@
 #include <catch2/catch.hpp>
 
 #include <filesystem>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -167,4 +168,36 @@ TEST_CASE("utils/FileUtils: countLinesInFile", "[utils/FileUtils]") {
 
 
 
+TEST_CASE("utils/FileUtils: compress concatenated gzip members", "[utils/FileUtils]") {
+
+  const std::string first = "first line\nsecond line\n";
+  const std::string second(100000ul, 'x');
+
+  std::vector<char> firstMember;
+  std::vector<char> secondMember;
+  compressGzipMember(first.data(), first.size(), firstMember);
+  compressGzipMember(second.data(), second.size(), secondMember, 9);
+  CHECK(secondMember.size() < second.size());
+
+  // Concatenated members decompress to the concatenated text
+  const auto fileName = (std::filesystem::temp_directory_path() / "data_module_test_members.gz").string();
+  {
+    std::ofstream out(fileName, std::ios::binary);
+    out.write(firstMember.data(), static_cast<std::streamsize>(firstMember.size()));
+    out.write(secondMember.data(), static_cast<std::streamsize>(secondMember.size()));
+  }
+  const auto lines = readLinesFromGzFile(fileName);
+  REQUIRE(lines.size() == 3ul);
+  CHECK(lines[0] == "first line");
+  CHECK(lines[1] == "second line");
+  CHECK(lines[2] == second);
+
+  // An empty block is still a valid member
+  std::vector<char> emptyMember;
+  compressGzipMember(first.data(), 0ul, emptyMember);
+  CHECK(!emptyMember.empty());
+
+  std::filesystem::remove(fileName);
+}
+
 } // namespace asmc
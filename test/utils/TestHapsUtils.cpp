@@ -0,0 +1,56 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/HapsUtils.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("utils/HapsUtils: packHapsRow", "[utils/HapsUtils]") {
+
+  std::mt19937 rng(42u);
+  std::bernoulli_distribution coin(0.5);
+
+  // Sizes either side of a chunk of 8 alleles and a word of 64
+  for (unsigned long numHaps : {1ul, 7ul, 8ul, 9ul, 63ul, 64ul, 65ul, 200ul}) {
+    std::string line = "1 rs1 12345 A G";
+    std::vector<uint64_t> expected((numHaps + 63ul) / 64ul, 0ull);
+    for (unsigned long hapId = 0ul; hapId < numHaps; ++hapId) {
+      const bool allele = coin(rng);
+      line += allele ? " 1" : " 0";
+      expected[hapId / 64ul] |= static_cast<uint64_t>(allele) << (hapId % 64ul);
+    }
+
+    std::vector<uint64_t> words(expected.size(), ~0ull);
+    CHECK(packHapsRow(line, numHaps, words.data()));
+    CHECK(words == expected);
+
+    // The wrong number of alleles, a bad allele, and a doubled separator at each position
+    CHECK(!packHapsRow(line, numHaps + 1ul, words.data()));
+    CHECK(!packHapsRow(line + " 0", numHaps, words.data()));
+    unsigned long numRejected = 0ul;
+    const std::size_t allelesStart = line.size() - (2ul * numHaps - 1ul);
+    for (std::size_t pos = allelesStart; pos < line.size(); ++pos) {
+      std::string bad = line;
+      bad[pos] = (pos - allelesStart) % 2ul == 0ul ? '2' : '\t';
+      numRejected += packHapsRow(bad, numHaps, words.data()) ? 0ul : 1ul;
+    }
+    CHECK(numRejected == 2ul * numHaps - 1ul);
+  }
+
+  // Too few metadata fields, an empty row, and empty metadata fields, which are allowed
+  std::vector<uint64_t> words(1ul);
+  CHECK(!packHapsRow("1 rs1 12345 A 0 1", 2ul, words.data()));
+  CHECK(!packHapsRow("", 2ul, words.data()));
+  CHECK(packHapsRow("1  12345 A G 1 1", 2ul, words.data()));
+  CHECK(words.front() == 3ull);
+  CHECK(!packHapsRow("1 rs1 12345 A G", 0ul, words.data()));
+}
+
+} // namespace asmc
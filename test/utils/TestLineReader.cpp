@@ -0,0 +1,95 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/FileUtils.hpp"
+#include "utils/LineReader.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("utils/LineReader: read plain and gzipped lines", "[utils/LineReader]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_line_reader";
+  fs::create_directories(outDir);
+
+  // A long line, trailing whitespace, an empty line, and no newline at the end
+  const std::string longLine(1000ul, 'x');
+  const std::string text = "first \r\n" + longLine + "\n\nlast";
+  const std::vector<std::string> expected = {"first", longLine, "", "last"};
+
+  const fs::path plainFile = outDir / "plain.txt";
+  std::ofstream(plainFile, std::ios::binary) << text;
+
+  std::vector<char> compressed;
+  compressGzipMember(text.data(), text.size(), compressed);
+  const fs::path gzFile = outDir / "compressed.txt.gz";
+  std::ofstream(gzFile, std::ios::binary).write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+
+  for (const fs::path& file : {plainFile, gzFile}) {
+    // A small buffer forces lines to span several reads, and the long line to grow the buffer
+    for (std::size_t bufferSize : {1ul, 7ul, LineReader::defaultBufferSize}) {
+      LineReader reader(file, bufferSize);
+      std::vector<std::string> lines;
+      std::string_view line;
+      while (reader.nextLine(line)) {
+        lines.emplace_back(line);
+      }
+      CHECK(lines == expected);
+      CHECK(reader.getLineNumber() == 4ul);
+      CHECK(!reader.nextLine(line));
+    }
+  }
+
+  // Pieces of whole lines, each ending in a newline other than the end of the file
+  for (const fs::path& file : {plainFile, gzFile}) {
+    for (std::size_t bufferSize : {1ul, 7ul, LineReader::defaultBufferSize}) {
+      LineReader reader(file, bufferSize);
+      std::string joined;
+      std::string_view lines;
+      bool allWhole = true;
+      while (reader.nextLines(lines)) {
+        joined += lines;
+        allWhole = allWhole && (lines.back() == '\n' || joined.size() == text.size());
+      }
+      CHECK(joined == text);
+      CHECK(allWhole);
+      CHECK(reader.getLineNumber() == 4ul);
+    }
+  }
+
+  // Handing over the buffer keeps earlier pieces valid after later reads
+  for (const fs::path& file : {plainFile, gzFile}) {
+    for (std::size_t bufferSize : {1ul, 7ul, LineReader::defaultBufferSize}) {
+      LineReader reader(file, bufferSize);
+      std::vector<std::vector<char>> storage;
+      std::vector<std::string_view> pieces;
+      std::vector<char> next;
+      std::string_view lines;
+      while (reader.nextLines(next, lines)) {
+        storage.push_back(std::move(next));
+        pieces.push_back(lines);
+        next.clear();
+      }
+      std::string joined;
+      for (const std::string_view piece : pieces) {
+        joined += piece;
+      }
+      CHECK(joined == text);
+      CHECK(reader.getLineNumber() == 4ul);
+    }
+  }
+
+  CHECK_THROWS_WITH(LineReader(outDir / "does_not_exist.txt"), Catch::StartsWith("Could not open"));
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
@@ -0,0 +1,38 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/MemoryMappedFile.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+namespace asmc {
+
+TEST_CASE("utils/MemoryMappedFile: map a file", "[utils/MemoryMappedFile]") {
+
+  const std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+
+  MemoryMappedFile mapped(bedFile);
+  CHECK(mapped.size() == static_cast<std::size_t>(std::filesystem::file_size(bedFile)));
+  REQUIRE(mapped.data() != nullptr);
+  CHECK(mapped.data()[0] == static_cast<uint8_t>(0x6c));
+  CHECK(mapped.data()[1] == static_cast<uint8_t>(0x1b));
+  CHECK(mapped.data()[2] == static_cast<uint8_t>(0x01));
+
+  // Moving transfers ownership of the mapping
+  const uint8_t* data = mapped.data();
+  MemoryMappedFile moved(std::move(mapped));
+  CHECK(moved.data() == data);
+  CHECK(moved.size() == static_cast<std::size_t>(std::filesystem::file_size(bedFile)));
+}
+
+TEST_CASE("utils/MemoryMappedFile: test exceptions", "[utils/MemoryMappedFile]") {
+  CHECK_THROWS_WITH(MemoryMappedFile(DATA_MODULE_TEST_DIR "/does/not/exist.bed"),
+                    Catch::StartsWith("Could not open"));
+}
+
+} // namespace asmc
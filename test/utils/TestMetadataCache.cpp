@@ -0,0 +1,66 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/MetadataCache.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("utils/MetadataCache: round trip and invalidation", "[utils/MetadataCache]") {
+
+  const fs::path outDir = fs::temp_directory_path() / "data_module_test_metadata_cache";
+  fs::create_directories(outDir);
+  const fs::path source = outDir / "source.txt";
+  std::ofstream(source) << "some text\n";
+
+  // There is no sidecar until one is saved
+  CHECK(!MetadataCacheReader::open(source, "test").has_value());
+
+  MetadataCacheWriter writer("test");
+  writer.writeValue(42ul);
+  writer.writeVector(std::vector<double>{1.5, -2.0});
+  writer.writeStrings(std::vector<std::string>{"a", "", "bcd"});
+  writer.writeVector(std::vector<uint8_t>{});
+  REQUIRE(writer.save(source));
+  CHECK(fs::is_regular_file(metadataCachePath(source)));
+
+  {
+    auto reader = MetadataCacheReader::open(source, "test");
+    REQUIRE(reader.has_value());
+    CHECK(reader->readValue<unsigned long>() == 42ul);
+    CHECK(reader->readVector<double>() == std::vector<double>{1.5, -2.0});
+    CHECK(reader->readStrings().toVector() == std::vector<std::string>{"a", "", "bcd"});
+    CHECK(reader->readVector<uint8_t>().empty());
+    CHECK_THROWS_WITH(reader->readValue<uint32_t>(), Catch::Contains("ends before all of its values were read"));
+  }
+
+  // A sidecar of a different kind is ignored
+  CHECK(!MetadataCacheReader::open(source, "other").has_value());
+
+  // Corrupting the payload invalidates the checksum
+  {
+    std::fstream cache(metadataCachePath(source), std::ios::in | std::ios::out | std::ios::binary);
+    cache.seekp(-1, std::ios::end);
+    cache.put('\x7f');
+  }
+  CHECK(!MetadataCacheReader::open(source, "test").has_value());
+
+  // Modifying the source invalidates the sidecar, even if the size is unchanged
+  REQUIRE(writer.save(source));
+  CHECK(MetadataCacheReader::open(source, "test").has_value());
+  std::ofstream(source) << "same size\n";
+  fs::last_write_time(source, fs::last_write_time(source) + std::chrono::seconds(1));
+  CHECK(!MetadataCacheReader::open(source, "test").has_value());
+
+  fs::remove_all(outDir);
+}
+
+} // namespace asmc
@@ -0,0 +1,53 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/MemoryMappedFile.hpp"
+#include "utils/RandomAccessFile.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("utils/RandomAccessFile: read at offsets", "[utils/RandomAccessFile]") {
+
+  const std::string bedFile = DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed";
+  const MemoryMappedFile reference(bedFile);
+
+  RandomAccessFile file(bedFile);
+  CHECK(file.size() == reference.size());
+
+  std::vector<uint8_t> buffer(100ul);
+  for (std::size_t offset : {0ul, 3ul, 17ul, reference.size() - buffer.size()}) {
+    file.readAt(offset, buffer.data(), buffer.size());
+    CHECK(std::memcmp(buffer.data(), reference.data() + offset, buffer.size()) == 0);
+  }
+
+  // Access hints do not change what is read
+  file.adviseSequential();
+  file.readAt(3ul, buffer.data(), buffer.size());
+  CHECK(std::memcmp(buffer.data(), reference.data() + 3ul, buffer.size()) == 0);
+
+  // Moving transfers ownership of the file
+  RandomAccessFile moved(std::move(file));
+  CHECK(moved.size() == reference.size());
+  moved.readAt(5ul, buffer.data(), 1ul);
+  CHECK(buffer[0] == reference.data()[5]);
+}
+
+TEST_CASE("utils/RandomAccessFile: test exceptions", "[utils/RandomAccessFile]") {
+
+  CHECK_THROWS_WITH(RandomAccessFile(DATA_MODULE_TEST_DIR "/does/not/exist.bed"), Catch::StartsWith("Could not open"));
+
+  const RandomAccessFile file(DATA_MODULE_TEST_DIR "/data/bedbimfam/real_example.bed");
+  std::vector<uint8_t> buffer(10ul);
+  CHECK_THROWS_WITH(file.readAt(file.size() - 5ul, buffer.data(), buffer.size()), Catch::StartsWith("Cannot read 10"));
+}
+
+} // namespace asmc
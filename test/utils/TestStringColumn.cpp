@@ -0,0 +1,37 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/StringColumn.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("utils/StringColumn: append and access strings", "[utils/StringColumn]") {
+
+  StringColumn column;
+  CHECK(column.empty());
+  CHECK_THROWS_AS(column.front(), std::out_of_range);
+
+  column.reserve(4ul, 16ul);
+  column.push_back("rs123");
+  column.push_back("");
+  column.push_back(std::string("ACGT"));
+  column.push_back("x");
+
+  CHECK(column.size() == 4ul);
+  CHECK(column.numChars() == 10ul);
+  CHECK(column[0ul] == "rs123");
+  CHECK(column[1ul].empty());
+  CHECK(column.at(2ul) == "ACGT");
+  CHECK(column.front() == "rs123");
+  CHECK(column.back() == "x");
+  CHECK_THROWS_AS(column.at(4ul), std::out_of_range);
+  CHECK(column.toVector() == std::vector<std::string>{"rs123", "", "ACGT", "x"});
+}
+
+} // namespace asmc
@@ -7,6 +7,7 @@
 
 #include <limits>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <fmt/core.h>
@@ -86,4 +87,24 @@ TEST_CASE("utils/StringUtils: test dblFromString", "[utils/StringUtils]") {
   CHECK_THROWS_WITH(dblFromString("notanumber"), Catch::Contains("not representable as a double"));
 }
 
+TEST_CASE("utils/StringUtils: test line and field views", "[utils/StringUtils]") {
+
+  CHECK(countLines("") == 0ul);
+  CHECK(countLines("a") == 1ul);
+  CHECK(countLines("a\nb\n") == 2ul);
+  CHECK(countLines("a\n\nb") == 3ul);
+
+  std::string_view text = "first \t\r\n\nlast";
+  CHECK(popLine(text) == "first");
+  CHECK(popLine(text).empty());
+  CHECK(popLine(text) == "last");
+  CHECK(text.empty());
+
+  std::vector<std::string_view> fields;
+  splitIntoViews("a\t\tbc", '\t', fields);
+  CHECK(fields == std::vector<std::string_view>{"a", "", "bc"});
+  splitIntoViews("", ' ', fields);
+  CHECK(fields == std::vector<std::string_view>{""});
+}
+
 } // namespace asmc
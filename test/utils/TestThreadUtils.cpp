@@ -0,0 +1,70 @@
+// This file is part of https://github.com/PalamaraLab/DataModule which is released under the GPL-3.0 license.
+// See accompanying LICENSE and COPYING for copyright notice and full details.
+
+#include "utils/ThreadUtils.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asmc {
+
+TEST_CASE("utils/ThreadUtils: test resolveNumThreads", "[utils/ThreadUtils]") {
+  CHECK(resolveNumThreads(1ul) == 1ul);
+  CHECK(resolveNumThreads(7ul) == 7ul);
+  CHECK(resolveNumThreads(0ul) >= 1ul);
+}
+
+TEST_CASE("utils/ThreadUtils: test parallelFor", "[utils/ThreadUtils]") {
+
+  // Every index is visited exactly once, for more and fewer threads than elements
+  for (unsigned long numThreads : {0ul, 1ul, 3ul, 64ul}) {
+    std::vector<int> visits(37ul, 0);
+    parallelFor(2ul, 37ul, numThreads, [&visits](unsigned long first, unsigned long last) {
+      for (unsigned long i = first; i < last; ++i) {
+        visits[i]++;
+      }
+    });
+    CHECK(visits[0] == 0);
+    CHECK(visits[1] == 0);
+    bool allOnce = true;
+    for (unsigned long i = 2ul; i < visits.size(); ++i) {
+      allOnce = allOnce && visits[i] == 1;
+    }
+    CHECK(allOnce);
+  }
+
+  // An empty range does not call the function
+  bool called = false;
+  parallelFor(5ul, 5ul, 4ul, [&called](unsigned long, unsigned long) { called = true; });
+  CHECK(!called);
+
+  // Exceptions are rethrown on the calling thread
+  CHECK_THROWS_WITH(parallelFor(0ul, 100ul, 4ul,
+                                [](unsigned long first, unsigned long) {
+                                  if (first > 0ul) {
+                                    throw std::runtime_error("worker failed");
+                                  }
+                                }),
+                    "worker failed");
+
+  // When several chunks throw, the exception from the earliest chunk is rethrown, even if it is thrown last
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    CHECK_THROWS_WITH(parallelFor(0ul, 100ul, 4ul,
+                                  [](unsigned long first, unsigned long) {
+                                    if (first == 25ul) {
+                                      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                                    }
+                                    if (first > 0ul) {
+                                      throw std::runtime_error("chunk at " + std::to_string(first));
+                                    }
+                                  }),
+                      "chunk at 25");
+  }
+}
+
+} // namespace asmc